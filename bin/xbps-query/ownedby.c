@@ -133,16 +133,20 @@ repo_match_cb(struct xbps_handle *xhp,
 		void *arg,
 		bool *done UNUSED)
 {
-	xbps_dictionary_t filesd;
+	xbps_dictionary_t filesd, pkgd;
 	xbps_array_t files_keys;
 	struct ffdata *ffd = arg;
 	const char *pkgver = NULL;
 	char *bfile;
 
-	xbps_dictionary_set_cstring_nocopy(obj, "repository", ffd->repouri);
+	/* the repository index is shared by all threads, don't modify it */
+	pkgd = xbps_dictionary_copy_mutable(obj);
+	assert(pkgd);
+	xbps_dictionary_set_cstring_nocopy(pkgd, "repository", ffd->repouri);
 	xbps_dictionary_get_cstring_nocopy(obj, "pkgver", &pkgver);
 
-	bfile = xbps_repository_pkg_path(xhp, obj);
+	bfile = xbps_repository_pkg_path(xhp, pkgd);
+	xbps_object_release(pkgd);
 	assert(bfile);
 	filesd = xbps_archive_fetch_plist(bfile, "/files.plist");
 	if (filesd == NULL) {
@@ -63,7 +63,8 @@
 #define _XBPS_RINDEX		"xbps-rindex"
 
 /* From index-add.c */
-int	index_add(struct xbps_handle *, int, int, char **, bool, const char *);
+int	index_add(struct xbps_handle *, int, int, char **, bool, const char *,
+		bool);
 
 /* From index-clean.c */
 int	index_clean(struct xbps_handle *, const char *, bool, const char *);
@@ -76,8 +77,13 @@ int	sign_repo(struct xbps_handle *, const char *, const char *,
 		const char *, const char *);
 int	sign_pkgs(struct xbps_handle *, int, int, char **, const char *, bool);
 
+/* From shlibs.c */
+xbps_dictionary_t shlibs_index(xbps_dictionary_t, xbps_dictionary_t);
+void	shlibs_add(xbps_dictionary_t, const char *, xbps_dictionary_t);
+void	shlibs_remove(xbps_dictionary_t, const char *, xbps_dictionary_t);
+
 /* From repoflush.c */
 bool	repodata_flush(struct xbps_handle *, const char *, const char *,
-		xbps_dictionary_t, xbps_dictionary_t, const char *);
+		xbps_dictionary_t, xbps_dictionary_t, const char *, bool);
 
 #endif /* !_XBPS_RINDEX_DEFS_H_ */
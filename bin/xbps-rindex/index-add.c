@@ -40,12 +40,12 @@
 static bool
 repodata_commit(struct xbps_handle *xhp, const char *repodir,
 	xbps_dictionary_t idx, xbps_dictionary_t meta, xbps_dictionary_t stage,
-	const char *compression)
+	const char *compression, bool train_dict)
 {
 	xbps_object_iterator_t iter;
 	xbps_object_t keysym;
 	int rv;
-	xbps_dictionary_t oldshlibs, usedshlibs;
+	xbps_dictionary_t oldshlibs, usedshlibs, shlibs;
 
 	if (xbps_dictionary_count(stage) == 0) {
 		// Nothing to do.
@@ -53,11 +53,25 @@ repodata_commit(struct xbps_handle *xhp, const char *repodir,
 	}
 
 	/*
-	 * Find old shlibs-provides
+	 * Update the shlib providers index with the staged packages and
+	 * find old shlib-provides that are no longer provided by any
+	 * package.
 	 */
+	shlibs = shlibs_index(meta, idx);
 	oldshlibs = xbps_dictionary_create();
 	usedshlibs = xbps_dictionary_create();
 
+	iter = xbps_dictionary_iterator(stage);
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		const char *pkgname = xbps_dictionary_keysym_cstring_nocopy(keysym);
+		xbps_dictionary_t pkg = xbps_dictionary_get(idx, pkgname);
+
+		shlibs_remove(shlibs, pkgname, pkg);
+		shlibs_add(shlibs, pkgname,
+		    xbps_dictionary_get_keysym(stage, keysym));
+	}
+	xbps_object_iterator_release(iter);
+
 	iter = xbps_dictionary_iterator(stage);
 	while ((keysym = xbps_object_iterator_next(iter))) {
 		const char *pkgname = xbps_dictionary_keysym_cstring_nocopy(keysym);
@@ -68,16 +82,20 @@ repodata_commit(struct xbps_handle *xhp, const char *repodir,
 		for (unsigned int i = 0; i < xbps_array_count(pkgshlibs); i++) {
 			const char *shlib = NULL;
 			xbps_array_get_cstring_nocopy(pkgshlibs, i, &shlib);
+			if (xbps_dictionary_get(shlibs, shlib))
+				continue;
 			xbps_dictionary_set_cstring(oldshlibs, shlib, pkgname);
 		}
 	}
 	xbps_object_iterator_release(iter);
 
 	/*
-	 * throw away all unused shlibs
+	 * Only if shlibs were lost, find out which packages use them.
 	 */
-	iter = xbps_dictionary_iterator(idx);
-	while ((keysym = xbps_object_iterator_next(iter))) {
+	iter = NULL;
+	if (xbps_dictionary_count(oldshlibs) != 0)
+		iter = xbps_dictionary_iterator(idx);
+	while (iter && (keysym = xbps_object_iterator_next(iter))) {
 		const char *pkgname = xbps_dictionary_keysym_cstring_nocopy(keysym);
 		xbps_dictionary_t pkg = xbps_dictionary_get(stage, pkgname);
 		xbps_array_t pkgshlibs;
@@ -95,52 +113,13 @@ repodata_commit(struct xbps_handle *xhp, const char *repodir,
 			if (!users) {
 				users = xbps_array_create();
 				xbps_dictionary_set(usedshlibs, shlib, users);
+				xbps_object_release(users);
 			}
 			xbps_array_add_cstring(users, pkgname);
 		}
 	}
-	xbps_object_iterator_release(iter);
-
-	/*
-	 * purge all packages that are fullfilled by the index and
-	 * not in the stage.
-	 */
-	iter = xbps_dictionary_iterator(idx);
-	while ((keysym = xbps_object_iterator_next(iter))) {
-		xbps_dictionary_t pkg = xbps_dictionary_get_keysym(idx, keysym);
-		xbps_array_t pkgshlibs;
-
-
-		if (xbps_dictionary_get(stage,
-					xbps_dictionary_keysym_cstring_nocopy(keysym))) {
-			continue;
-		}
-
-		pkgshlibs = xbps_dictionary_get(pkg, "shlib-provides");
-		for (unsigned int i = 0; i < xbps_array_count(pkgshlibs); i++) {
-			const char *shlib = NULL;
-			xbps_array_get_cstring_nocopy(pkgshlibs, i, &shlib);
-			xbps_dictionary_remove(usedshlibs, shlib);
-		}
-	}
-	xbps_object_iterator_release(iter);
-
-	/*
-	 * purge all packages that are fullfilled by the stage
-	 */
-	iter = xbps_dictionary_iterator(stage);
-	while ((keysym = xbps_object_iterator_next(iter))) {
-		xbps_dictionary_t pkg = xbps_dictionary_get_keysym(stage, keysym);
-		xbps_array_t pkgshlibs;
-
-		pkgshlibs = xbps_dictionary_get(pkg, "shlib-provides");
-		for (unsigned int i = 0; i < xbps_array_count(pkgshlibs); i++) {
-			const char *shlib = NULL;
-			xbps_array_get_cstring_nocopy(pkgshlibs, i, &shlib);
-			xbps_dictionary_remove(usedshlibs, shlib);
-		}
-	}
-	xbps_object_iterator_release(iter);
+	if (iter)
+		xbps_object_iterator_release(iter);
 
 	if (xbps_dictionary_count(usedshlibs) != 0) {
 		printf("Inconsistent shlibs:\n");
@@ -156,7 +135,6 @@ repodata_commit(struct xbps_handle *xhp, const char *repodir,
 			for (unsigned int i = 0; i < xbps_array_count(users); i++) {
 				const char *user = NULL;
 				xbps_array_get_cstring_nocopy(users, i, &user);
-				xbps_dictionary_remove(usedshlibs, shlib);
 				printf("%s%s",pre, user);
 				pre = ", ";
 			}
@@ -172,7 +150,8 @@ repodata_commit(struct xbps_handle *xhp, const char *repodir,
 			printf("stage: added `%s' (%s)\n", pkgver, arch);
 		}
 		xbps_object_iterator_release(iter);
-		rv = repodata_flush(xhp, repodir, "stagedata", stage, NULL, compression);
+		rv = repodata_flush(xhp, repodir, "stagedata", stage, NULL,
+		    compression, false);
 	}
 	else {
 		char *stagefile;
@@ -184,21 +163,27 @@ repodata_commit(struct xbps_handle *xhp, const char *repodir,
 			xbps_dictionary_get_cstring_nocopy(pkg, "pkgver", &pkgver);
 			xbps_dictionary_get_cstring_nocopy(pkg, "architecture", &arch);
 			printf("index: added `%s' (%s).\n", pkgver, arch);
-			xbps_dictionary_set(idx, pkgname, pkg);
+			xbps_dictionary_append(idx, pkgname, pkg);
 		}
 		xbps_object_iterator_release(iter);
+		xbps_dictionary_seal(idx);
 		stagefile = xbps_repo_path_with_name(xhp, repodir, "stagedata");
 		unlink(stagefile);
 		free(stagefile);
-		rv = repodata_flush(xhp, repodir, "repodata", idx, meta, compression);
+		if (meta != NULL)
+			xbps_dictionary_set(meta, "shlib-providers", shlibs);
+		rv = repodata_flush(xhp, repodir, "repodata", idx, meta,
+		    compression, train_dict);
 	}
+	xbps_object_release(shlibs);
 	xbps_object_release(usedshlibs);
 	xbps_object_release(oldshlibs);
 	return rv;
 }
 
 int
-index_add(struct xbps_handle *xhp, int args, int argmax, char **argv, bool force, const char *compression)
+index_add(struct xbps_handle *xhp, int args, int argmax, char **argv, bool force,
+	const char *compression, bool train_dict)
 {
 	xbps_dictionary_t idx, idxmeta, idxstage, binpkgd, curpkgd;
 	struct xbps_repo *repo = NULL, *stage = NULL;
@@ -230,6 +215,13 @@ index_add(struct xbps_handle *xhp, int args, int argmax, char **argv, bool force
 	if (repo) {
 		idx = xbps_dictionary_copy_mutable(repo->idx);
 		idxmeta = xbps_dictionary_copy_mutable(repo->idxmeta);
+		/*
+		 * The copies share their entries with the repository
+		 * index until modified, release it so that they don't
+		 * need to be copied then.
+		 */
+		xbps_repo_release(repo);
+		repo = NULL;
 	} else {
 		idx = xbps_dictionary_create();
 		idxmeta = NULL;
@@ -243,6 +235,8 @@ index_add(struct xbps_handle *xhp, int args, int argmax, char **argv, bool force
 	}
 	if (stage) {
 		idxstage = xbps_dictionary_copy_mutable(stage->idx);
+		xbps_repo_release(stage);
+		stage = NULL;
 	}
 	else {
 		idxstage = xbps_dictionary_create();
@@ -376,7 +370,8 @@ index_add(struct xbps_handle *xhp, int args, int argmax, char **argv, bool force
 	/*
 	 * Generate repository data files.
 	 */
-	if (!repodata_commit(xhp, repodir, idx, idxmeta, idxstage, compression)) {
+	if (!repodata_commit(xhp, repodir, idx, idxmeta, idxstage, compression,
+	    train_dict)) {
 		fprintf(stderr, "%s: failed to write repodata: %s\n",
 				_XBPS_RINDEX, strerror(errno));
 		goto out;
@@ -95,6 +95,9 @@ cleanup_repo(struct xbps_handle *xhp, const char *repodir, struct xbps_repo *rep
 {
 	int rv = 0;
 	xbps_array_t allkeys;
+	xbps_dictionary_t meta = NULL, shlibs;
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym;
 	struct CleanerCbInfo info = {
 		.hashcheck = hashcheck,
 		.repourl = repodir
@@ -113,12 +116,37 @@ cleanup_repo(struct xbps_handle *xhp, const char *repodir, struct xbps_repo *rep
 		free(stagefile);
 	}
 	if (!xbps_dictionary_equals(dest, repo->idx)) {
-		if (!repodata_flush(xhp, repodir, reponame, dest, repo->idxmeta, compression)) {
+		if (xbps_dictionary_get(repo->idxmeta, "shlib-providers")) {
+			/*
+			 * Unregister removed packages from the shlib
+			 * providers index.
+			 */
+			meta = xbps_dictionary_copy_mutable(repo->idxmeta);
+			shlibs = shlibs_index(meta, NULL);
+			iter = xbps_dictionary_iterator(repo->idx);
+			while ((keysym = xbps_object_iterator_next(iter))) {
+				const char *pkgname =
+				    xbps_dictionary_keysym_cstring_nocopy(keysym);
+				if (xbps_dictionary_get(dest, pkgname))
+					continue;
+				shlibs_remove(shlibs, pkgname,
+				    xbps_dictionary_get_keysym(repo->idx, keysym));
+			}
+			xbps_object_iterator_release(iter);
+			xbps_dictionary_set(meta, "shlib-providers", shlibs);
+			xbps_object_release(shlibs);
+		}
+		if (!repodata_flush(xhp, repodir, reponame, dest,
+		    meta ? meta : repo->idxmeta, compression, false)) {
 			rv = errno;
 			fprintf(stderr, "failed to write repodata: %s\n",
 			    strerror(errno));
+			if (meta)
+				xbps_object_release(meta);
 			return rv;
 		}
+		if (meta)
+			xbps_object_release(meta);
 	}
 	if (strcmp("stagedata", reponame) == 0)
 		printf("stage: %u packages registered.\n", xbps_dictionary_count(dest));
@@ -170,6 +198,10 @@ index_clean(struct xbps_handle *xhp, const char *repodir, const bool hashcheck,
 	if (stage) {
 		cleanup_repo(xhp, repodir, stage, "stagedata", hashcheck, compression);
 	}
+	if ((rv = xbps_repo_dict_prune(xhp, repodir)) != 0) {
+		fprintf(stderr, "%s: failed to remove obsolete dictionaries: %s\n",
+		    _XBPS_RINDEX, strerror(rv));
+	}
 
 out:
 	xbps_repo_release(repo);
@@ -45,7 +45,8 @@ usage(bool fail)
 	    " -C, --hashcheck                    Consider file hashes for cleaning up packages\n"
 	    "     --compression <fmt>            Compression format: none, gzip, bzip2, lz4, xz, zstd (default)\n"
 	    "     --privkey <key>                Path to the private key for signing\n"
-	    "     --signedby <string>            Signature details, i.e \"name <email>\"\n\n"
+	    "     --signedby <string>            Signature details, i.e \"name <email>\"\n"
+	    "     --train-dict                   Train a zstd dictionary for the repodata in add mode\n\n"
 	    "MODE\n"
 	    " -a, --add <repodir/file.xbps> ...  Add package(s) to repository index\n"
 	    " -c, --clean <repodir>              Clean repository index\n"
@@ -74,6 +75,7 @@ main(int argc, char **argv)
 		{ "sign-pkg", no_argument, NULL, 'S'},
 		{ "hashcheck", no_argument, NULL, 'C' },
 		{ "compression", required_argument, NULL, 2},
+		{ "train-dict", no_argument, NULL, 3},
 		{ NULL, 0, NULL, 0 }
 	};
 	struct xbps_handle xh;
@@ -81,10 +83,10 @@ main(int argc, char **argv)
 	const char *privkey = NULL, *signedby = NULL;
 	int rv, c, flags = 0;
 	bool add_mode, clean_mode, rm_mode, sign_mode, sign_pkg_mode, force,
-			 hashcheck;
+			 hashcheck, train_dict;
 
 	add_mode = clean_mode = rm_mode = sign_mode = sign_pkg_mode = force =
-		hashcheck = false;
+		hashcheck = train_dict = false;
 
 	while ((c = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1) {
 		switch (c) {
@@ -97,6 +99,9 @@ main(int argc, char **argv)
 		case 2:
 			compression = optarg;
 			break;
+		case 3:
+			train_dict = true;
+			break;
 		case 'a':
 			add_mode = true;
 			break;
@@ -160,7 +165,8 @@ main(int argc, char **argv)
 	}
 
 	if (add_mode)
-		rv = index_add(&xh, optind, argc, argv, force, compression);
+		rv = index_add(&xh, optind, argc, argv, force, compression,
+		    train_dict);
 	else if (clean_mode)
 		rv = index_clean(&xh, argv[optind], hashcheck, compression);
 	else if (rm_mode)
@@ -68,6 +68,7 @@ static int
 cleaner_cb(struct xbps_handle *xhp, xbps_object_t obj, const char *key UNUSED, void *arg, bool *done UNUSED)
 {
 	struct xbps_repo *repo = ((struct xbps_repo **)arg)[0], *stage = ((struct xbps_repo **)arg)[1];
+	struct xbps_repo_pkg rpkg;
 	const char *binpkg;
 	char *pkgver, *arch = NULL;
 	int rv;
@@ -97,7 +98,8 @@ cleaner_cb(struct xbps_handle *xhp, xbps_object_t obj, const char *key UNUSED, v
 	/*
 	 * If binpkg is not registered in index, remove binpkg.
 	 */
-	if (!xbps_repo_get_pkg(repo, pkgver) && !(stage && xbps_repo_get_pkg(stage, pkgver))) {
+	if (!xbps_repo_lookup_pkg(repo, pkgver, &rpkg) &&
+	    !(stage && xbps_repo_lookup_pkg(stage, pkgver, &rpkg))) {
 		if ((rv = remove_pkg(repo->uri, binpkg)) != 0) {
 			free(pkgver);
 			return 0;
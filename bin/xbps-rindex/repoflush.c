@@ -37,16 +37,51 @@
 #include <xbps.h>
 #include "defs.h"
 
+/*
+ * zstd archives are compressed by xbps_repo_frames_write() once the
+ * whole tar stream has been written to memory.
+ */
+struct repobuf {
+	char *data;
+	size_t len;
+	size_t size;
+};
+
+static ssize_t
+repobuf_write(struct archive *ar, void *arg, const void *buf, size_t len)
+{
+	struct repobuf *rb = arg;
+	char *data;
+	size_t size;
+
+	if (rb->len + len > rb->size) {
+		size = rb->size ? rb->size : 65536;
+		while (size < rb->len + len)
+			size *= 2;
+		if ((data = realloc(rb->data, size)) == NULL) {
+			archive_set_error(ar, ENOMEM, "out of memory");
+			return -1;
+		}
+		rb->data = data;
+		rb->size = size;
+	}
+	memcpy(rb->data + rb->len, buf, len);
+	rb->len += len;
+	return (ssize_t)len;
+}
+
 bool
 repodata_flush(struct xbps_handle *xhp, const char *repodir,
 	const char *reponame, xbps_dictionary_t idx, xbps_dictionary_t meta,
-	const char *compression)
+	const char *compression, bool train_dict)
 {
+	struct xbps_repo *oldrepo = NULL;
 	struct archive *ar;
+	struct repobuf rb = { NULL, 0, 0 };
 	char *repofile, *tname, *buf;
 	int rv, repofd = -1;
 	mode_t mask;
-	bool result;
+	bool result, frames = false;
 
 	/* Create a tempfile for our repository archive */
 	repofile = xbps_repo_path_with_name(xhp, repodir, reponame);
@@ -67,8 +102,7 @@ repodata_flush(struct xbps_handle *xhp, const char *repodir,
 	 * Set compression format, zstd by default.
 	 */
 	if (compression == NULL || strcmp(compression, "zstd") == 0) {
-		archive_write_add_filter_zstd(ar);
-		archive_write_set_options(ar, "compression-level=9");
+		frames = true;
 	} else if (strcmp(compression, "gzip") == 0) {
 		archive_write_add_filter_gzip(ar);
 		archive_write_set_options(ar, "compression-level=9");
@@ -88,7 +122,12 @@ repodata_flush(struct xbps_handle *xhp, const char *repodir,
 	}
 
 	archive_write_set_format_pax_restricted(ar);
-	if (archive_write_open_fd(ar, repofd) != ARCHIVE_OK)
+	if (frames) {
+		archive_write_set_bytes_in_last_block(ar, 1);
+		if (archive_write_open(ar, &rb, NULL, repobuf_write,
+		    NULL) != ARCHIVE_OK)
+			return false;
+	} else if (archive_write_open_fd(ar, repofd) != ARCHIVE_OK)
 		return false;
 
 	/* XBPS_REPOIDX */
@@ -121,6 +160,32 @@ repodata_flush(struct xbps_handle *xhp, const char *repodir,
 		return false;
 	if (archive_write_free(ar) != ARCHIVE_OK)
 		return false;
+	/*
+	 * Keep the index being replaced to write a delta against it,
+	 * it must be read before its dictionary is replaced.
+	 */
+	if (strcmp(reponame, "repodata") == 0)
+		oldrepo = xbps_repo_public_open(xhp, repodir);
+	if (frames) {
+		/*
+		 * A dictionary is trained from the final index, and
+		 * used by the following writes until it's trained again.
+		 */
+		if (train_dict && strcmp(reponame, "repodata") == 0 &&
+		    (rv = xbps_repo_dict_train(xhp, repodir, idx)) != 0) {
+			fprintf(stderr, "xbps-rindex: failed to train "
+			    "dictionary for %s: %s\n", repofile, strerror(rv));
+		}
+		rv = xbps_repo_frames_write(xhp, repodir, repofd,
+		    rb.data, rb.len, 9);
+		free(rb.data);
+		if (rv != 0) {
+			close(repofd);
+			unlink(tname);
+			result = false;
+			goto out;
+		}
+	}
 #ifdef HAVE_FDATASYNC
 	fdatasync(repofd);
 #else
@@ -138,8 +203,22 @@ repodata_flush(struct xbps_handle *xhp, const char *repodir,
 		result = false;
 		goto out;
 	}
+	/*
+	 * Write the binary index; if that fails clients will simply
+	 * fall back to the archive, so don't treat it as an error.
+	 */
+	if ((rv = xbps_repo_binidx_write(xhp, repofile, idx, meta)) != 0) {
+		fprintf(stderr, "xbps-rindex: failed to write binary index "
+		    "for %s: %s\n", repofile, strerror(rv));
+	}
+	if (oldrepo != NULL && (rv = xbps_repo_delta_write(xhp, repofile,
+	    oldrepo->idx, oldrepo->idxmeta, idx, meta)) != 0) {
+		fprintf(stderr, "xbps-rindex: failed to write delta "
+		    "for %s: %s\n", repofile, strerror(rv));
+	}
 	result = true;
 out:
+	xbps_repo_release(oldrepo);
 	free(repofile);
 	free(tname);
 
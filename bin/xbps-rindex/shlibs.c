@@ -0,0 +1,125 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <xbps.h>
+#include "defs.h"
+
+/*
+ * The shlib providers index maps every soname provided by packages in
+ * the repository index to an array with the names of its providers.
+ * Signed repositories store it in index-meta ("shlib-providers"); it's
+ * not stored for unsigned repositories because older clients consider
+ * any non empty index-meta to be signed.
+ */
+
+/*
+ * Returns a mutable copy of the shlib providers index in meta, or builds
+ * it from idx if there's none.
+ */
+xbps_dictionary_t
+shlibs_index(xbps_dictionary_t meta, xbps_dictionary_t idx)
+{
+	xbps_dictionary_t shlibs;
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym;
+
+	shlibs = xbps_dictionary_get(meta, "shlib-providers");
+	if (xbps_object_type(shlibs) == XBPS_TYPE_DICTIONARY)
+		return xbps_dictionary_copy_mutable(shlibs);
+
+	shlibs = xbps_dictionary_create();
+	assert(shlibs);
+	iter = xbps_dictionary_iterator(idx);
+	assert(iter);
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		shlibs_add(shlibs, xbps_dictionary_keysym_cstring_nocopy(keysym),
+		    xbps_dictionary_get_keysym(idx, keysym));
+	}
+	xbps_object_iterator_release(iter);
+
+	return shlibs;
+}
+
+/*
+ * Registers pkgname as provider of the shlib-provides of pkgd.
+ */
+void
+shlibs_add(xbps_dictionary_t shlibs, const char *pkgname, xbps_dictionary_t pkgd)
+{
+	xbps_array_t provides, providers;
+	const char *shlib = NULL;
+
+	provides = xbps_dictionary_get(pkgd, "shlib-provides");
+	for (unsigned int i = 0; i < xbps_array_count(provides); i++) {
+		xbps_array_get_cstring_nocopy(provides, i, &shlib);
+		providers = xbps_dictionary_get(shlibs, shlib);
+		if (providers != NULL &&
+		    xbps_match_string_in_array(providers, pkgname))
+			continue;
+		/* arrays copied from index-meta are immutable */
+		if (providers == NULL)
+			providers = xbps_array_create();
+		else
+			providers = xbps_array_copy_mutable(providers);
+		assert(providers);
+		xbps_array_add_cstring(providers, pkgname);
+		xbps_dictionary_set(shlibs, shlib, providers);
+		xbps_object_release(providers);
+	}
+}
+
+/*
+ * Unregisters pkgname as provider of the shlib-provides of pkgd.
+ */
+void
+shlibs_remove(xbps_dictionary_t shlibs, const char *pkgname, xbps_dictionary_t pkgd)
+{
+	xbps_array_t provides, providers;
+	const char *shlib = NULL;
+
+	provides = xbps_dictionary_get(pkgd, "shlib-provides");
+	for (unsigned int i = 0; i < xbps_array_count(provides); i++) {
+		xbps_array_get_cstring_nocopy(provides, i, &shlib);
+		providers = xbps_dictionary_get(shlibs, shlib);
+		if (providers == NULL ||
+		    !xbps_match_string_in_array(providers, pkgname))
+			continue;
+		if (xbps_array_count(providers) == 1) {
+			xbps_dictionary_remove(shlibs, shlib);
+			continue;
+		}
+		providers = xbps_array_copy_mutable(providers);
+		assert(providers);
+		xbps_remove_string_from_array(providers, pkgname);
+		xbps_dictionary_set(shlibs, shlib, providers);
+		xbps_object_release(providers);
+	}
+}
@@ -151,7 +151,7 @@ sign_repo(struct xbps_handle *xhp, const char *repodir,
 	const char *privkey, const char *signedby, const char *compression)
 {
 	struct xbps_repo *repo = NULL;
-	xbps_dictionary_t meta = NULL;
+	xbps_dictionary_t meta = NULL, shlibs;
 	xbps_data_t data = NULL, rpubkey = NULL;
 	RSA *rsa = NULL;
 	uint16_t rpubkeysize, pubkeysize;
@@ -219,6 +219,9 @@ sign_repo(struct xbps_handle *xhp, const char *repodir,
 	xbps_dictionary_set_cstring_nocopy(meta, "signature-type", "rsa");
 	xbps_object_release(data);
 	data = NULL;
+	shlibs = shlibs_index(repo->idxmeta, repo->idx);
+	xbps_dictionary_set(meta, "shlib-providers", shlibs);
+	xbps_object_release(shlibs);
 
 	/* lock repository to write repodata file */
 	if (!xbps_repo_lock(xhp, repodir, &rlockfd, &rlockfname)) {
@@ -227,7 +230,8 @@ sign_repo(struct xbps_handle *xhp, const char *repodir,
 		    _XBPS_RINDEX, strerror(errno));
 		goto out;
 	}
-	flush_failed = repodata_flush(xhp, repodir, "repodata", repo->idx, meta, compression);
+	flush_failed = repodata_flush(xhp, repodir, "repodata", repo->idx, meta, compression,
+	    false);
 	xbps_repo_unlock(rlockfd, rlockfname);
 	if (!flush_failed) {
 		fprintf(stderr, "failed to write repodata: %s\n", strerror(errno));
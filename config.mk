@@ -0,0 +1,99 @@
+# Common vars used by XBPS on linux.
+XBPS_OS = linux
+VERSION = 0.60
+TOPDIR ?=	..
+PREFIX ?=	/tmp/xbps-inst
+EPREFIX ?= /tmp/xbps-inst
+SBINDIR ?= /tmp/xbps-inst/bin
+INCLUDEDIR ?=	/tmp/xbps-inst/include
+LIBDIR ?=	/tmp/xbps-inst/lib
+MANDIR ?=	/tmp/xbps-inst/share/man
+SHAREDIR ?= /tmp/xbps-inst/share
+PKGCONFIGDIR ?= /tmp/xbps-inst/lib/pkgconfig
+TESTSDIR ?= /tmp/xbps-inst/tests
+DBDIR ?= /var/db/xbps
+ETCDIR ?= /tmp/xbps-inst/etc/xbps.d
+CC =	gcc
+CFLAGS =	-O2
+LDFLAGS =  	-L$(TOPDIR)/lib
+CPPFLAGS = 	-I. -I$(TOPDIR) -I$(TOPDIR)/include
+CPPFLAGS +=	-DXBPS_SYSCONF_PATH=\"/tmp/xbps-inst/etc/xbps.d\"
+CPPFLAGS +=	-DXBPS_SYSDEFCONF_PATH=\"/tmp/xbps-inst/share/xbps.d\"
+CPPFLAGS +=	-DXBPS_VERSION=\"0.60\"
+CPPFLAGS +=	-DXBPS_META_PATH=\"/var/db/xbps\"
+CPPFLAGS +=	-DUNUSED="__attribute__((__unused__))"
+CPPFLAGS += -DXBPS_GIT=\"df67c8b\"
+CPPFLAGS += -DDEBUG
+CFLAGS +=	-g
+LIBXBPS_LDFLAGS += -g
+CPPFLAGS += 	-D_XOPEN_SOURCE=700
+CPPFLAGS += 	-D_FILE_OFFSET_BITS=64
+LDFLAGS +=	-Wl,--no-as-needed
+CFLAGS +=	-Wall
+CFLAGS +=	-Wextra
+CFLAGS +=	-Werror
+CFLAGS +=	-Wshadow
+CFLAGS +=	-Wformat=2
+CFLAGS +=	-Wmissing-prototypes
+CFLAGS +=	-Wmissing-declarations
+CFLAGS +=	-Wnested-externs
+CFLAGS +=	-Wvla
+CFLAGS +=	-Woverlength-strings
+CFLAGS +=	-Wunsafe-loop-optimizations
+CFLAGS +=	-Wundef
+CFLAGS +=	-Wsign-compare
+CFLAGS +=	-Wmissing-include-dirs
+CFLAGS +=	-Wold-style-definition
+CFLAGS +=	-Winit-self
+CFLAGS +=	-Wredundant-decls
+CFLAGS +=	-Wfloat-equal
+CFLAGS +=	-Wmissing-noreturn
+CFLAGS +=	-Wcast-align
+CFLAGS +=	-Wcast-qual
+CFLAGS +=	-Wpointer-arith
+CFLAGS +=	-Wcomment
+CFLAGS +=	-Wdeclaration-after-statement
+CFLAGS +=	-Wwrite-strings
+CFLAGS +=	-Wstack-protector
+CFLAGS +=	-fPIC
+CFLAGS +=	-finline-functions
+CFLAGS +=	-fstack-protector-strong
+SHAREDLIB_CFLAGS +=	-fvisibility=default
+CPPFLAGS +=	-DHAVE_VISIBILITY=1
+HAVE_VISIBILITY = 1
+LIBXBPS_LDFLAGS +=	-Wl,--export-dynamic
+LDFLAGS +=	-Wl,-z,relro,-z,now
+PROG_CFLAGS +=	-fPIE
+PROG_LDFLAGS +=	-pie
+CFLAGS +=	-std=c99
+CPPFLAGS +=	-I$(TOPDIR)/lib/fetch
+LDFLAGS +=	-lssl
+STATIC_LIBS =	$(TOPDIR)/lib/libxbps.a
+CPPFLAGS +=       -I$(TOPDIR)/lib/portableproplib
+CPPFLAGS +=       -I$(TOPDIR)/lib/portableproplib/prop
+CFLAGS +=		-pthread
+CPPFLAGS +=	-DHAVE_ATOMICS
+CPPFLAGS +=	-DHAVE_VASPRINTF
+CPPFLAGS +=	-DHAVE_STRCASESTR
+COMPAT_OBJS +=	compat/strlcpy.o
+COMPAT_OBJS +=	compat/strlcat.o
+COMPAT_OBJS+=	compat/humanize_number.o
+LIBPROP_OBJS += portableproplib/rb.o
+CPPFLAGS += -DHAVE_FDATASYNC
+CPPFLAGS	+= -DHAVE_CLOCK_GETTIME
+LDFLAGS += -lrt
+STATIC_LIBS += -lrt
+LDFLAGS +=	-lz
+STATIC_LIBS +=	-lz
+CFLAGS += -I/tmp/stubs 
+LDFLAGS +=        -L/tmp/stubs/lib -larchive 
+STATIC_LIBS +=    -L/tmp/stubs/lib -larchive 
+CFLAGS += -I/tmp/stubs/zstd/include 
+LDFLAGS +=        -L/tmp/stubs/zstd/lib -lzstd 
+STATIC_LIBS +=    -L/tmp/stubs/zstd/lib -lzstd 
+CFLAGS += 
+LDFLAGS +=        -lssl 
+STATIC_LIBS +=    -lssl -lcrypto -ldl -pthread 
+SILENT = @
+PROG_LDFLAGS = -Wl,-rpath='$$ORIGIN/../lib'
+CFLAGS += -Wno-deprecated-declarations
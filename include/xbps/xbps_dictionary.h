@@ -32,6 +32,7 @@
 #ifndef _XBPS_DICTIONARY_H_
 #define	_XBPS_DICTIONARY_H_
 
+#include <sys/types.h>
 #include <stdint.h>
 #include <xbps/xbps_object.h>
 #include <xbps/xbps_array.h>
@@ -63,6 +64,16 @@ bool		xbps_dictionary_set(xbps_dictionary_t, const char *,
 				    xbps_object_t);
 void		xbps_dictionary_remove(xbps_dictionary_t, const char *);
 
+bool		xbps_dictionary_append(xbps_dictionary_t, const char *,
+				       xbps_object_t);
+void		xbps_dictionary_seal(xbps_dictionary_t);
+
+xbps_dictionary_t xbps_dictionary_create_lazy(unsigned int,
+			xbps_object_t (*)(void *, const void *),
+			void (*)(void *), void *);
+bool		xbps_dictionary_append_lazy(xbps_dictionary_t, const char *,
+					    const void *);
+
 xbps_object_t	xbps_dictionary_get_keysym(xbps_dictionary_t,
 					   xbps_dictionary_keysym_t);
 bool		xbps_dictionary_set_keysym(xbps_dictionary_t,
@@ -75,12 +86,19 @@ bool		xbps_dictionary_equals(xbps_dictionary_t, xbps_dictionary_t);
 
 char *		xbps_dictionary_externalize(xbps_dictionary_t);
 xbps_dictionary_t xbps_dictionary_internalize(const char *);
+xbps_dictionary_t xbps_dictionary_internalize_arena(const char *);
+xbps_dictionary_t xbps_dictionary_internalize_lazy(char *);
+xbps_dictionary_t xbps_dictionary_internalize_stream(
+			ssize_t (*)(void *, void *, size_t), void *);
+xbps_dictionary_t xbps_dictionary_internalize_stream_arena(
+			ssize_t (*)(void *, void *, size_t), void *);
 
 bool		xbps_dictionary_externalize_to_file(xbps_dictionary_t,
 						    const char *);
 bool		xbps_dictionary_externalize_to_zfile(xbps_dictionary_t,
 						     const char *);
 xbps_dictionary_t xbps_dictionary_internalize_from_file(const char *);
+xbps_dictionary_t xbps_dictionary_internalize_from_file_arena(const char *);
 xbps_dictionary_t xbps_dictionary_internalize_from_zfile(const char *);
 
 const char *	xbps_dictionary_keysym_cstring_nocopy(xbps_dictionary_keysym_t);
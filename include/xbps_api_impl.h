@@ -111,6 +111,8 @@ bool HIDDEN xbps_remove_pkg_from_array_by_pattern(xbps_array_t, const char *);
 bool HIDDEN xbps_remove_pkg_from_array_by_pkgver(xbps_array_t, const char *);
 void HIDDEN xbps_fetch_set_cache_connection(int, int);
 void HIDDEN xbps_fetch_unset_cache_connection(void);
+int HIDDEN xbps_fetch_file_dest_basename(struct xbps_handle *, const char *,
+		const char *, const char *);
 int HIDDEN xbps_cb_message(struct xbps_handle *, xbps_dictionary_t, const char *);
 int HIDDEN xbps_entry_is_a_conf_file(xbps_dictionary_t, const char *);
 int HIDDEN xbps_entry_install_conf_file(struct xbps_handle *, xbps_dictionary_t,
@@ -141,6 +143,21 @@ int HIDDEN xbps_transaction_pkg_deps(struct xbps_handle *, xbps_array_t, xbps_di
 
 char HIDDEN *xbps_get_remote_repo_string(const char *);
 int HIDDEN xbps_repo_sync(struct xbps_handle *, const char *);
+bool HIDDEN xbps_repo_binidx_open(struct xbps_repo *, const char *,
+		const struct stat *);
+int HIDDEN xbps_repo_frames_open(struct xbps_repo *, const char *,
+		const struct stat *);
+uint32_t HIDDEN xbps_repo_frames_dictid(const char *);
+uint32_t HIDDEN xbps_repo_frames_dictfile_id(const char *);
+bool HIDDEN xbps_repo_sync_delta(struct xbps_handle *, const char *,
+		const char *, const char *);
+char HIDDEN *xbps_repo_file(struct xbps_handle *, const char *, const char *);
+struct xbps_repo_binidx;
+struct xbps_repo_binidx HIDDEN *xbps_repo_binidx_map(struct xbps_handle *,
+		const char *);
+const char HIDDEN *xbps_repo_binidx_get_pkgver(struct xbps_repo_binidx *,
+		const char *, bool *);
+void HIDDEN xbps_repo_binidx_unmap(struct xbps_repo_binidx *);
 int HIDDEN xbps_file_hash_check_dictionary(struct xbps_handle *,
 		xbps_dictionary_t, const char *, const char *);
 int HIDDEN xbps_file_exec(struct xbps_handle *, const char *, ...);
@@ -154,6 +171,8 @@ int HIDDEN xbps_register_pkg(struct xbps_handle *, xbps_dictionary_t);
 char HIDDEN *xbps_archive_get_file(struct archive *, struct archive_entry *);
 xbps_dictionary_t HIDDEN xbps_archive_get_dictionary(struct archive *,
 		struct archive_entry *);
+xbps_dictionary_t HIDDEN xbps_archive_get_dictionary_arena(struct archive *,
+		struct archive_entry *);
 const char HIDDEN *vpkg_user_conf(struct xbps_handle *, const char *, bool);
 xbps_array_t HIDDEN xbps_get_pkg_fulldeptree(struct xbps_handle *,
 		const char *, bool);
@@ -55,19 +55,33 @@ xbps_archive_get_file(struct archive *ar, struct archive_entry *entry)
 	return buf;
 }
 
+static ssize_t
+archive_read_cb(void *arg, void *buf, size_t len)
+{
+	return archive_read_data(arg, buf, len);
+}
+
+/*
+ * The dictionary is internalized while the entry is being decompressed,
+ * so the whole plist never has to be kept in memory.
+ */
 xbps_dictionary_t HIDDEN
-xbps_archive_get_dictionary(struct archive *ar, struct archive_entry *entry)
+xbps_archive_get_dictionary(struct archive *ar, struct archive_entry *entry UNUSED)
 {
-	xbps_dictionary_t d = NULL;
-	char *buf;
+	assert(ar != NULL);
+	assert(entry != NULL);
 
-	if ((buf = xbps_archive_get_file(ar, entry)) == NULL)
-		return NULL;
+	return xbps_dictionary_internalize_stream(archive_read_cb, ar);
+}
+
+xbps_dictionary_t HIDDEN
+xbps_archive_get_dictionary_arena(struct archive *ar,
+		struct archive_entry *entry UNUSED)
+{
+	assert(ar != NULL);
+	assert(entry != NULL);
 
-	/* If blob is already a dictionary we are done */
-	d = xbps_dictionary_internalize(buf);
-	free(buf);
-	return d;
+	return xbps_dictionary_internalize_stream_arena(archive_read_cb, ar);
 }
 
 int
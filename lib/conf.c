@@ -158,6 +158,9 @@ store_noextract(struct xbps_handle *xhp, const char *value)
 	xbps_dbg_printf(xhp, "Added noextract pattern: %s\n", value);
 }
 
+/* upper limit of the syncjobs option */
+#define SYNCJOBS_MAX	64
+
 enum {
 	KEY_ERROR = 0,
 	KEY_ARCHITECTURE,
@@ -172,6 +175,7 @@ enum {
 	KEY_SYSLOG,
 	KEY_VIRTUALPKG,
 	KEY_KEEPCONF,
+	KEY_SYNCJOBS,
 };
 
 static const struct key {
@@ -191,6 +195,7 @@ static const struct key {
 	{ "syslog",        6, KEY_SYSLOG },
 	{ "virtualpkg",   10, KEY_VIRTUALPKG },
 	{ "keepconf",      8, KEY_KEEPCONF },
+	{ "syncjobs",      8, KEY_SYNCJOBS },
 };
 
 static int
@@ -281,7 +286,8 @@ parse_file(struct xbps_handle *xhp, const char *path, bool nested)
 	char *line = NULL;
 	int rv = 0;
 	int size, rs;
-	char *dir;
+	char *dir, *endp;
+	unsigned long jobs;
 
 	if ((fp = fopen(path, "r")) == NULL) {
 		rv = errno;
@@ -376,6 +382,19 @@ parse_file(struct xbps_handle *xhp, const char *path, bool nested)
 				xbps_dbg_printf(xhp, "%s: pkg best matching disabled\n", path);
 			}
 			break;
+		case KEY_SYNCJOBS:
+			errno = 0;
+			jobs = strtoul(val, &endp, 10);
+			if (errno != 0 || endp == val || *endp != '\0' ||
+			    jobs == 0 || jobs > SYNCJOBS_MAX) {
+				xbps_dbg_printf(xhp, "%s: ignoring invalid "
+				    "syncjobs option at line %zu\n", path, nlines);
+				break;
+			}
+			xhp->sync_jobs = (unsigned int)jobs;
+			xbps_dbg_printf(xhp, "%s: syncjobs set to %u\n", path,
+			    xhp->sync_jobs);
+			break;
 		case KEY_IGNOREPKG:
 			store_ignored_pkg(xhp, val);
 			break;
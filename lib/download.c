@@ -59,7 +59,7 @@ static const char *
 print_time(time_t *t)
 {
 	struct tm tm;
-	static char buf[255];
+	static __thread char buf[255];
 
 	gmtime_r(t, &tm);
 	strftime(buf, sizeof(buf), "%d %b %Y %H:%M", &tm);
@@ -92,8 +92,14 @@ xbps_fetch_error_string(void)
 	return fetchLastErrString;
 }
 
-int
-xbps_fetch_file_dest_sha256(struct xbps_handle *xhp, const char *uri, const char *filename, const char *flags, unsigned char *digest, size_t digestlen)
+/*
+ * Fetches uri into filename, name is the file name reported to the
+ * fetch callback.
+ */
+static int
+fetch_file_dest(struct xbps_handle *xhp, const char *uri, const char *filename,
+		const char *name, const char *flags, unsigned char *digest,
+		size_t digestlen)
 {
 	struct stat st, st_tmpfile, *stp;
 	struct url *url = NULL;
@@ -251,7 +257,7 @@ xbps_fetch_file_dest_sha256(struct xbps_handle *xhp, const char *uri, const char
 	 * immediately.
 	 */
 	xbps_set_cb_fetch(xhp, url_st.size, url->offset, url->offset,
-	    filename, true, false, false);
+	    name, true, false, false);
 	/*
 	 * Start fetching requested file.
 	 */
@@ -272,7 +278,7 @@ xbps_fetch_file_dest_sha256(struct xbps_handle *xhp, const char *uri, const char
 		 */
 		xbps_set_cb_fetch(xhp, url_st.size, url->offset,
 		    url->offset + bytes_dload,
-		    filename, false, true, false);
+		    name, false, true, false);
 	}
 	if (bytes_read == -1) {
 		xbps_dbg_printf(xhp, "IO error while fetching %s: %s\n",
@@ -292,7 +298,7 @@ xbps_fetch_file_dest_sha256(struct xbps_handle *xhp, const char *uri, const char
 	 * has been fetched.
 	 */
 	xbps_set_cb_fetch(xhp, url_st.size, url->offset, bytes_dload,
-	    filename, false, false, true);
+	    name, false, false, true);
 
 	/*
 	 * Update mtime in local file to match remote file if transfer
@@ -334,6 +340,15 @@ fetch_file_out:
 	return rv;
 }
 
+int
+xbps_fetch_file_dest_sha256(struct xbps_handle *xhp, const char *uri,
+		const char *filename, const char *flags, unsigned char *digest,
+		size_t digestlen)
+{
+	return fetch_file_dest(xhp, uri, filename, filename, flags, digest,
+	    digestlen);
+}
+
 int
 xbps_fetch_file_dest(struct xbps_handle *xhp, const char *uri,
 		const char *filename, const char *flags)
@@ -341,6 +356,24 @@ xbps_fetch_file_dest(struct xbps_handle *xhp, const char *uri,
 	return xbps_fetch_file_dest_sha256(xhp, uri, filename, flags, NULL, 0);
 }
 
+/*
+ * Same as xbps_fetch_file_dest(), but only the base name of filename is
+ * reported to the fetch callback, as if it was fetched by
+ * xbps_fetch_file() into the current directory.
+ */
+int HIDDEN
+xbps_fetch_file_dest_basename(struct xbps_handle *xhp, const char *uri,
+		const char *filename, const char *flags)
+{
+	const char *name;
+
+	if ((name = strrchr(filename, '/')) != NULL)
+		name++;
+	else
+		name = filename;
+	return fetch_file_dest(xhp, uri, filename, name, flags, NULL, 0);
+}
+
 int
 xbps_fetch_file_sha256(struct xbps_handle *xhp, const char *uri,
 		const char *flags, unsigned char *digest, size_t digestlen)
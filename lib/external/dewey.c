@@ -38,15 +38,6 @@
 
 #include "xbps_api_impl.h"
 
-#define PKG_PATTERN_MAX 1024
-
-#ifndef MIN
-#define MIN(a,b)	(((a) < (b)) ? (a) : (b))
-#endif
-#ifndef MAX
-#define MAX(a,b)	(((a) > (b)) ? (a) : (b))
-#endif
-
 enum {
 	DEWEY_LT,
 	DEWEY_LE,
@@ -65,13 +56,16 @@ enum {
         Patch = 1
 };
 
-/* this struct defines a version number */
-typedef struct arr_t {
-	unsigned	c;              /* # of version numbers */
-	unsigned	size;           /* size of array */
-	int	       *v;              /* array of decimal numbers */
+/*
+ * this struct walks the components of a version number without
+ * storing them: version strings are compared while being parsed.
+ */
+typedef struct vcursor_t {
+	const char     *s;              /* next char to parse */
+	const char     *end;            /* end of the version string */
+	int		pending;        /* letter value queued after a Dot */
 	int		revision;       /* any "_" suffix */
-} arr_t;
+} vcursor_t;
 
 /* this struct describes a test */
 typedef struct test_t {
@@ -119,94 +113,76 @@ dewey_mktest(int *op, const char *test)
 	return -1;
 }
 
+static void
+vinit(vcursor_t *vc, const char *num, const char *end)
+{
+	vc->s = num;
+	vc->end = end ? end : num + strlen(num);
+	vc->pending = 0;
+	vc->revision = 0;
+}
+
 /*
- * make a component of a version number.
+ * get the next component of a version number, false at its end.
  * '.' encodes as Dot which is '0'
  * 'pl' encodes as 'patch level', or 'Dot', which is 0.
  * 'alpha' encodes as 'alpha version', or Alpha, which is -3.
  * 'beta' encodes as 'beta version', or Beta, which is -2.
  * 'rc' encodes as 'release candidate', or RC, which is -1.
  * '_' encodes as 'xbps revision', which is used after all other tests
+ * any other letter encodes as Dot followed by its position in the alphabet.
  */
-static int
-mkcomponent(arr_t *ap, const char *num)
+static bool
+vnext(vcursor_t *vc, int *v)
 {
 	static const char       alphas[] = "abcdefghijklmnopqrstuvwxyz";
 	const test_t	       *modp;
+	const char             *num = vc->s;
 	int                 n;
-	const char             *cp;
-
-	if (ap->c == ap->size) {
-		if (ap->size == 0) {
-			ap->size = 62;
-			ap->v = malloc(ap->size * sizeof(int));
-			assert(ap->v != NULL);
-		} else {
-			ap->size *= 2;
-			ap->v = realloc(ap->v, ap->size * sizeof(int));
-			assert(ap->v != NULL);
-		}
+
+	if (vc->pending) {
+		*v = vc->pending;
+		vc->pending = 0;
+		return true;
 	}
-	if (isdigit((unsigned char)*num)) {
-		for (cp = num, n = 0 ; isdigit((unsigned char)*num) ; num++) {
-			n = (n * 10) + (*num - '0');
+	while (num < vc->end) {
+		if (isdigit((unsigned char)*num)) {
+			for (n = 0 ; num < vc->end &&
+			    isdigit((unsigned char)*num) ; num++) {
+				n = (n * 10) + (*num - '0');
+			}
+			vc->s = num;
+			*v = n;
+			return true;
 		}
-		ap->v[ap->c++] = n;
-		return (int)(num - cp);
-	}
-	for (modp = modifiers ; modp->s ; modp++) {
-		if (strncasecmp(num, modp->s, modp->len) == 0) {
-			ap->v[ap->c++] = modp->t;
-			return modp->len;
+		for (modp = modifiers ; modp->s ; modp++) {
+			if (strncasecmp(num, modp->s, modp->len) == 0) {
+				vc->s = num + modp->len;
+				*v = modp->t;
+				return true;
+			}
 		}
-	}
-	if (strncasecmp(num, "_", 1) == 0) {
-		for (cp = num, num += 1, n = 0 ; isdigit((unsigned char)*num) ; num++) {
-			n = (n * 10) + (*num - '0');
+		if (*num == '_') {
+			for (num += 1, n = 0 ; num < vc->end &&
+			    isdigit((unsigned char)*num) ; num++) {
+				n = (n * 10) + (*num - '0');
+			}
+			vc->revision = n;
+			continue;
 		}
-		ap->revision = n;
-		return (int)(num - cp);
-	}
-	if (isalpha((unsigned char)*num)) {
-		ap->v[ap->c++] = Dot;
-		cp = strchr(alphas, tolower((unsigned char)*num));
-		if (ap->c == ap->size) {
-			ap->size *= 2;
-			ap->v = realloc(ap->v, ap->size * sizeof(int));
-			assert(ap->v != NULL);
+		if (isalpha((unsigned char)*num)) {
+			vc->pending = (int)(strchr(alphas,
+			    tolower((unsigned char)*num)) - alphas) + 1;
+			vc->s = num + 1;
+			*v = Dot;
+			return true;
 		}
-		ap->v[ap->c++] = (int)(cp - alphas) + 1;
-		return 1;
+		num++;
 	}
-	return 1;
+	vc->s = num;
+	return false;
 }
 
-/* make a version number string into an array of comparable ints */
-static int
-mkversion(arr_t *ap, const char *num)
-{
-	ap->c = 0;
-	ap->size = 0;
-	ap->v = NULL;
-	ap->revision = 0;
-
-	while (*num) {
-		num += mkcomponent(ap, num);
-	}
-	return 1;
-}
-
-static void
-freeversion(arr_t *ap)
-{
-	free(ap->v);
-	ap->v = NULL;
-	ap->c = 0;
-	ap->size = 0;
-}
-
-#define DIGIT(v, c, n) (((n) < (c)) ? v[n] : 0)
-
 /* compare the result against the test we were expecting */
 static int
 result(int cmp, int tst)
@@ -229,41 +205,43 @@ result(int cmp, int tst)
 	}
 }
 
-/* do the test on the 2 vectors */
+/*
+ * compare 2 version numbers, missing components count as Dot.
+ * lend and rend may be NULL if the strings are NUL terminated.
+ */
 static int
-vtest(arr_t *lhs, int tst, arr_t *rhs)
+vcmp(const char *lhs, const char *lend, const char *rhs, const char *rend)
 {
-	int cmp;
-	unsigned int c, i;
-
-	for (i = 0, c = MAX(lhs->c, rhs->c) ; i < c ; i++) {
-		if ((cmp = DIGIT(lhs->v, lhs->c, i) - DIGIT(rhs->v, rhs->c, i)) != 0) {
-			return result(cmp, tst);
-		}
+	vcursor_t	left, right;
+	bool		lmore, rmore;
+	int		lv, rv;
+
+	vinit(&left, lhs, lend);
+	vinit(&right, rhs, rend);
+	for (;;) {
+		lmore = vnext(&left, &lv);
+		rmore = vnext(&right, &rv);
+		if (!lmore && !rmore)
+			break;
+		if (!lmore)
+			lv = Dot;
+		if (!rmore)
+			rv = Dot;
+		if (lv != rv)
+			return (lv < rv) ? -1 : 1;
 	}
-	return result(lhs->revision - rhs->revision, tst);
+	if (left.revision != right.revision)
+		return (left.revision < right.revision) ? -1 : 1;
+	return 0;
 }
 
 /*
- * Compare two dewey decimal numbers.
+ * Compare two dewey decimal numbers, rhs ends at rend if not NULL.
  */
 static int
-dewey_cmp(const char *lhs, int op, const char *rhs)
+dewey_cmp(const char *lhs, int op, const char *rhs, const char *rend)
 {
-	arr_t	right;
-	arr_t	left;
-	int retval;
-
-	if (!mkversion(&left, lhs))
-		return 0;
-	if (!mkversion(&right, rhs)) {
-		freeversion(&left);
-		return 0;
-	}
-        retval = vtest(&left, op, &right);
-	freeversion(&left);
-	freeversion(&right);
-	return retval;
+	return result(vcmp(lhs, NULL, rhs, rend), op);
 }
 
 /*
@@ -274,12 +252,56 @@ dewey_cmp(const char *lhs, int op, const char *rhs)
 int
 xbps_cmpver(const char *pkg1, const char *pkg2)
 {
-	if (dewey_cmp(pkg1, DEWEY_LT, pkg2))
-		return -1;
-	else if (dewey_cmp(pkg1, DEWEY_GT, pkg2))
-		return 1;
+	return vcmp(pkg1, NULL, pkg2, NULL);
+}
+
+/*
+ * Parse the version of pkgver into a key, components after the last
+ * one are Dot so keys can be compared as integer arrays.
+ */
+bool
+xbps_pkgver_key(struct xbps_pkgver_key *key, const char *pkgver)
+{
+	vcursor_t vc;
+	const char *version;
+	unsigned int i = 0;
+	int v;
+
+	assert(key);
+	assert(pkgver);
+
+	if ((version = strrchr(pkgver, '-')) != NULL)
+		version++;
 	else
-		return 0;
+		version = pkgver;
+
+	memset(key, 0, sizeof(*key));
+	vinit(&vc, version, NULL);
+	while (vnext(&vc, &v)) {
+		if (i == XBPS_PKGVER_KEY_MAX)
+			return false;
+		key->v[i++] = v;
+	}
+	key->revision = vc.revision;
+	return true;
+}
+
+int
+xbps_pkgver_key_cmp(const struct xbps_pkgver_key *key1,
+		const struct xbps_pkgver_key *key2)
+{
+	unsigned int i;
+
+	assert(key1);
+	assert(key2);
+
+	for (i = 0; i < XBPS_PKGVER_KEY_MAX; i++) {
+		if (key1->v[i] != key2->v[i])
+			return (key1->v[i] < key2->v[i]) ? -1 : 1;
+	}
+	if (key1->revision != key2->revision)
+		return (key1->revision < key2->revision) ? -1 : 1;
+	return 0;
 }
 
 /*
@@ -321,22 +343,14 @@ dewey_match(const char *pattern, const char *pkg)
 				return 0;
 			}
 			/* compare upper limit */
-			if (!dewey_cmp(version, op2, sep2+n))
+			if (!dewey_cmp(version, op2, sep2+n, NULL))
 				return 0;
 		}
 	}
 
 	/* compare only pattern / lower limit */
-	if (sep2) {
-		char ver[PKG_PATTERN_MAX];
-
-		xbps_strlcpy(ver, sep, MIN((ssize_t)sizeof(ver), sep2-sep+1));
-		if (dewey_cmp(version, op, ver))
-			return 1;
-	} else {
-		if (dewey_cmp(version, op, sep))
-			return 1;
-	}
+	if (dewey_cmp(version, op, sep, sep2))
+		return 1;
 
 	return 0;
 }
@@ -428,16 +428,14 @@ fetch_socks5(conn_t *conn, struct url *url, struct url *socks, int verbose)
 	return 0;
 }
 
-static int
-get_conn_timeout(void)
+static pthread_once_t conn_timeout_once = PTHREAD_ONCE_INIT;
+static int conn_timeout_result;
+
+static void
+conn_timeout_init(void)
 {
-	static int result = -2;
 	char *conn_timeout;
 
-	if (result != -2) {
-		return result;
-	}
-
 	conn_timeout = getenv("CONNECTION_TIMEOUT");
 	if (conn_timeout) {
 		char *char_read = conn_timeout;
@@ -445,12 +443,17 @@ get_conn_timeout(void)
 		if (from_env < -1 || char_read == conn_timeout) {
 			from_env = fetchConnTimeout;
 		}
-		result = from_env > INT_MAX ? INT_MAX: from_env;
+		conn_timeout_result = from_env > INT_MAX ? INT_MAX: from_env;
 	} else {
-		result = fetchConnTimeout;
+		conn_timeout_result = fetchConnTimeout;
 	}
+}
 
-	return result;
+static int
+get_conn_timeout(void)
+{
+	(void)pthread_once(&conn_timeout_once, conn_timeout_init);
+	return conn_timeout_result;
 }
 
 /*
@@ -478,10 +481,13 @@ get_conn_timeout(void)
  */
 #define UNREACH_IPV6 0x01
 #define UNREACH_IPV4 0x10
+static pthread_mutex_t unreach_mtx = PTHREAD_MUTEX_INITIALIZER;
+static int unreach_families = 0;
+
 static int
 happy_eyeballs_connect(struct addrinfo *res0, int verbose)
 {
-	static int unreach = 0;
+	int unreach;
 	int connTimeout = get_conn_timeout();
 	struct pollfd *pfd;
 	struct addrinfo *res;
@@ -506,6 +512,10 @@ happy_eyeballs_connect(struct addrinfo *res0, int verbose)
 	fetch_info("got %d A and %d AAAA records", n4, n6);
 #endif
 
+	pthread_mutex_lock(&unreach_mtx);
+	unreach = unreach_families;
+	pthread_mutex_unlock(&unreach_mtx);
+
 	i4 = i6 = 0;
 	if (unreach & UNREACH_IPV6 || getenv("FORCE_IPV4"))
 		i6 = n6;
@@ -600,13 +610,15 @@ happy_eyeballs_connect(struct addrinfo *res0, int verbose)
 				pfd[attempts].fd = sd;
 			} else if (errno == ENETUNREACH) {
 				close(sd);
+				pthread_mutex_lock(&unreach_mtx);
 				if (family == AF_INET) {
 					i4 = n4;
-					unreach |= UNREACH_IPV4;
+					unreach_families |= UNREACH_IPV4;
 				} else {
 					i6 = n6;
-					unreach |= UNREACH_IPV6;
+					unreach_families |= UNREACH_IPV6;
 				}
+				pthread_mutex_unlock(&unreach_mtx);
 				continue;
 			} else if (errno == EADDRNOTAVAIL) {
 				err = errno;
@@ -1882,7 +1894,7 @@ fetchFreeURLList(struct url_list *ue)
 static const char *
 fetch_read_word(FILE *f)
 {
-	static char word[1024];
+	static __thread char word[1024];
 
 	if (fscanf(f, " %1023s ", word) != 1)
 		return (NULL);
@@ -165,10 +165,10 @@ void		 fetchConnectionCacheClose(void);
 typedef int (*auth_t)(struct url *);
 extern auth_t		 fetchAuthMethod;
 
-/* Last error code */
-extern int		 fetchLastErrCode;
+/* Last error code, per thread */
+extern __thread int	 fetchLastErrCode;
 #define MAXERRSTRING 256
-extern char		 fetchLastErrString[MAXERRSTRING];
+extern __thread char	 fetchLastErrString[MAXERRSTRING];
 
 /* I/O timeout */
 extern int		 fetchTimeout;
@@ -31,6 +31,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "xbps_api_impl.h"
 
@@ -275,6 +276,37 @@ xbps_pkgdb_init(struct xbps_handle *xhp)
 	return 0;
 }
 
+static ssize_t
+pkgdb_read_cb(void *arg, void *buf, size_t len)
+{
+	int fd = *(int *)arg;
+	ssize_t n;
+
+	while ((n = read(fd, buf, len)) == -1 && errno == EINTR)
+		;
+	return n;
+}
+
+/*
+ * The pkgdb plist is read in blocks by the streaming internalizer, only
+ * the package dictionary being parsed is kept in memory besides the
+ * resulting tree.  Sets errno to ENOENT if the file doesn't exist.
+ */
+static xbps_dictionary_t
+pkgdb_internalize(const char *path)
+{
+	xbps_dictionary_t d;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY|O_CLOEXEC)) == -1)
+		return NULL;
+	d = xbps_dictionary_internalize_stream(pkgdb_read_cb, &fd);
+	(void)close(fd);
+	if (d == NULL)
+		errno = EINVAL;
+	return d;
+}
+
 int
 xbps_pkgdb_update(struct xbps_handle *xhp, bool flush, bool update)
 {
@@ -287,7 +319,7 @@ xbps_pkgdb_update(struct xbps_handle *xhp, bool flush, bool update)
 		return cached_rv;
 
 	if (xhp->pkgdb && flush) {
-		pkgdb_storage = xbps_dictionary_internalize_from_file(xhp->pkgdb_plist);
+		pkgdb_storage = pkgdb_internalize(xhp->pkgdb_plist);
 		if (pkgdb_storage == NULL ||
 		    !xbps_dictionary_equals(xhp->pkgdb, pkgdb_storage)) {
 			/* flush dictionary to storage */
@@ -309,7 +341,7 @@ xbps_pkgdb_update(struct xbps_handle *xhp, bool flush, bool update)
 		return rv;
 
 	/* update copy in memory */
-	if ((xhp->pkgdb = xbps_dictionary_internalize_from_file(xhp->pkgdb_plist)) == NULL) {
+	if ((xhp->pkgdb = pkgdb_internalize(xhp->pkgdb_plist)) == NULL) {
 		rv = errno;
 		if (!rv)
 			rv = EINVAL;
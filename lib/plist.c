@@ -115,7 +115,12 @@ xbps_array_foreach_cb_multi(struct xbps_handle *xhp,
 	if (arraycount == 0)
 		return 0;
 
+#ifdef SINGLE_THREADED
+	/* proplib was built without locking */
+	maxthreads = 1;
+#else
 	maxthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
 	if (maxthreads <= 1 || arraycount <= 1) /* use single threaded routine */
 		return xbps_array_foreach_cb(xhp, array, dict, fn, arg);
 
@@ -190,21 +190,16 @@ xbps_repo_fetch_remote(struct xbps_repo *repo, const char *url)
 
 	while ((archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
 		const char *bfile;
-		char *buf;
 
 		bfile = archive_entry_pathname(entry);
 		if (bfile[0] == '.')
 			bfile++; /* skip first dot */
 
 		if (strcmp(bfile, XBPS_REPOIDX_META) == 0) {
-			buf = xbps_archive_get_file(a, entry);
-			repo->idxmeta = xbps_dictionary_internalize(buf);
-			free(buf);
+			repo->idxmeta = xbps_archive_get_dictionary_arena(a, entry);
 			i++;
 		} else if (strcmp(bfile, XBPS_REPOIDX) == 0) {
-			buf = xbps_archive_get_file(a, entry);
-			repo->idx = xbps_dictionary_internalize(buf);
-			free(buf);
+			repo->idx = xbps_archive_get_dictionary_arena(a, entry);
 			i++;
 		} else {
 			archive_read_data_skip(a);
@@ -32,6 +32,7 @@
 #ifndef _PROPLIB_PROP_DICTIONARY_H_
 #define	_PROPLIB_PROP_DICTIONARY_H_
 
+#include <sys/types.h>
 #include <stdint.h>
 #include <prop/prop_object.h>
 #include <prop/prop_array.h>
@@ -64,6 +65,16 @@ bool		prop_dictionary_set(prop_dictionary_t, const char *,
 				    prop_object_t);
 void		prop_dictionary_remove(prop_dictionary_t, const char *);
 
+bool		prop_dictionary_append(prop_dictionary_t, const char *,
+				       prop_object_t);
+void		prop_dictionary_seal(prop_dictionary_t);
+
+prop_dictionary_t prop_dictionary_create_lazy(unsigned int,
+			prop_object_t (*)(void *, const void *),
+			void (*)(void *), void *);
+bool		prop_dictionary_append_lazy(prop_dictionary_t, const char *,
+					    const void *);
+
 prop_object_t	prop_dictionary_get_keysym(prop_dictionary_t,
 					   prop_dictionary_keysym_t);
 bool		prop_dictionary_set_keysym(prop_dictionary_t,
@@ -76,12 +87,19 @@ bool		prop_dictionary_equals(prop_dictionary_t, prop_dictionary_t);
 
 char *		prop_dictionary_externalize(prop_dictionary_t);
 prop_dictionary_t prop_dictionary_internalize(const char *);
+prop_dictionary_t prop_dictionary_internalize_arena(const char *);
+prop_dictionary_t prop_dictionary_internalize_lazy(char *);
+prop_dictionary_t prop_dictionary_internalize_stream(
+			ssize_t (*)(void *, void *, size_t), void *);
+prop_dictionary_t prop_dictionary_internalize_stream_arena(
+			ssize_t (*)(void *, void *, size_t), void *);
 
 bool		prop_dictionary_externalize_to_file(prop_dictionary_t,
 						    const char *);
 bool		prop_dictionary_externalize_to_zfile(prop_dictionary_t,
 						     const char *);
 prop_dictionary_t prop_dictionary_internalize_from_file(const char *);
+prop_dictionary_t prop_dictionary_internalize_from_file_arena(const char *);
 prop_dictionary_t prop_dictionary_internalize_from_zfile(const char *);
 
 const char *	prop_dictionary_keysym_cstring_nocopy(prop_dictionary_keysym_t);
@@ -80,6 +80,21 @@ static const struct _prop_object_type _prop_object_type_array = {
 
 #define prop_array_is_immutable(x) (((x)->pa_flags & PA_F_IMMUTABLE) != 0)
 
+/*
+ * Immutable arrays never change again, so readers don't need to take
+ * the lock (nor can it change while a reader holds it).
+ */
+#define	_PA_RDLOCK(x)						\
+do {								\
+	if (!prop_array_is_immutable(x))			\
+		_PROP_RWLOCK_RDLOCK((x)->pa_rwlock);		\
+} while (/*CONSTCOND*/0)
+#define	_PA_RDUNLOCK(x)						\
+do {								\
+	if (!prop_array_is_immutable(x))			\
+		_PROP_RWLOCK_UNLOCK((x)->pa_rwlock);		\
+} while (/*CONSTCOND*/0)
+
 struct _prop_array_iterator {
 	struct _prop_object_iterator pai_base;
 	unsigned int		pai_index;
@@ -151,10 +166,10 @@ _prop_array_externalize(struct _prop_object_externalize_context *ctx,
 	unsigned int i;
 	bool rv = false;
 
-	_PROP_RWLOCK_RDLOCK(pa->pa_rwlock);
+	_PA_RDLOCK(pa);
 
 	if (pa->pa_count == 0) {
-		_PROP_RWLOCK_UNLOCK(pa->pa_rwlock);
+		_PA_RDUNLOCK(pa);
 		return (_prop_object_externalize_empty_tag(ctx, "array"));
 	}
 
@@ -190,7 +205,7 @@ _prop_array_externalize(struct _prop_object_externalize_context *ctx,
 	rv = true;
 
  out:
-	_PROP_RWLOCK_UNLOCK(pa->pa_rwlock);
+	_PA_RDUNLOCK(pa);
 	return (rv);
 }
 
@@ -214,11 +229,11 @@ _prop_array_equals(prop_object_t v1, prop_object_t v2,
 	/* For the first iteration, lock the objects. */
 	if (idx == 0) {
 		if ((uintptr_t)array1 < (uintptr_t)array2) {
-			_PROP_RWLOCK_RDLOCK(array1->pa_rwlock);
-			_PROP_RWLOCK_RDLOCK(array2->pa_rwlock);
+			_PA_RDLOCK(array1);
+			_PA_RDLOCK(array2);
 		} else {
-			_PROP_RWLOCK_RDLOCK(array2->pa_rwlock);
-			_PROP_RWLOCK_RDLOCK(array1->pa_rwlock);
+			_PA_RDLOCK(array2);
+			_PA_RDLOCK(array1);
 		}
 	}
 
@@ -239,20 +254,20 @@ _prop_array_equals(prop_object_t v1, prop_object_t v2,
 	return (_PROP_OBJECT_EQUALS_RECURSE);
 
  out:
-	_PROP_RWLOCK_UNLOCK(array1->pa_rwlock);
-	_PROP_RWLOCK_UNLOCK(array2->pa_rwlock);
+	_PA_RDUNLOCK(array1);
+	_PA_RDUNLOCK(array2);
 	return (rv);
 }
 
 static void
 _prop_array_equals_finish(prop_object_t v1, prop_object_t v2)
 {
-	_PROP_RWLOCK_UNLOCK(((prop_array_t)v1)->pa_rwlock);
-	_PROP_RWLOCK_UNLOCK(((prop_array_t)v2)->pa_rwlock);
+	_PA_RDUNLOCK((prop_array_t)v1);
+	_PA_RDUNLOCK((prop_array_t)v2);
 }
 
 static prop_array_t
-_prop_array_alloc(unsigned int capacity)
+_prop_array_alloc(unsigned int capacity, struct _prop_arena *arena)
 {
 	prop_array_t pa;
 	prop_object_t *array;
@@ -265,7 +280,7 @@ _prop_array_alloc(unsigned int capacity)
 	} else
 		array = NULL;
 
-	pa = _PROP_POOL_GET(_prop_array_pool);
+	pa = _PROP_POOL_GET_ARENA(_prop_array_pool, arena);
 	if (pa != NULL) {
 		_prop_object_init(&pa->pa_obj, &_prop_object_type_array);
 		pa->pa_obj.po_type = &_prop_object_type_array;
@@ -341,9 +356,9 @@ _prop_array_iterator_next_object(void *v)
 
 	_PROP_ASSERT(prop_object_is_array(pa));
 
-	_PROP_RWLOCK_RDLOCK(pa->pa_rwlock);
+	_PA_RDLOCK(pa);
 	po = _prop_array_iterator_next_object_locked(pai);
-	_PROP_RWLOCK_UNLOCK(pa->pa_rwlock);
+	_PA_RDUNLOCK(pa);
 	return (po);
 }
 
@@ -367,9 +382,9 @@ _prop_array_iterator_reset(void *v)
 
 	_PROP_ASSERT(prop_object_is_array(pa));
 
-	_PROP_RWLOCK_RDLOCK(pa->pa_rwlock);
+	_PA_RDLOCK(pa);
 	_prop_array_iterator_reset_locked(pai);
-	_PROP_RWLOCK_UNLOCK(pa->pa_rwlock);
+	_PA_RDUNLOCK(pa);
 }
 
 /*
@@ -380,7 +395,7 @@ prop_array_t
 prop_array_create(void)
 {
 
-	return (_prop_array_alloc(0));
+	return (_prop_array_alloc(0, NULL));
 }
 
 /*
@@ -391,7 +406,7 @@ prop_array_t
 prop_array_create_with_capacity(unsigned int capacity)
 {
 
-	return (_prop_array_alloc(capacity));
+	return (_prop_array_alloc(capacity, NULL));
 }
 
 /*
@@ -411,9 +426,9 @@ prop_array_copy(prop_array_t opa)
 	if (! prop_object_is_array(opa))
 		return (NULL);
 
-	_PROP_RWLOCK_RDLOCK(opa->pa_rwlock);
+	_PA_RDLOCK(opa);
 
-	pa = _prop_array_alloc(opa->pa_count);
+	pa = _prop_array_alloc(opa->pa_count, NULL);
 	if (pa != NULL) {
 		for (idx = 0; idx < opa->pa_count; idx++) {
 			po = opa->pa_array[idx];
@@ -423,7 +438,7 @@ prop_array_copy(prop_array_t opa)
 		pa->pa_count = opa->pa_count;
 		pa->pa_flags = opa->pa_flags;
 	}
-	_PROP_RWLOCK_UNLOCK(opa->pa_rwlock);
+	_PA_RDUNLOCK(opa);
 	return (pa);
 }
 
@@ -455,9 +470,9 @@ prop_array_capacity(prop_array_t pa)
 	if (! prop_object_is_array(pa))
 		return (0);
 
-	_PROP_RWLOCK_RDLOCK(pa->pa_rwlock);
+	_PA_RDLOCK(pa);
 	rv = pa->pa_capacity;
-	_PROP_RWLOCK_UNLOCK(pa->pa_rwlock);
+	_PA_RDUNLOCK(pa);
 
 	return (rv);
 }
@@ -474,9 +489,9 @@ prop_array_count(prop_array_t pa)
 	if (! prop_object_is_array(pa))
 		return (0);
 
-	_PROP_RWLOCK_RDLOCK(pa->pa_rwlock);
+	_PA_RDLOCK(pa);
 	rv = pa->pa_count;
-	_PROP_RWLOCK_UNLOCK(pa->pa_rwlock);
+	_PA_RDUNLOCK(pa);
 
 	return (rv);
 }
@@ -535,9 +550,9 @@ prop_array_iterator(prop_array_t pa)
 {
 	prop_object_iterator_t pi;
 
-	_PROP_RWLOCK_RDLOCK(pa->pa_rwlock);
+	_PA_RDLOCK(pa);
 	pi = _prop_array_iterator_locked(pa);
-	_PROP_RWLOCK_UNLOCK(pa->pa_rwlock);
+	_PA_RDUNLOCK(pa);
 	return (pi);
 }
 
@@ -564,9 +579,9 @@ prop_array_mutable(prop_array_t pa)
 {
 	bool rv;
 
-	_PROP_RWLOCK_RDLOCK(pa->pa_rwlock);
+	_PA_RDLOCK(pa);
 	rv = prop_array_is_immutable(pa) == false;
-	_PROP_RWLOCK_UNLOCK(pa->pa_rwlock);
+	_PA_RDUNLOCK(pa);
 
 	return (rv);
 }
@@ -583,13 +598,13 @@ prop_array_get(prop_array_t pa, unsigned int idx)
 	if (! prop_object_is_array(pa))
 		return (NULL);
 
-	_PROP_RWLOCK_RDLOCK(pa->pa_rwlock);
+	_PA_RDLOCK(pa);
 	if (idx >= pa->pa_count)
 		goto out;
 	po = pa->pa_array[idx];
 	_PROP_ASSERT(po != NULL);
  out:
-	_PROP_RWLOCK_UNLOCK(pa->pa_rwlock);
+	_PA_RDUNLOCK(pa);
 	return (po);
 }
 
@@ -833,7 +848,7 @@ _prop_array_internalize(prop_stack_t stack, prop_object_t *obj,
 	if (ctx->poic_tagattr != NULL)
 		return (true);
 
-	*obj = prop_array_create();
+	*obj = _prop_array_alloc(0, ctx->poic_arena);
 	/*
 	 * We are done if the create failed or no child elements exist.
 	 */
@@ -925,21 +940,11 @@ prop_array_internalize(const char *xml)
 bool
 prop_array_externalize_to_file(prop_array_t array, const char *fname)
 {
-	char *xml;
-	bool rv;
-	int save_errno = 0;	/* XXXGCC -Wuninitialized [mips, ...] */
 
-	xml = prop_array_externalize(array);
-	if (xml == NULL)
+	if (! prop_object_is_array(array))
 		return (false);
-	rv = _prop_object_externalize_write_file(fname, xml, strlen(xml), false);
-	if (rv == false)
-		save_errno = errno;
-	_PROP_FREE(xml, M_TEMP);
-	if (rv == false)
-		errno = save_errno;
 
-	return (rv);
+	return (_prop_object_externalize_to_file(array, fname));
 }
 
 /*
@@ -189,11 +189,11 @@ _prop_data_equals(prop_object_t v1, prop_object_t v2,
 }
 
 static prop_data_t
-_prop_data_alloc(void)
+_prop_data_alloc(struct _prop_arena *arena)
 {
 	prop_data_t pd;
 
-	pd = _PROP_POOL_GET(_prop_data_pool);
+	pd = _PROP_POOL_GET_ARENA(_prop_data_pool, arena);
 	if (pd != NULL) {
 		_prop_object_init(&pd->pd_obj, &_prop_object_type_data);
 
@@ -215,7 +215,7 @@ prop_data_create_data(const void *v, size_t size)
 	prop_data_t pd;
 	void *nv;
 
-	pd = _prop_data_alloc();
+	pd = _prop_data_alloc(NULL);
 	if (pd != NULL && size != 0) {
 		nv = _PROP_MALLOC(size, M_PROP_DATA);
 		if (nv == NULL) {
@@ -239,7 +239,7 @@ prop_data_create_data_nocopy(const void *v, size_t size)
 {
 	prop_data_t pd;
 	
-	pd = _prop_data_alloc();
+	pd = _prop_data_alloc(NULL);
 	if (pd != NULL) {
 		pd->pd_immutable = v;
 		pd->pd_size = size;
@@ -261,7 +261,7 @@ prop_data_copy(prop_data_t opd)
 	if (! prop_object_is_data(opd))
 		return (NULL);
 
-	pd = _prop_data_alloc();
+	pd = _prop_data_alloc(NULL);
 	if (pd != NULL) {
 		pd->pd_size = opd->pd_size;
 		pd->pd_flags = opd->pd_flags;
@@ -591,7 +591,7 @@ _prop_data_internalize(prop_stack_t stack, prop_object_t *obj,
 		return (true);
 	}
 
-	data = _prop_data_alloc();
+	data = _prop_data_alloc(ctx->poic_arena);
 	if (data == NULL) {
 		_PROP_FREE(buf, M_PROP_DATA);
 		return (true);
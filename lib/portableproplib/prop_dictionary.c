@@ -33,7 +33,6 @@
 #include <prop/prop_array.h>
 #include <prop/prop_dictionary.h>
 #include <prop/prop_string.h>
-#include "prop_rb_impl.h"
 
 #include <errno.h>
 
@@ -59,7 +58,8 @@
 struct _prop_dictionary_keysym {
 	struct _prop_object		pdk_obj;
 	size_t				pdk_size;
-	struct rb_node			pdk_link;
+	struct _prop_uniq_node		pdk_link;
+#define	pdk_hash	pdk_link.pun_hash
 	char 				pdk_key[1];
 	/* actually variable length */
 };
@@ -80,6 +80,11 @@ struct _prop_dict_entry {
 	prop_object_t			pde_objref;
 };
 
+struct _prop_dict_hslot {
+	prop_dictionary_keysym_t	pdh_key;	/* NULL if empty */
+	prop_object_t			pdh_objref;
+};
+
 struct _prop_dictionary {
 	struct _prop_object	pd_obj;
 	_PROP_RWLOCK_DECL(pd_rwlock)
@@ -89,9 +94,44 @@ struct _prop_dictionary {
 	int			pd_flags;
 
 	uint32_t		pd_version;
+
+	struct _prop_dict_hslot	*pd_hash;
+	unsigned int		pd_hashsize;	/* power of 2 */
+
+	uint32_t		*pd_sharecnt;	/* copies sharing pd_array */
+
+	struct _prop_dict_lazy_source *pd_lazy;	/* placeholders' source */
 };
 
 #define	PD_F_IMMUTABLE		0x01	/* dictionary is immutable */
+#define	PD_F_UNSORTED		0x02	/* has entries appended, not sealed */
+
+/*
+ * Large dictionaries (repository indexes, pkgdb) get an open addressing
+ * hash table, so that lookups by key don't have to binary search the
+ * whole array.  The sorted array still owns the entries; the hash table
+ * has the same key and value references, not positions in the array, so
+ * inserting or removing an entry only touches its own slot.  It is built
+ * once the dictionary reaches PD_HASH_MIN entries and kept up to date
+ * while it is modified.
+ */
+#define	PD_HASH_MIN		64
+
+/*
+ * Copies share the entries (pd_array and pd_hash) of the original
+ * dictionary until either of them is modified: pd_sharecnt counts the
+ * dictionaries using them, which own the references to the keys and
+ * values together.  The first modification of a shared dictionary makes
+ * it a private copy of the entries, unless it's the last one using them.
+ */
+
+/*
+ * Entries added with prop_dictionary_append() are sorted once when the
+ * dictionary is sealed: small arrays with an insertion sort, bigger ones
+ * with a merge sort; both are stable so the last appended value of a
+ * duplicated key can be told apart.
+ */
+#define	PD_SORT_MIN		16
 
 _PROP_POOL_INIT(_prop_dictionary_pool, sizeof(struct _prop_dictionary),
 		"propdict")
@@ -117,9 +157,6 @@ static prop_object_t
 static prop_object_t
 		_prop_dictionary_get(prop_dictionary_t, const char *, bool);
 
-static void _prop_dictionary_lock(void);
-static void _prop_dictionary_unlock(void);
-
 static const struct _prop_object_type _prop_object_type_dictionary = {
 	.pot_type		=	PROP_TYPE_DICTIONARY,
 	.pot_free		=	_prop_dictionary_free,
@@ -127,8 +164,6 @@ static const struct _prop_object_type _prop_object_type_dictionary = {
 	.pot_extern		=	_prop_dictionary_externalize,
 	.pot_equals		=	_prop_dictionary_equals,
 	.pot_equals_finish	=	_prop_dictionary_equals_finish,
-	.pot_lock 	        =       _prop_dictionary_lock,
-	.pot_unlock 	        =       _prop_dictionary_unlock,		
 };
 
 static _prop_object_free_rv_t
@@ -156,58 +191,381 @@ static const struct _prop_object_type _prop_object_type_dict_keysym = {
 #define	prop_dictionary_is_immutable(x)		\
 				(((x)->pd_flags & PD_F_IMMUTABLE) != 0)
 
+/*
+ * Immutable dictionaries never change again, so readers don't need
+ * to take the lock (nor can it change while a reader holds it).
+ * Dictionaries with appended entries are sealed before being read.
+ */
+#define	_PD_RDLOCK(x)						\
+do {								\
+	if (!prop_dictionary_is_immutable(x)) {			\
+		if (((x)->pd_flags & PD_F_UNSORTED) != 0)	\
+			prop_dictionary_seal(x);		\
+		_PROP_RWLOCK_RDLOCK((x)->pd_rwlock);		\
+	}							\
+} while (/*CONSTCOND*/0)
+#define	_PD_RDUNLOCK(x)						\
+do {								\
+	if (!prop_dictionary_is_immutable(x))			\
+		_PROP_RWLOCK_UNLOCK((x)->pd_rwlock);		\
+} while (/*CONSTCOND*/0)
+
 struct _prop_dictionary_iterator {
 	struct _prop_object_iterator pdi_base;
 	unsigned int		pdi_index;
 };
 
 /*
- * Dictionary key symbols are immutable, and we are likely to have many
- * duplicated key symbols.  So, to save memory, we unique'ify key symbols
- * so we only have to have one copy of each string.
+ * Lazily internalized dictionaries only parse the top level keys, every
+ * value is a placeholder pointing to its start tag in the XML buffer and
+ * is replaced by the real object the first time it's looked up.  The XML
+ * buffer is shared by all placeholders and released with the last one.
+ *
+ * Readers of immutable and shared dictionaries don't take the dictionary
+ * lock, so the entries are only replaced under pls_mtx and published
+ * with an atomic store.  The dictionary (and its copies) keeps its own
+ * reference to the source: placeholders live in its arena, which never
+ * reuses their memory, so a stale pointer to a placeholder that was just
+ * replaced is still safe to check until the dictionary goes away.
+ *
+ * Dictionaries created with prop_dictionary_create_lazy() get their
+ * values from a decoder instead, which is passed the cookie of the
+ * source and the argument of the placeholder.
  */
+struct _prop_dict_lazy_source {
+	char			*pls_xml;
+	struct _prop_arena	*pls_arena;
+	struct _prop_string_intern *pls_intern;
+	prop_object_t		(*pls_decode)(void *, const void *);
+	void			(*pls_fini)(void *);
+	void			*pls_cookie;
+	uint32_t		pls_refcnt;
+	_PROP_MUTEX_DECL(pls_mtx)
+};
 
-static int
-/*ARGSUSED*/
-_prop_dict_keysym_rb_compare_nodes(void *ctx _PROP_ARG_UNUSED,
-				   const void *n1, const void *n2)
+struct _prop_dict_lazy_object {
+	struct _prop_object	plo_obj;
+	struct _prop_dict_lazy_source *plo_src;
+	const void		*plo_start;	/* XML or decoder argument */
+};
+
+_PROP_POOL_INIT(_prop_dict_lazy_pool, sizeof(struct _prop_dict_lazy_object),
+		"pdictlzy")
+
+static _prop_object_free_rv_t
+		_prop_dict_lazy_free(prop_stack_t, prop_object_t *);
+
+static const struct _prop_object_type _prop_object_type_dict_lazy = {
+	.pot_type	=	PROP_TYPE_UNKNOWN,
+	.pot_free	=	_prop_dict_lazy_free,
+};
+
+#define	prop_object_is_dict_lazy(x)			(((struct _prop_object *)(x))->po_type == &_prop_object_type_dict_lazy)
+
+/*
+ * _prop_dict_hash --
+ *	FNV-1a hash of a key.
+ */
+static uint32_t
+_prop_dict_hash(const char *key)
+{
+	const unsigned char *cp = (const unsigned char *)key;
+	uint32_t h = 2166136261U;
+
+	while (*cp != '\0') {
+		h ^= *cp++;
+		h *= 16777619U;
+	}
+	return (h);
+}
+
+static void
+_prop_dict_hash_insert(prop_dictionary_t pd, prop_dictionary_keysym_t pdk,
+		       prop_object_t po)
+{
+	unsigned int mask = pd->pd_hashsize - 1;
+	unsigned int i;
+
+	/*
+	 * Dictionary must be WRITE-LOCKED.
+	 */
+
+	for (i = pdk->pdk_hash & mask;
+	     pd->pd_hash[i].pdh_key != NULL; i = (i + 1) & mask)
+		continue;
+	pd->pd_hash[i].pdh_key = pdk;
+	pd->pd_hash[i].pdh_objref = po;
+}
+
+/*
+ * _prop_dict_hash_find --
+ *	Return the slot of the hash table with the specified key, or
+ *	NULL if there's none.
+ */
+static struct _prop_dict_hslot *
+_prop_dict_hash_find(prop_dictionary_t pd, const char *key)
+{
+	struct _prop_dict_hslot *pdh;
+	uint32_t h = _prop_dict_hash(key);
+	unsigned int mask = pd->pd_hashsize - 1;
+	unsigned int i;
+
+	/*
+	 * Dictionary must be READ-LOCKED or WRITE-LOCKED.
+	 */
+
+	for (i = h & mask; pd->pd_hash[i].pdh_key != NULL; i = (i + 1) & mask) {
+		pdh = &pd->pd_hash[i];
+		if (pdh->pdh_key->pdk_hash == h &&
+		    strcmp(key, pdh->pdh_key->pdk_key) == 0)
+			return (pdh);
+	}
+	return (NULL);
+}
+
+/*
+ * _prop_dict_hash_slot --
+ *	Return the index of the slot of the hash table with the specified
+ *	keysym, which must be in the dictionary.
+ */
+static unsigned int
+_prop_dict_hash_slot(prop_dictionary_t pd, prop_dictionary_keysym_t pdk)
+{
+	unsigned int mask = pd->pd_hashsize - 1;
+	unsigned int i;
+
+	/* Keysyms are unique'd, comparing pointers is enough. */
+	for (i = pdk->pdk_hash & mask; pd->pd_hash[i].pdh_key != pdk;
+	     i = (i + 1) & mask)
+		_PROP_ASSERT(pd->pd_hash[i].pdh_key != NULL);
+	return (i);
+}
+
+static bool
+_prop_dict_hash_rebuild(prop_dictionary_t pd)
+{
+	struct _prop_dict_hslot *hash;
+	unsigned int size, idx;
+
+	/*
+	 * Dictionary must be WRITE-LOCKED.
+	 *
+	 * Keep the load factor under 1/2 so that probe sequences
+	 * stay short.
+	 */
+
+	for (size = PD_HASH_MIN * 2; size < pd->pd_count * 2; size <<= 1)
+		continue;
+
+	hash = _PROP_CALLOC(size * sizeof(*hash), M_PROP_DICT);
+	if (hash == NULL)
+		return (false);
+	if (pd->pd_hash != NULL)
+		_PROP_FREE(pd->pd_hash, M_PROP_DICT);
+	pd->pd_hash = hash;
+	pd->pd_hashsize = size;
+
+	for (idx = 0; idx < pd->pd_count; idx++)
+		_prop_dict_hash_insert(pd, pd->pd_array[idx].pde_key,
+		    pd->pd_array[idx].pde_objref);
+
+	return (true);
+}
+
+static void
+_prop_dict_hash_discard(prop_dictionary_t pd)
 {
-	const struct _prop_dictionary_keysym *pdk1 = n1;
-	const struct _prop_dictionary_keysym *pdk2 = n2;
 
-	return strcmp(pdk1->pdk_key, pdk2->pdk_key);
+	if (pd->pd_hash != NULL) {
+		_PROP_FREE(pd->pd_hash, M_PROP_DICT);
+		pd->pd_hash = NULL;
+		pd->pd_hashsize = 0;
+	}
+}
+
+/*
+ * _prop_dict_hash_update --
+ *	Update the hash table after a new entry has been stored at
+ *	index idx of pd_array.
+ */
+static void
+_prop_dict_hash_update(prop_dictionary_t pd, unsigned int idx)
+{
+
+	/*
+	 * Dictionary must be WRITE-LOCKED.
+	 */
+
+	if (pd->pd_count < PD_HASH_MIN)
+		return;
+
+	if (pd->pd_hash == NULL || pd->pd_count * 2 > pd->pd_hashsize) {
+		/* If we cannot allocate it, we just fall back to bsearch. */
+		if (!_prop_dict_hash_rebuild(pd))
+			_prop_dict_hash_discard(pd);
+		return;
+	}
+	_prop_dict_hash_insert(pd, pd->pd_array[idx].pde_key,
+	    pd->pd_array[idx].pde_objref);
+}
+
+/*
+ * _prop_dict_hash_remove --
+ *	Remove the slot of a keysym from the hash table.
+ */
+static void
+_prop_dict_hash_remove(prop_dictionary_t pd, prop_dictionary_keysym_t pdk)
+{
+	unsigned int mask = pd->pd_hashsize - 1;
+	unsigned int i, j, k;
+
+	/*
+	 * Dictionary must be WRITE-LOCKED.
+	 *
+	 * Linear probing: move back the slots after the removed one
+	 * that would not be found anymore, rather than leaving a
+	 * tombstone.
+	 */
+
+	i = _prop_dict_hash_slot(pd, pdk);
+	for (j = (i + 1) & mask; pd->pd_hash[j].pdh_key != NULL;
+	     j = (j + 1) & mask) {
+		k = pd->pd_hash[j].pdh_key->pdk_hash & mask;
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		pd->pd_hash[i] = pd->pd_hash[j];
+		i = j;
+	}
+	pd->pd_hash[i].pdh_key = NULL;
+	pd->pd_hash[i].pdh_objref = NULL;
 }
 
 static int
-/*ARGSUSED*/
-_prop_dict_keysym_rb_compare_key(void *ctx _PROP_ARG_UNUSED,
-				 const void *n, const void *v)
+_prop_dict_entry_compare(const struct _prop_dict_entry *pde1,
+			 const struct _prop_dict_entry *pde2)
 {
-	const struct _prop_dictionary_keysym *pdk = n;
-	const char *cp = v;
 
-	return strcmp(pdk->pdk_key, cp);
+	/* Keysyms are unique'd, equal keys are the same object. */
+	if (pde1->pde_key == pde2->pde_key)
+		return (0);
+	return (strcmp(pde1->pde_key->pdk_key, pde2->pde_key->pdk_key));
 }
 
-static const rb_tree_ops_t _prop_dict_keysym_rb_tree_ops = {
-	.rbto_compare_nodes = _prop_dict_keysym_rb_compare_nodes,
-	.rbto_compare_key = _prop_dict_keysym_rb_compare_key,
-	.rbto_node_offset = offsetof(struct _prop_dictionary_keysym, pdk_link),
-	.rbto_context = NULL
-};
+static void
+_prop_dict_insertion_sort(struct _prop_dict_entry *array, unsigned int n)
+{
+	struct _prop_dict_entry pde;
+	unsigned int i, j;
+
+	for (i = 1; i < n; i++) {
+		pde = array[i];
+		for (j = i; j > 0 &&
+		     _prop_dict_entry_compare(&array[j - 1], &pde) > 0; j--)
+			array[j] = array[j - 1];
+		array[j] = pde;
+	}
+}
 
-static struct rb_tree _prop_dict_keysym_tree;
+/*
+ * _prop_dict_merge_sort --
+ *	Stable sort of n entries; tmp must have room for n / 2 entries.
+ */
+static void
+_prop_dict_merge_sort(struct _prop_dict_entry *array,
+		      struct _prop_dict_entry *tmp, unsigned int n)
+{
+	unsigned int i, j, k, half;
+
+	if (n <= PD_SORT_MIN) {
+		_prop_dict_insertion_sort(array, n);
+		return;
+	}
+	half = n / 2;
+	_prop_dict_merge_sort(array, tmp, half);
+	_prop_dict_merge_sort(array + half, tmp, n - half);
+	if (_prop_dict_entry_compare(&array[half - 1], &array[half]) <= 0)
+		return;
+
+	/* Merge the saved left half with the right half in place. */
+	memcpy(tmp, array, half * sizeof(*tmp));
+	for (i = 0, j = half, k = 0; i < half && j < n; k++) {
+		if (_prop_dict_entry_compare(&array[j], &tmp[i]) < 0)
+			array[k] = array[j++];
+		else
+			array[k] = tmp[i++];
+	}
+	while (i < half)
+		array[k++] = tmp[i++];
+}
+
+/*
+ * _prop_dictionary_seal_locked --
+ *	Sort the entries of a dictionary that had entries appended out
+ *	of order and drop duplicated keys, keeping the value appended last.
+ */
+static void
+_prop_dictionary_seal_locked(prop_dictionary_t pd)
+{
+	struct _prop_dict_entry *array = pd->pd_array, *tmp;
+	unsigned int i, n;
+
+	/*
+	 * Dictionary must be WRITE-LOCKED.
+	 */
+
+	if ((pd->pd_flags & PD_F_UNSORTED) == 0)
+		return;
+	pd->pd_flags &= ~PD_F_UNSORTED;
+
+	tmp = NULL;
+	if (pd->pd_count > PD_SORT_MIN)
+		tmp = _PROP_MALLOC((pd->pd_count / 2) * sizeof(*tmp), M_TEMP);
+	if (tmp != NULL) {
+		_prop_dict_merge_sort(array, tmp, pd->pd_count);
+		_PROP_FREE(tmp, M_TEMP);
+	} else
+		_prop_dict_insertion_sort(array, pd->pd_count);
+
+	for (i = 0, n = 0; i < pd->pd_count; i++) {
+		if (i + 1 < pd->pd_count &&
+		    array[i].pde_key == array[i + 1].pde_key) {
+			prop_object_release(array[i].pde_key);
+			prop_object_release(array[i].pde_objref);
+			continue;
+		}
+		array[n++] = array[i];
+	}
+	pd->pd_count = n;
+
+	pd->pd_version++;
+	if (pd->pd_count < PD_HASH_MIN || !_prop_dict_hash_rebuild(pd))
+		_prop_dict_hash_discard(pd);
+}
+
+/*
+ * Dictionary key symbols are immutable, and we are likely to have many
+ * duplicated key symbols.  So, to save memory, we unique'ify key symbols
+ * so we only have to have one copy of each string.
+ */
+
+static bool
+_prop_dict_keysym_match(const void *v, const void *key)
+{
+	const struct _prop_dictionary_keysym *pdk = v;
+
+	return (strcmp(pdk->pdk_key, key) == 0);
+}
+
+static struct _prop_uniq_table _prop_dict_keysym_table;
 
 _PROP_ONCE_DECL(_prop_dict_init_once)
-_PROP_MUTEX_DECL_STATIC(_prop_dict_keysym_tree_mutex)
 
 static int
 _prop_dict_init(void)
 {
 
-	_PROP_MUTEX_INIT(_prop_dict_keysym_tree_mutex);
-	_prop_rb_tree_init(&_prop_dict_keysym_tree,
-			   &_prop_dict_keysym_rb_tree_ops);
+	_prop_uniq_init(&_prop_dict_keysym_table, _prop_dict_keysym_match,
+	    offsetof(struct _prop_dictionary_keysym, pdk_link));
 	return 0;
 }
 
@@ -231,7 +589,7 @@ _prop_dict_keysym_free(prop_stack_t stack, prop_object_t *obj)
 {
 	prop_dictionary_keysym_t pdk = *obj;
 
-	_prop_rb_tree_remove_node(&_prop_dict_keysym_tree, pdk);
+	_prop_uniq_remove(&_prop_dict_keysym_table, pdk);
 	_prop_dict_keysym_put(pdk);
 
 	return _PROP_OBJECT_FREE_DONE;
@@ -278,26 +636,23 @@ _prop_dict_keysym_equals(prop_object_t v1, prop_object_t v2,
 static prop_dictionary_keysym_t
 _prop_dict_keysym_alloc(const char *key)
 {
-	prop_dictionary_keysym_t opdk, pdk, rpdk;
+	prop_dictionary_keysym_t opdk, pdk;
+	uint32_t hash;
 	size_t size;
 
 	_PROP_ONCE_RUN(_prop_dict_init_once, _prop_dict_init);
 
 	/*
-	 * Check to see if this already exists in the tree.  If it does,
+	 * Check to see if this already exists in the table.  If it does,
 	 * we just retain it and return it.
 	 */
-	_PROP_MUTEX_LOCK(_prop_dict_keysym_tree_mutex);
-	opdk = _prop_rb_tree_find(&_prop_dict_keysym_tree, key);
-	if (opdk != NULL) {
-		prop_object_retain(opdk);
-		_PROP_MUTEX_UNLOCK(_prop_dict_keysym_tree_mutex);
+	hash = _prop_dict_hash(key);
+	opdk = _prop_uniq_find(&_prop_dict_keysym_table, hash, key);
+	if (opdk != NULL)
 		return (opdk);
-	}
-	_PROP_MUTEX_UNLOCK(_prop_dict_keysym_tree_mutex);
 
 	/*
-	 * Not in the tree.  Create it now.
+	 * Not in the table.  Create it now.
 	 */
 
 	size = sizeof(*pdk) + strlen(key) /* pdk_key[1] covers the NUL */;
@@ -318,23 +673,105 @@ _prop_dict_keysym_alloc(const char *key)
 
 	strcpy(pdk->pdk_key, key);
 	pdk->pdk_size = size;
+	pdk->pdk_hash = hash;
 
 	/*
-	 * We dropped the mutex when we allocated the new object, so
-	 * we have to check again if it is in the tree.
+	 * Another thread may have inserted the same key meanwhile,
+	 * in that case use theirs.
 	 */
-	_PROP_MUTEX_LOCK(_prop_dict_keysym_tree_mutex);
-	opdk = _prop_rb_tree_find(&_prop_dict_keysym_tree, key);
-	if (opdk != NULL) {
-		prop_object_retain(opdk);
-		_PROP_MUTEX_UNLOCK(_prop_dict_keysym_tree_mutex);
+	opdk = _prop_uniq_insert(&_prop_dict_keysym_table, pdk, key);
+	if (opdk != pdk)
 		_prop_dict_keysym_put(pdk);
-		return (opdk);
+	return (opdk);
+}
+
+static void
+_prop_dict_lazy_source_release(struct _prop_dict_lazy_source *pls)
+{
+	uint32_t ocnt;
+
+	_PROP_ATOMIC_DEC32_NV(&pls->pls_refcnt, ocnt);
+	if (ocnt != 0)
+		return;
+
+	if (pls->pls_xml != NULL)
+		_PROP_FREE(pls->pls_xml, M_TEMP);
+	if (pls->pls_fini != NULL)
+		(*pls->pls_fini)(pls->pls_cookie);
+	if (pls->pls_intern != NULL)
+		_prop_string_intern_destroy(pls->pls_intern);
+	_prop_arena_release(pls->pls_arena);
+	_PROP_MUTEX_DESTROY(pls->pls_mtx);
+	_PROP_FREE(pls, M_TEMP);
+}
+
+/* ARGSUSED */
+static _prop_object_free_rv_t
+_prop_dict_lazy_free(prop_stack_t stack _PROP_ARG_UNUSED, prop_object_t *obj)
+{
+	struct _prop_dict_lazy_object *plo = *obj;
+	struct _prop_dict_lazy_source *pls = plo->plo_src;
+
+	/* The source holds the arena the placeholder lives in. */
+	_PROP_POOL_PUT(_prop_dict_lazy_pool, plo);
+	_prop_dict_lazy_source_release(pls);
+
+	return (_PROP_OBJECT_FREE_DONE);
+}
+
+/*
+ * _prop_dict_lazy_resolve --
+ *	Internalize the value of a dictionary entry that still refers to
+ *	a placeholder, and store it in the entry.  Returns NULL if the
+ *	value couldn't be parsed.
+ */
+static prop_object_t
+_prop_dict_lazy_resolve(prop_dictionary_t pd, struct _prop_dict_entry *pde)
+{
+	struct _prop_dict_lazy_source *pls = pd->pd_lazy;
+	struct _prop_dict_lazy_object *plo;
+	struct _prop_object_internalize_context *ctx;
+	prop_object_t po;
+
+	_PROP_ASSERT(pls != NULL);
+
+	_PROP_MUTEX_LOCK(pls->pls_mtx);
+	/* Another reader could have won the race. */
+	_PROP_ATOMIC_LOAD_PTR(&pde->pde_objref, po);
+	if (!prop_object_is_dict_lazy(po)) {
+		_PROP_MUTEX_UNLOCK(pls->pls_mtx);
+		return (po);
+	}
+	plo = po;
+	_PROP_ASSERT(plo->plo_src == pls);
+	po = NULL;
+	if (pls->pls_decode != NULL)
+		po = (*pls->pls_decode)(pls->pls_cookie, plo->plo_start);
+	else if ((ctx = _prop_object_internalize_context_alloc(
+	    plo->plo_start)) != NULL) {
+		ctx->poic_arena = pls->pls_arena;
+		ctx->poic_intern = pls->pls_intern;
+		if (_prop_object_internalize_find_tag(ctx, NULL,
+		    _PROP_TAG_TYPE_START))
+			po = _prop_object_internalize_by_tag(ctx);
+		/* The arena and intern table are owned by the source. */
+		ctx->poic_arena = NULL;
+		ctx->poic_intern = NULL;
+		_prop_object_internalize_context_free(ctx);
+	}
+	if (po != NULL) {
+		if (pd->pd_hash != NULL)
+			_PROP_ATOMIC_STORE_PTR(&pd->pd_hash[_prop_dict_hash_slot(
+			    pd, pde->pde_key)].pdh_objref, po);
+		_PROP_ATOMIC_STORE_PTR(&pde->pde_objref, po);
 	}
-	rpdk = _prop_rb_tree_insert_node(&_prop_dict_keysym_tree, pdk);
-	_PROP_ASSERT(rpdk == pdk);
-	_PROP_MUTEX_UNLOCK(_prop_dict_keysym_tree_mutex);
-	return (rpdk);
+	_PROP_MUTEX_UNLOCK(pls->pls_mtx);
+
+	/* This may release the source as well. */
+	if (po != NULL)
+		prop_object_release(plo);
+
+	return (po);
 }
 
 static _prop_object_free_rv_t
@@ -348,10 +785,33 @@ _prop_dictionary_free(prop_stack_t stack, prop_object_t *obj)
 	_PROP_ASSERT((pd->pd_capacity == 0 && pd->pd_array == NULL) ||
 		     (pd->pd_capacity != 0 && pd->pd_array != NULL));
 
+	/*
+	 * Entries shared with copies are only released by the last
+	 * dictionary using them.
+	 */
+	if (pd->pd_sharecnt != NULL) {
+		uint32_t ncnt;
+
+		_PROP_ATOMIC_DEC32_NV(pd->pd_sharecnt, ncnt);
+		if (ncnt == 0)
+			_PROP_FREE(pd->pd_sharecnt, M_TEMP);
+		else {
+			pd->pd_array = NULL;
+			pd->pd_capacity = 0;
+			pd->pd_count = 0;
+			pd->pd_hash = NULL;
+		}
+		pd->pd_sharecnt = NULL;
+	}
+
 	/* The empty dictorinary is easy, handle that first. */
 	if (pd->pd_count == 0) {
 		if (pd->pd_array != NULL)
 			_PROP_FREE(pd->pd_array, M_PROP_DICT);
+		if (pd->pd_hash != NULL)
+			_PROP_FREE(pd->pd_hash, M_PROP_DICT);
+		if (pd->pd_lazy != NULL)
+			_prop_dict_lazy_source_release(pd->pd_lazy);
 
 		_PROP_RWLOCK_DESTROY(pd->pd_rwlock);
 
@@ -388,22 +848,6 @@ _prop_dictionary_free(prop_stack_t stack, prop_object_t *obj)
 	return (_PROP_OBJECT_FREE_RECURSE);
 }
 
-
-static void
-_prop_dictionary_lock(void)
-{
-
-	/* XXX: once necessary or paranoia? */
-	_PROP_ONCE_RUN(_prop_dict_init_once, _prop_dict_init);
-	_PROP_MUTEX_LOCK(_prop_dict_keysym_tree_mutex);
-}
-
-static void
-_prop_dictionary_unlock(void)
-{
-	_PROP_MUTEX_UNLOCK(_prop_dict_keysym_tree_mutex);
-}
-
 static void
 _prop_dictionary_emergency_free(prop_object_t obj)
 {
@@ -429,10 +873,10 @@ _prop_dictionary_externalize(struct _prop_object_externalize_context *ctx,
 	unsigned int i;
 	bool rv = false;
 
-	_PROP_RWLOCK_RDLOCK(pd->pd_rwlock);
+	_PD_RDLOCK(pd);
 
 	if (pd->pd_count == 0) {
-		_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+		_PD_RDUNLOCK(pd);
 		return (_prop_object_externalize_empty_tag(ctx, "dict"));
 	}
 
@@ -474,7 +918,7 @@ _prop_dictionary_externalize(struct _prop_object_externalize_context *ctx,
 	rv = true;
 
  out:
-	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+	_PD_RDUNLOCK(pd);
 	return (rv);
 }
 
@@ -498,18 +942,19 @@ _prop_dictionary_equals(prop_object_t v1, prop_object_t v2,
 
 	if (idx == 0) {
 		if ((uintptr_t)dict1 < (uintptr_t)dict2) {
-			_PROP_RWLOCK_RDLOCK(dict1->pd_rwlock);
-			_PROP_RWLOCK_RDLOCK(dict2->pd_rwlock);
+			_PD_RDLOCK(dict1);
+			_PD_RDLOCK(dict2);
 		} else {
-			_PROP_RWLOCK_RDLOCK(dict2->pd_rwlock);
-			_PROP_RWLOCK_RDLOCK(dict1->pd_rwlock);
+			_PD_RDLOCK(dict2);
+			_PD_RDLOCK(dict1);
 		}
 	}
 
 	if (dict1->pd_count != dict2->pd_count)
 		goto out;
 
-	if (idx == dict1->pd_count) {
+	/* Copies that weren't modified share their entries. */
+	if (idx == dict1->pd_count || dict1->pd_array == dict2->pd_array) {
 		rv = _PROP_OBJECT_EQUALS_TRUE;
 		goto out;
 	}
@@ -519,30 +964,37 @@ _prop_dictionary_equals(prop_object_t v1, prop_object_t v2,
 	*stored_pointer1 = (void *)(idx + 1);
 	*stored_pointer2 = (void *)(idx + 1);
 
-	*next_obj1 = dict1->pd_array[idx].pde_objref;
-	*next_obj2 = dict2->pd_array[idx].pde_objref;
+	_PROP_ATOMIC_LOAD_PTR(&dict1->pd_array[idx].pde_objref, *next_obj1);
+	_PROP_ATOMIC_LOAD_PTR(&dict2->pd_array[idx].pde_objref, *next_obj2);
 
 	if (!prop_dictionary_keysym_equals(dict1->pd_array[idx].pde_key,
 					   dict2->pd_array[idx].pde_key))
 		goto out;
 
+	if (prop_object_is_dict_lazy(*next_obj1) &&
+	    (*next_obj1 = _prop_dict_lazy_resolve(dict1, &dict1->pd_array[idx])) == NULL)
+		goto out;
+	if (prop_object_is_dict_lazy(*next_obj2) &&
+	    (*next_obj2 = _prop_dict_lazy_resolve(dict2, &dict2->pd_array[idx])) == NULL)
+		goto out;
+
 	return (_PROP_OBJECT_EQUALS_RECURSE);
 
  out:
- 	_PROP_RWLOCK_UNLOCK(dict1->pd_rwlock);
-	_PROP_RWLOCK_UNLOCK(dict2->pd_rwlock);
+ 	_PD_RDUNLOCK(dict1);
+	_PD_RDUNLOCK(dict2);
 	return (rv);
 }
 
 static void
 _prop_dictionary_equals_finish(prop_object_t v1, prop_object_t v2)
 {
- 	_PROP_RWLOCK_UNLOCK(((prop_dictionary_t)v1)->pd_rwlock);
- 	_PROP_RWLOCK_UNLOCK(((prop_dictionary_t)v2)->pd_rwlock);
+	_PD_RDUNLOCK((prop_dictionary_t)v1);
+	_PD_RDUNLOCK((prop_dictionary_t)v2);
 }
 
 static prop_dictionary_t
-_prop_dictionary_alloc(unsigned int capacity)
+_prop_dictionary_alloc(unsigned int capacity, struct _prop_arena *arena)
 {
 	prop_dictionary_t pd;
 	struct _prop_dict_entry *array;
@@ -554,7 +1006,7 @@ _prop_dictionary_alloc(unsigned int capacity)
 	} else
 		array = NULL;
 
-	pd = _PROP_POOL_GET(_prop_dictionary_pool);
+	pd = _PROP_POOL_GET_ARENA(_prop_dictionary_pool, arena);
 	if (pd != NULL) {
 		_prop_object_init(&pd->pd_obj, &_prop_object_type_dictionary);
 
@@ -565,6 +1017,13 @@ _prop_dictionary_alloc(unsigned int capacity)
 		pd->pd_flags = 0;
 
 		pd->pd_version = 0;
+
+		pd->pd_hash = NULL;
+		pd->pd_hashsize = 0;
+
+		pd->pd_sharecnt = NULL;
+
+		pd->pd_lazy = NULL;
 	} else if (array != NULL)
 		_PROP_FREE(array, M_PROP_DICT);
 
@@ -596,6 +1055,83 @@ _prop_dictionary_expand(prop_dictionary_t pd, unsigned int capacity)
 	return (true);
 }
 
+/*
+ * _prop_dictionary_unshare --
+ *	Make sure the dictionary doesn't share its entries with a copy
+ *	before modifying them.
+ */
+static bool
+_prop_dictionary_unshare(prop_dictionary_t pd)
+{
+	struct _prop_dict_entry *array, *oarray = pd->pd_array;
+	struct _prop_dict_hslot *hash = NULL, *ohash = pd->pd_hash;
+	unsigned int idx;
+	uint32_t cnt, ncnt;
+
+	/*
+	 * Dictionary must be WRITE-LOCKED.
+	 */
+
+	if (pd->pd_sharecnt == NULL)
+		return (true);
+
+	/*
+	 * Immutable dictionaries sharing the entries are copied without
+	 * their lock, but the count can't go up from 1: there's no other
+	 * dictionary left to copy them from, so the entries are ours.
+	 */
+	_PROP_ATOMIC_LOAD32(pd->pd_sharecnt, cnt);
+	if (cnt == 1) {
+		_PROP_FREE(pd->pd_sharecnt, M_TEMP);
+		pd->pd_sharecnt = NULL;
+		return (true);
+	}
+
+	array = _PROP_MALLOC(pd->pd_capacity * sizeof(*array), M_PROP_DICT);
+	if (array == NULL)
+		return (false);
+	/* Without the hash table lookups fall back to bsearch. */
+	if (ohash != NULL)
+		hash = _PROP_MALLOC(pd->pd_hashsize * sizeof(*hash),
+		    M_PROP_DICT);
+	/*
+	 * Readers of the other copies may be resolving placeholders in
+	 * the shared entries; take a consistent snapshot of them.
+	 */
+	if (pd->pd_lazy != NULL)
+		_PROP_MUTEX_LOCK(pd->pd_lazy->pls_mtx);
+	memcpy(array, oarray, pd->pd_count * sizeof(*array));
+	for (idx = 0; idx < pd->pd_count; idx++) {
+		prop_object_retain(array[idx].pde_key);
+		prop_object_retain(array[idx].pde_objref);
+	}
+	if (hash != NULL)
+		memcpy(hash, ohash, pd->pd_hashsize * sizeof(*hash));
+	if (pd->pd_lazy != NULL)
+		_PROP_MUTEX_UNLOCK(pd->pd_lazy->pls_mtx);
+
+	_PROP_ATOMIC_DEC32_NV(pd->pd_sharecnt, ncnt);
+	if (ncnt == 0) {
+		/* The other copies went away meanwhile. */
+		for (idx = 0; idx < pd->pd_count; idx++) {
+			prop_object_release(oarray[idx].pde_key);
+			prop_object_release(oarray[idx].pde_objref);
+		}
+		_PROP_FREE(oarray, M_PROP_DICT);
+		if (ohash != NULL)
+			_PROP_FREE(ohash, M_PROP_DICT);
+		_PROP_FREE(pd->pd_sharecnt, M_TEMP);
+	}
+
+	pd->pd_array = array;
+	pd->pd_hash = hash;
+	if (hash == NULL)
+		pd->pd_hashsize = 0;
+	pd->pd_sharecnt = NULL;
+
+	return (true);
+}
+
 static prop_object_t
 _prop_dictionary_iterator_next_object_locked(void *v)
 {
@@ -629,9 +1165,9 @@ _prop_dictionary_iterator_next_object(void *v)
 
 	_PROP_ASSERT(prop_object_is_dictionary(pd));
 
-	_PROP_RWLOCK_RDLOCK(pd->pd_rwlock);
+	_PD_RDLOCK(pd);
 	pdk = _prop_dictionary_iterator_next_object_locked(pdi);
-	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+	_PD_RDUNLOCK(pd);
 	return (pdk);
 }
 
@@ -653,9 +1189,9 @@ _prop_dictionary_iterator_reset(void *v)
 	struct _prop_dictionary_iterator *pdi = v;
 	prop_dictionary_t pd _PROP_ARG_UNUSED = pdi->pdi_base.pi_obj;
 
-	_PROP_RWLOCK_RDLOCK(pd->pd_rwlock);
+	_PD_RDLOCK(pd);
 	_prop_dictionary_iterator_reset_locked(pdi);
-	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+	_PD_RDUNLOCK(pd);
 }
 
 /*
@@ -666,7 +1202,7 @@ prop_dictionary_t
 prop_dictionary_create(void)
 {
 
-	return (_prop_dictionary_alloc(0));
+	return (_prop_dictionary_alloc(0, NULL));
 }
 
 /*
@@ -677,45 +1213,83 @@ prop_dictionary_t
 prop_dictionary_create_with_capacity(unsigned int capacity)
 {
 
-	return (_prop_dictionary_alloc(capacity));
+	return (_prop_dictionary_alloc(capacity, NULL));
+}
+
+/*
+ * _prop_dictionary_share --
+ *	Make the new dictionary pd use the entries of opd.  The entries
+ *	of opd must already be shared, unless it's empty.
+ */
+static void
+_prop_dictionary_share(prop_dictionary_t pd, prop_dictionary_t opd)
+{
+
+	if (opd->pd_count != 0) {
+		_PROP_ATOMIC_INC32(opd->pd_sharecnt);
+
+		pd->pd_array = opd->pd_array;
+		pd->pd_capacity = opd->pd_capacity;
+		pd->pd_count = opd->pd_count;
+		pd->pd_hash = opd->pd_hash;
+		pd->pd_hashsize = opd->pd_hashsize;
+		pd->pd_sharecnt = opd->pd_sharecnt;
+		if ((pd->pd_lazy = opd->pd_lazy) != NULL)
+			_PROP_ATOMIC_INC32(&pd->pd_lazy->pls_refcnt);
+	}
+	pd->pd_flags = opd->pd_flags;
 }
 
 /*
  * prop_dictionary_copy --
- *	Copy a dictionary.  The new dictionary has an initial capacity equal
- *	to the number of objects stored int the original dictionary.  The new
- *	dictionary contains refrences to the original dictionary's objects,
- *	not copies of those objects (i.e. a shallow copy).
+ *	Copy a dictionary.  The new dictionary contains refrences to the
+ *	original dictionary's objects, not copies of those objects (i.e. a
+ *	shallow copy).  Both dictionaries share their entries until one of
+ *	them is modified, so copying doesn't depend on the dictionary size.
  */
 prop_dictionary_t
 prop_dictionary_copy(prop_dictionary_t opd)
 {
 	prop_dictionary_t pd;
-	prop_dictionary_keysym_t pdk;
-	prop_object_t po;
-	unsigned int idx;
+	uint32_t *sharecnt;
 
 	if (! prop_object_is_dictionary(opd))
 		return (NULL);
 
-	_PROP_RWLOCK_RDLOCK(opd->pd_rwlock);
-
-	pd = _prop_dictionary_alloc(opd->pd_count);
-	if (pd != NULL) {
-		for (idx = 0; idx < opd->pd_count; idx++) {
-			pdk = opd->pd_array[idx].pde_key;
-			po = opd->pd_array[idx].pde_objref;
+	pd = _prop_dictionary_alloc(0, NULL);
+	if (pd == NULL)
+		return (NULL);
 
-			prop_object_retain(pdk);
-			prop_object_retain(po);
+	/*
+	 * Immutable dictionaries don't change, so once their entries are
+	 * shared they can be copied without the lock.  The count only
+	 * goes down to 1 when no other copy is left, so it's still safe
+	 * for the copies to check it under their own lock.
+	 */
+	if (prop_dictionary_is_immutable(opd)) {
+		_PROP_ATOMIC_LOAD_PTR(&opd->pd_sharecnt, sharecnt);
+		if (sharecnt != NULL || opd->pd_count == 0) {
+			_prop_dictionary_share(pd, opd);
+			return (pd);
+		}
+	}
 
-			pd->pd_array[idx].pde_key = pdk;
-			pd->pd_array[idx].pde_objref = po;
+	/* Sharing the entries must be serialized with other copies. */
+	_PROP_RWLOCK_WRLOCK(opd->pd_rwlock);
+	_prop_dictionary_seal_locked(opd);
+	if (opd->pd_count != 0 && opd->pd_sharecnt == NULL) {
+		sharecnt = _PROP_MALLOC(sizeof(uint32_t), M_TEMP);
+		if (sharecnt == NULL) {
+			_PROP_RWLOCK_UNLOCK(opd->pd_rwlock);
+			prop_object_release(pd);
+			return (NULL);
 		}
-		pd->pd_count = opd->pd_count;
-		pd->pd_flags = opd->pd_flags;
+		*sharecnt = 1;
+		_PROP_ATOMIC_STORE_PTR(&opd->pd_sharecnt, sharecnt);
 	}
+	_prop_dictionary_share(pd, opd);
 	_PROP_RWLOCK_UNLOCK(opd->pd_rwlock);
+
 	return (pd);
 }
 
@@ -748,8 +1322,13 @@ prop_dictionary_make_immutable(prop_dictionary_t pd)
 {
 
 	_PROP_RWLOCK_WRLOCK(pd->pd_rwlock);
-	if (prop_dictionary_is_immutable(pd) == false)
+	if (prop_dictionary_is_immutable(pd) == false) {
+		_prop_dictionary_seal_locked(pd);
 		pd->pd_flags |= PD_F_IMMUTABLE;
+		if (pd->pd_hash == NULL && pd->pd_count >= PD_HASH_MIN &&
+		    pd->pd_sharecnt == NULL)
+			(void)_prop_dict_hash_rebuild(pd);
+	}
 	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
 }
 
@@ -765,9 +1344,9 @@ prop_dictionary_count(prop_dictionary_t pd)
 	if (! prop_object_is_dictionary(pd))
 		return (0);
 
-	_PROP_RWLOCK_RDLOCK(pd->pd_rwlock);
+	_PD_RDLOCK(pd);
 	rv = pd->pd_count;
-	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+	_PD_RDUNLOCK(pd);
 
 	return (rv);
 }
@@ -788,7 +1367,8 @@ prop_dictionary_ensure_capacity(prop_dictionary_t pd, unsigned int capacity)
 
 	_PROP_RWLOCK_WRLOCK(pd->pd_rwlock);
 	if (capacity > pd->pd_capacity)
-		rv = _prop_dictionary_expand(pd, capacity);
+		rv = _prop_dictionary_unshare(pd) &&
+		    _prop_dictionary_expand(pd, capacity);
 	else
 		rv = true;
 	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
@@ -825,9 +1405,9 @@ prop_dictionary_iterator(prop_dictionary_t pd)
 {
 	prop_object_iterator_t pi;
 
-	_PROP_RWLOCK_RDLOCK(pd->pd_rwlock);
+	_PD_RDLOCK(pd);
 	pi = _prop_dictionary_iterator_locked(pd);
-	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+	_PD_RDUNLOCK(pd);
 	return (pi);
 }
 
@@ -849,7 +1429,7 @@ prop_dictionary_all_keys(prop_dictionary_t pd)
 	/* There is no pressing need to lock the dictionary for this. */
 	array = prop_array_create_with_capacity(pd->pd_count);
 
-	_PROP_RWLOCK_RDLOCK(pd->pd_rwlock);
+	_PD_RDLOCK(pd);
 
 	for (idx = 0; idx < pd->pd_count; idx++) {
 		rv = prop_array_add(array, pd->pd_array[idx].pde_key);
@@ -857,7 +1437,7 @@ prop_dictionary_all_keys(prop_dictionary_t pd)
 			break;
 	}
 
-	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+	_PD_RDUNLOCK(pd);
 
 	if (rv == false) {
 		prop_object_release(array);
@@ -904,21 +1484,33 @@ _prop_dict_lookup(prop_dictionary_t pd, const char *key,
 static prop_object_t
 _prop_dictionary_get(prop_dictionary_t pd, const char *key, bool locked)
 {
-	const struct _prop_dict_entry *pde;
+	struct _prop_dict_entry *pde;
 	prop_object_t po = NULL;
 
 	if (! prop_object_is_dictionary(pd))
 		return (NULL);
 
 	if (!locked)
-		_PROP_RWLOCK_RDLOCK(pd->pd_rwlock);
+		_PD_RDLOCK(pd);
+	if (pd->pd_hash != NULL) {
+		struct _prop_dict_hslot *pdh = _prop_dict_hash_find(pd, key);
+
+		if (pdh != NULL)
+			_PROP_ATOMIC_LOAD_PTR(&pdh->pdh_objref, po);
+		/* Placeholders are resolved through their entry. */
+		if (po == NULL || !prop_object_is_dict_lazy(po))
+			goto out;
+	}
 	pde = _prop_dict_lookup(pd, key, NULL);
 	if (pde != NULL) {
-		_PROP_ASSERT(pde->pde_objref != NULL);
-		po = pde->pde_objref;
+		_PROP_ATOMIC_LOAD_PTR(&pde->pde_objref, po);
+		_PROP_ASSERT(po != NULL);
+		if (prop_object_is_dict_lazy(po))
+			po = _prop_dict_lazy_resolve(pd, pde);
 	}
+ out:
 	if (!locked)
-		_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+		_PD_RDUNLOCK(pd);
 	return (po);
 }
 /*
@@ -933,9 +1525,9 @@ prop_dictionary_get(prop_dictionary_t pd, const char *key)
 	if (! prop_object_is_dictionary(pd))
 		return (NULL);
 
-	_PROP_RWLOCK_RDLOCK(pd->pd_rwlock);
+	_PD_RDLOCK(pd);
 	po = _prop_dictionary_get(pd, key, true);
-	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+	_PD_RDUNLOCK(pd);
 	return (po);
 }
 
@@ -984,12 +1576,18 @@ prop_dictionary_set(prop_dictionary_t pd, const char *key, prop_object_t po)
 		return (false);
 
 	_PROP_RWLOCK_WRLOCK(pd->pd_rwlock);
+	_prop_dictionary_seal_locked(pd);
+	if (_prop_dictionary_unshare(pd) == false)
+		goto out;
 
 	pde = _prop_dict_lookup(pd, key, &idx);
 	if (pde != NULL) {
 		prop_object_t opo = pde->pde_objref;
 		prop_object_retain(po);
 		pde->pde_objref = po;
+		if (pd->pd_hash != NULL)
+			pd->pd_hash[_prop_dict_hash_slot(pd,
+			    pde->pde_key)].pdh_objref = po;
 		prop_object_release(opo);
 		rv = true;
 		goto out;
@@ -1014,6 +1612,7 @@ prop_dictionary_set(prop_dictionary_t pd, const char *key, prop_object_t po)
 		pd->pd_array[0].pde_objref = po;
 		pd->pd_count++;
 		pd->pd_version++;
+		_prop_dict_hash_update(pd, 0);
 		rv = true;
 		goto out;
 	}
@@ -1037,6 +1636,7 @@ prop_dictionary_set(prop_dictionary_t pd, const char *key, prop_object_t po)
 			pd->pd_array[0].pde_objref = po;
 			pd->pd_count++;
 			pd->pd_version++;
+			_prop_dict_hash_update(pd, 0);
 			rv = true;
 			goto out;
 		}
@@ -1050,6 +1650,7 @@ prop_dictionary_set(prop_dictionary_t pd, const char *key, prop_object_t po)
 	pd->pd_count++;
 
 	pd->pd_version++;
+	_prop_dict_hash_update(pd, idx + 1);
 
 	rv = true;
 
@@ -1075,6 +1676,85 @@ prop_dictionary_set_keysym(prop_dictionary_t pd, prop_dictionary_keysym_t pdk,
 	return (prop_dictionary_set(pd, pdk->pdk_key, po));
 }
 
+/*
+ * prop_dictionary_append --
+ *	Add an object with the specified key at the end of the dictionary,
+ *	without looking for the key nor keeping the entries sorted.  Meant
+ *	to build large dictionaries: add all entries with this function,
+ *	then call prop_dictionary_seal().  A key appended more than once
+ *	ends up with the last value appended.  The dictionary is sealed
+ *	when it's first accessed otherwise, but it must not be accessed
+ *	concurrently with appends.
+ */
+bool
+prop_dictionary_append(prop_dictionary_t pd, const char *key,
+		       prop_object_t po)
+{
+	prop_dictionary_keysym_t pdk;
+	unsigned int capacity;
+	bool rv = false;
+
+	if (! prop_object_is_dictionary(pd))
+		return (false);
+
+	if (prop_dictionary_is_immutable(pd))
+		return (false);
+
+	_PROP_RWLOCK_WRLOCK(pd->pd_rwlock);
+	if (_prop_dictionary_unshare(pd) == false)
+		goto out;
+
+	pdk = _prop_dict_keysym_alloc(key);
+	if (pdk == NULL)
+		goto out;
+
+	if (pd->pd_count == pd->pd_capacity) {
+		capacity = pd->pd_capacity < EXPAND_STEP ?
+		    EXPAND_STEP : pd->pd_capacity * 2;
+		if (_prop_dictionary_expand(pd, capacity) == false) {
+			prop_object_release(pdk);
+			goto out;
+		}
+	}
+
+	prop_object_retain(po);
+	pd->pd_array[pd->pd_count].pde_key = pdk;
+	pd->pd_array[pd->pd_count].pde_objref = po;
+	/* Keep it sealed if keys come in order, as internalized ones do. */
+	if (pd->pd_count != 0 && (pd->pd_flags & PD_F_UNSORTED) == 0 &&
+	    strcmp(pd->pd_array[pd->pd_count - 1].pde_key->pdk_key, key) >= 0)
+		pd->pd_flags |= PD_F_UNSORTED;
+	pd->pd_count++;
+	pd->pd_version++;
+	if ((pd->pd_flags & PD_F_UNSORTED) == 0)
+		_prop_dict_hash_update(pd, pd->pd_count - 1);
+	else
+		_prop_dict_hash_discard(pd);
+
+	rv = true;
+
+ out:
+	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+	return (rv);
+}
+
+/*
+ * prop_dictionary_seal --
+ *	Sort the entries added by prop_dictionary_append() and drop
+ *	duplicated keys.
+ */
+void
+prop_dictionary_seal(prop_dictionary_t pd)
+{
+
+	if (! prop_object_is_dictionary(pd))
+		return;
+
+	_PROP_RWLOCK_WRLOCK(pd->pd_rwlock);
+	_prop_dictionary_seal_locked(pd);
+	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
+}
+
 static void
 _prop_dictionary_remove(prop_dictionary_t pd, struct _prop_dict_entry *pde,
     unsigned int idx)
@@ -1096,6 +1776,13 @@ _prop_dictionary_remove(prop_dictionary_t pd, struct _prop_dict_entry *pde,
 	pd->pd_count--;
 	pd->pd_version++;
 
+	/* Drop the hash table if the dictionary became small enough. */
+	if (pd->pd_hash != NULL) {
+		if (pd->pd_count < PD_HASH_MIN)
+			_prop_dict_hash_discard(pd);
+		else
+			_prop_dict_hash_remove(pd, pdk);
+	}
 
 	prop_object_release(pdk);
 
@@ -1122,12 +1809,13 @@ prop_dictionary_remove(prop_dictionary_t pd, const char *key)
 	if (prop_dictionary_is_immutable(pd))
 		goto out;
 
+	_prop_dictionary_seal_locked(pd);
 	pde = _prop_dict_lookup(pd, key, &idx);
 	/* XXX Should this be a _PROP_ASSERT()? */
-	if (pde == NULL)
+	if (pde == NULL || _prop_dictionary_unshare(pd) == false)
 		goto out;
 
-	_prop_dictionary_remove(pd, pde, idx);
+	_prop_dictionary_remove(pd, &pd->pd_array[idx], idx);
  out:
 	_PROP_RWLOCK_UNLOCK(pd->pd_rwlock);
 }
@@ -1252,7 +1940,7 @@ _prop_dictionary_internalize(prop_stack_t stack, prop_object_t *obj,
 	if (ctx->poic_tagattr != NULL)
 		return (true);
 
-	dict = prop_dictionary_create();
+	dict = _prop_dictionary_alloc(0, ctx->poic_arena);
 	if (dict == NULL)
 		return (true);
 
@@ -1285,7 +1973,7 @@ _prop_dictionary_internalize_continue(prop_stack_t stack, prop_object_t *obj,
 	_PROP_ASSERT(tmpkey != NULL);
 
 	if (child == NULL ||
-	    prop_dictionary_set(dict, tmpkey, child) == false) {
+	    prop_dictionary_append(dict, tmpkey, child) == false) {
 		_PROP_FREE(tmpkey, M_TEMP);
 		if (child != NULL)
 			prop_object_release(child);
@@ -1318,6 +2006,7 @@ _prop_dictionary_internalize_body(prop_stack_t stack, prop_object_t *obj,
 	if (_PROP_TAG_MATCH(ctx, "dict") &&
 	    ctx->poic_tag_type == _PROP_TAG_TYPE_END) {
 		_PROP_FREE(tmpkey, M_TEMP);
+		prop_dictionary_seal(dict);
 		return (true);
 	}
 
@@ -1370,6 +2059,437 @@ prop_dictionary_internalize(const char *xml)
 	return _prop_generic_internalize(xml, "dict");
 }
 
+/*
+ * prop_dictionary_internalize_arena --
+ *	Like prop_dictionary_internalize(), but all objects are allocated
+ *	from an arena and their memory is released at once, when the
+ *	last of them is released.  Short string values are interned, so
+ *	equal strings are the same immutable object.  Meant for large
+ *	trees that are kept around until they're released as a whole.
+ */
+prop_dictionary_t
+prop_dictionary_internalize_arena(const char *xml)
+{
+	return _prop_generic_internalize_arena(xml, "dict");
+}
+
+static struct _prop_dict_lazy_source *
+_prop_dict_lazy_source_create(bool intern)
+{
+	struct _prop_dict_lazy_source *pls;
+
+	pls = _PROP_CALLOC(sizeof(*pls), M_TEMP);
+	if (pls == NULL)
+		return (NULL);
+	if ((pls->pls_arena = _prop_arena_create()) == NULL) {
+		_PROP_FREE(pls, M_TEMP);
+		return (NULL);
+	}
+	if (intern &&
+	    (pls->pls_intern = _prop_string_intern_create()) == NULL) {
+		_prop_arena_release(pls->pls_arena);
+		_PROP_FREE(pls, M_TEMP);
+		return (NULL);
+	}
+	_PROP_MUTEX_INIT(pls->pls_mtx);
+	pls->pls_refcnt = 1;
+	return (pls);
+}
+
+/*
+ * _prop_dict_lazy_append --
+ *	Append a placeholder for the value of key, to be resolved from
+ *	the source of the dictionary.
+ */
+static bool
+_prop_dict_lazy_append(prop_dictionary_t pd, const char *key,
+    const void *start)
+{
+	struct _prop_dict_lazy_source *pls = pd->pd_lazy;
+	struct _prop_dict_lazy_object *plo;
+	bool rv;
+
+	plo = _PROP_POOL_GET_ARENA(_prop_dict_lazy_pool, pls->pls_arena);
+	if (plo == NULL)
+		return (false);
+	_prop_object_init(&plo->plo_obj, &_prop_object_type_dict_lazy);
+	plo->plo_src = pls;
+	plo->plo_start = start;
+	_PROP_ATOMIC_INC32(&pls->pls_refcnt);
+
+	rv = prop_dictionary_append(pd, key, plo);
+	prop_object_release(plo);
+	return (rv);
+}
+
+/*
+ * prop_dictionary_create_lazy --
+ *	Create an empty dictionary whose values are added with
+ *	prop_dictionary_append_lazy(), and obtained from decode(cookie,
+ *	arg) the first time they're looked up; decode is called with
+ *	a lock held and must return a new reference, or NULL on error.
+ *	fini(cookie), if not NULL, is called once the dictionary and all
+ *	its copies are released.  On failure fini is not called.
+ */
+prop_dictionary_t
+prop_dictionary_create_lazy(unsigned int capacity,
+    prop_object_t (*decode)(void *, const void *), void (*fini)(void *),
+    void *cookie)
+{
+	struct _prop_dict_lazy_source *pls;
+	prop_dictionary_t pd;
+
+	if ((pls = _prop_dict_lazy_source_create(false)) == NULL)
+		return (NULL);
+	if ((pd = _prop_dictionary_alloc(capacity, NULL)) == NULL) {
+		_prop_dict_lazy_source_release(pls);
+		return (NULL);
+	}
+	/* The dictionary keeps our reference. */
+	pls->pls_decode = decode;
+	pls->pls_fini = fini;
+	pls->pls_cookie = cookie;
+	pd->pd_lazy = pls;
+	return (pd);
+}
+
+/*
+ * prop_dictionary_append_lazy --
+ *	Append a key to a dictionary created with
+ *	prop_dictionary_create_lazy(), its value is decoded from arg.
+ *	Like prop_dictionary_append(), the dictionary is sorted when
+ *	it's sealed.
+ */
+bool
+prop_dictionary_append_lazy(prop_dictionary_t pd, const char *key,
+    const void *arg)
+{
+
+	if (! prop_object_is_dictionary(pd) || pd->pd_lazy == NULL ||
+	    pd->pd_lazy->pls_decode == NULL)
+		return (false);
+
+	return (_prop_dict_lazy_append(pd, key, arg));
+}
+
+/*
+ * prop_dictionary_internalize_lazy --
+ *	Like prop_dictionary_internalize(), but only the keys of the
+ *	dictionary are parsed; each value is internalized the first time
+ *	it's looked up.  On success the dictionary takes ownership of the
+ *	malloc(3)ed buffer, which must not be modified nor freed by the
+ *	caller.  On failure the buffer is left to the caller.  Values are
+ *	allocated and interned as by prop_dictionary_internalize_arena().
+ */
+prop_dictionary_t
+prop_dictionary_internalize_lazy(char *xml)
+{
+	struct _prop_object_internalize_context *ctx;
+	struct _prop_dict_lazy_source *pls;
+	prop_dictionary_t dict = NULL;
+	const char *start;
+	char tmpkey[PDK_MAXKEY + 1];
+	size_t keylen;
+	bool empty;
+
+	ctx = _prop_object_internalize_context_alloc(xml);
+	if (ctx == NULL)
+		return (NULL);
+
+	if ((pls = _prop_dict_lazy_source_create(true)) == NULL) {
+		_prop_object_internalize_context_free(ctx);
+		return (NULL);
+	}
+
+	/* <plist><dict>, as in _prop_generic_internalize(). */
+	if (_prop_object_internalize_find_tag(ctx, "plist",
+	    _PROP_TAG_TYPE_START) == false || ctx->poic_is_empty_element)
+		goto bad;
+	if (ctx->poic_tagattr != NULL &&
+	    !_PROP_TAGATTR_MATCH(ctx, "version"))
+		goto bad;
+	if (_prop_object_internalize_find_tag(ctx, "dict",
+	    _PROP_TAG_TYPE_START) == false || ctx->poic_tagattr != NULL)
+		goto bad;
+
+	empty = ctx->poic_is_empty_element;
+
+	if ((dict = _prop_dictionary_alloc(0, NULL)) == NULL)
+		goto bad;
+	/* The dictionary keeps our reference. */
+	dict->pd_lazy = pls;
+	pls = NULL;
+
+	while (empty == false) {
+		if (_prop_object_internalize_find_tag(ctx, NULL,
+		    _PROP_TAG_TYPE_EITHER) == false)
+			goto bad;
+		if (_PROP_TAG_MATCH(ctx, "dict") &&
+		    ctx->poic_tag_type == _PROP_TAG_TYPE_END)
+			break;
+		if (!_PROP_TAG_MATCH(ctx, "key") ||
+		    ctx->poic_tag_type != _PROP_TAG_TYPE_START ||
+		    ctx->poic_is_empty_element)
+			goto bad;
+		if (_prop_object_internalize_decode_string(ctx,
+		    tmpkey, PDK_MAXKEY, &keylen, &ctx->poic_cp) == false)
+			goto bad;
+		tmpkey[keylen] = '\0';
+		if (_prop_object_internalize_find_tag(ctx, "key",
+		    _PROP_TAG_TYPE_END) == false)
+			goto bad;
+
+		/* Remember where the value starts, and skip it. */
+		if (_prop_object_internalize_find_tag(ctx, NULL,
+		    _PROP_TAG_TYPE_START) == false)
+			goto bad;
+		start = ctx->poic_tag_start;
+		if (_prop_object_internalize_skip(ctx) == false)
+			goto bad;
+
+		if (_prop_dict_lazy_append(dict, tmpkey, start) == false)
+			goto bad;
+	}
+
+	if (_prop_object_internalize_find_tag(ctx, "plist",
+	    _PROP_TAG_TYPE_END) == false)
+		goto bad;
+	prop_dictionary_seal(dict);
+
+	dict->pd_lazy->pls_xml = xml;
+	_prop_object_internalize_context_free(ctx);
+	return (dict);
+
+ bad:
+	if (dict != NULL)
+		prop_object_release(dict);
+	if (pls != NULL)
+		_prop_dict_lazy_source_release(pls);
+	_prop_object_internalize_context_free(ctx);
+	return (NULL);
+}
+
+/*
+ * Streaming internalization: the XML is read in blocks into a buffer
+ * that only needs to hold the value being parsed.  Each top level value
+ * is first skipped to make sure it's complete in the buffer, more data
+ * is read if it's not, and then it's internalized and the buffer space
+ * it used is reclaimed.
+ */
+#define	PDS_BLKSIZE		(64 * 1024)
+
+struct _prop_dict_stream {
+	ssize_t		(*pds_read)(void *, void *, size_t);
+	void		*pds_arg;
+	char		*pds_buf;
+	size_t		pds_size;
+	size_t		pds_len;
+	bool		pds_eof;
+};
+
+/*
+ * _prop_dict_stream_fill --
+ *	Discard the first `off' octets of the buffer, and read more data.
+ *	At least as much as is still in the buffer is read, so that values
+ *	spanning many blocks aren't rescanned too many times.  Returns
+ *	false once EOF was reached, or on error.
+ */
+static bool
+_prop_dict_stream_fill(struct _prop_dict_stream *pds, size_t off)
+{
+	char *nbuf;
+	size_t want, nsize;
+	ssize_t nbytes;
+
+	if (pds->pds_eof)
+		return (false);
+
+	if (off != 0) {
+		memmove(pds->pds_buf, pds->pds_buf + off, pds->pds_len - off);
+		pds->pds_len -= off;
+	}
+	want = pds->pds_len > PDS_BLKSIZE ? pds->pds_len : PDS_BLKSIZE;
+	if (pds->pds_size - pds->pds_len < want + 1) {
+		nsize = pds->pds_len + want + 1;
+		nbuf = _PROP_REALLOC(pds->pds_buf, nsize, M_TEMP);
+		if (nbuf == NULL)
+			return (false);
+		pds->pds_buf = nbuf;
+		pds->pds_size = nsize;
+	}
+	while (want != 0) {
+		nbytes = (*pds->pds_read)(pds->pds_arg,
+		    pds->pds_buf + pds->pds_len, want);
+		if (nbytes < 0) {
+			pds->pds_buf[pds->pds_len] = '\0';
+			pds->pds_eof = true;
+			return (false);
+		} else if (nbytes == 0) {
+			pds->pds_eof = true;
+			break;
+		}
+		pds->pds_len += (size_t)nbytes;
+		want -= (size_t)nbytes;
+	}
+	pds->pds_buf[pds->pds_len] = '\0';
+
+	return (true);
+}
+
+/*
+ * _prop_dict_stream_next --
+ *	Parse the next key and skip its value, to make sure it's complete
+ *	in the buffer.  At the end of the dictionary *endp is set instead.
+ *	Returns false if the data is incomplete or malformed.
+ */
+static bool
+_prop_dict_stream_next(struct _prop_object_internalize_context *ctx,
+    char *tmpkey, const char **valp, bool *endp)
+{
+	size_t keylen;
+
+	*endp = false;
+	if (_prop_object_internalize_find_tag(ctx, NULL,
+	    _PROP_TAG_TYPE_EITHER) == false)
+		return (false);
+	if (_PROP_TAG_MATCH(ctx, "dict") &&
+	    ctx->poic_tag_type == _PROP_TAG_TYPE_END) {
+		*endp = true;
+		return (_prop_object_internalize_find_tag(ctx, "plist",
+		    _PROP_TAG_TYPE_END));
+	}
+	if (!_PROP_TAG_MATCH(ctx, "key") ||
+	    ctx->poic_tag_type != _PROP_TAG_TYPE_START ||
+	    ctx->poic_is_empty_element)
+		return (false);
+	if (_prop_object_internalize_decode_string(ctx,
+	    tmpkey, PDK_MAXKEY, &keylen, &ctx->poic_cp) == false)
+		return (false);
+	tmpkey[keylen] = '\0';
+	if (_prop_object_internalize_find_tag(ctx, "key",
+	    _PROP_TAG_TYPE_END) == false)
+		return (false);
+	if (_prop_object_internalize_find_tag(ctx, NULL,
+	    _PROP_TAG_TYPE_START) == false)
+		return (false);
+	*valp = ctx->poic_tag_start;
+
+	return (_prop_object_internalize_skip(ctx));
+}
+
+static prop_dictionary_t
+_prop_dictionary_internalize_stream(ssize_t (*readfn)(void *, void *, size_t),
+    void *arg, bool arena)
+{
+	struct _prop_object_internalize_context *ctx = NULL;
+	struct _prop_dict_stream pds;
+	prop_dictionary_t dict = NULL;
+	prop_object_t po;
+	const char *val = NULL;
+	char tmpkey[PDK_MAXKEY + 1];
+	size_t off = 0;
+	bool empty, end, rv;
+
+	memset(&pds, 0, sizeof(pds));
+	pds.pds_read = readfn;
+	pds.pds_arg = arg;
+
+	/* <plist><dict> */
+	for (;;) {
+		if (_prop_dict_stream_fill(&pds, 0) == false)
+			goto out;
+		if ((ctx = _prop_object_internalize_context_alloc(
+		    pds.pds_buf)) == NULL)
+			continue;
+		if (_prop_object_internalize_find_tag(ctx, "plist",
+		    _PROP_TAG_TYPE_START) &&
+		    !ctx->poic_is_empty_element &&
+		    (ctx->poic_tagattr == NULL ||
+		     _PROP_TAGATTR_MATCH(ctx, "version")) &&
+		    _prop_object_internalize_find_tag(ctx, "dict",
+		    _PROP_TAG_TYPE_START) && ctx->poic_tagattr == NULL)
+			break;
+		_prop_object_internalize_context_free(ctx);
+		ctx = NULL;
+	}
+	if (arena && ((ctx->poic_arena = _prop_arena_create()) == NULL ||
+	    (ctx->poic_intern = _prop_string_intern_create()) == NULL))
+		goto out;
+	empty = ctx->poic_is_empty_element;
+	off = (size_t)(ctx->poic_cp - pds.pds_buf);
+
+	if ((dict = _prop_dictionary_alloc(0, ctx->poic_arena)) == NULL)
+		goto out;
+
+	for (;;) {
+		ctx->poic_xml = ctx->poic_cp = pds.pds_buf + off;
+		if (empty) {
+			end = true;
+			rv = _prop_object_internalize_find_tag(ctx, "plist",
+			    _PROP_TAG_TYPE_END);
+		} else
+			rv = _prop_dict_stream_next(ctx, tmpkey, &val, &end);
+		if (rv == false) {
+			/* Incomplete, or malformed if there's nothing left. */
+			if (_prop_dict_stream_fill(&pds, off) == false)
+				goto bad;
+			off = 0;
+			continue;
+		}
+		if (end)
+			break;
+
+		ctx->poic_cp = val;
+		if (_prop_object_internalize_find_tag(ctx, NULL,
+		    _PROP_TAG_TYPE_START) == false ||
+		    (po = _prop_object_internalize_by_tag(ctx)) == NULL)
+			goto bad;
+		rv = prop_dictionary_append(dict, tmpkey, po);
+		prop_object_release(po);
+		if (rv == false)
+			goto bad;
+		off = (size_t)(ctx->poic_cp - pds.pds_buf);
+	}
+	prop_dictionary_seal(dict);
+	goto out;
+
+ bad:
+	prop_object_release(dict);
+	dict = NULL;
+ out:
+	if (ctx != NULL)
+		_prop_object_internalize_context_free(ctx);
+	if (pds.pds_buf != NULL)
+		_PROP_FREE(pds.pds_buf, M_TEMP);
+	return (dict);
+}
+
+/*
+ * prop_dictionary_internalize_stream --
+ *	Like prop_dictionary_internalize(), but the XML-style representation
+ *	is obtained in blocks by calling readfn(arg, buf, len), which returns
+ *	the number of octets stored in buf, 0 at EOF or -1 on error.  Only
+ *	the value being parsed needs to be kept in memory.
+ */
+prop_dictionary_t
+prop_dictionary_internalize_stream(ssize_t (*readfn)(void *, void *, size_t),
+    void *arg)
+{
+	return _prop_dictionary_internalize_stream(readfn, arg, false);
+}
+
+/*
+ * prop_dictionary_internalize_stream_arena --
+ *	Like prop_dictionary_internalize_stream(), allocating all objects
+ *	from an arena as prop_dictionary_internalize_arena() does.
+ */
+prop_dictionary_t
+prop_dictionary_internalize_stream_arena(
+    ssize_t (*readfn)(void *, void *, size_t), void *arg)
+{
+	return _prop_dictionary_internalize_stream(readfn, arg, true);
+}
+
 /*
  * prop_dictionary_externalize_to_file --
  *	Externalize a dictionary to the specified file.
@@ -1377,21 +2497,11 @@ prop_dictionary_internalize(const char *xml)
 bool
 prop_dictionary_externalize_to_file(prop_dictionary_t dict, const char *fname)
 {
-	char *xml;
-	bool rv;
-	int save_errno = 0;	/* XXXGCC -Wuninitialized [mips, ...] */
 
-	xml = prop_dictionary_externalize(dict);
-	if (xml == NULL)
+	if (! prop_object_is_dictionary(dict))
 		return (false);
-	rv = _prop_object_externalize_write_file(fname, xml, strlen(xml), false);
-	if (rv == false)
-		save_errno = errno;
-	_PROP_FREE(xml, M_TEMP);
-	if (rv == false)
-		errno = save_errno;
 
-	return (rv);
+	return (_prop_object_externalize_to_file(dict, fname));
 }
 
 /*
@@ -1412,3 +2522,23 @@ prop_dictionary_internalize_from_file(const char *fname)
 
 	return (dict);
 }
+
+/*
+ * prop_dictionary_internalize_from_file_arena --
+ *	Internalize a dictionary from a file, as done by
+ *	prop_dictionary_internalize_arena().
+ */
+prop_dictionary_t
+prop_dictionary_internalize_from_file_arena(const char *fname)
+{
+	struct _prop_object_internalize_mapped_file *mf;
+	prop_dictionary_t dict;
+
+	mf = _prop_object_internalize_map_file(fname);
+	if (mf == NULL)
+		return (NULL);
+	dict = prop_dictionary_internalize_arena(mf->poimf_xml);
+	_prop_object_internalize_unmap_file(mf);
+
+	return (dict);
+}
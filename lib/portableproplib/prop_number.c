@@ -31,7 +31,6 @@
 
 #include <prop/prop_number.h>
 #include "prop_object_impl.h"
-#include "prop_rb_impl.h"
 
 #include <errno.h>
 #include <stdlib.h>
@@ -49,7 +48,7 @@ struct _prop_number_value {
 
 struct _prop_number {
 	struct _prop_object	pn_obj;
-	struct rb_node		pn_link;
+	struct _prop_uniq_node	pn_link;
 	struct _prop_number_value pn_value;
 };
 
@@ -65,16 +64,11 @@ static _prop_object_equals_rv_t
 				    void **, void **,
 				    prop_object_t *, prop_object_t *);
 
-static void _prop_number_lock(void);
-static void _prop_number_unlock(void);
-
 static const struct _prop_object_type _prop_object_type_number = {
 	.pot_type	=	PROP_TYPE_NUMBER,
 	.pot_free	=	_prop_number_free,
 	.pot_extern	=	_prop_number_externalize,
 	.pot_equals	=	_prop_number_equals,
-	.pot_lock       =       _prop_number_lock,
-	.pot_unlock     =    	_prop_number_unlock,
 };
 
 #define	prop_object_is_number(x)	\
@@ -112,37 +106,31 @@ _prop_number_compare_values(const struct _prop_number_value *pnv1,
 	return (0);
 }
 
-static int
-/*ARGSUSED*/
-_prop_number_rb_compare_nodes(void *ctx _PROP_ARG_UNUSED,
-			      const void *n1, const void *n2)
+static bool
+_prop_number_match(const void *v, const void *key)
 {
-	const struct _prop_number *pn1 = n1;
-	const struct _prop_number *pn2 = n2;
+	const struct _prop_number *pn = v;
 
-	return _prop_number_compare_values(&pn1->pn_value, &pn2->pn_value);
+	return (_prop_number_compare_values(&pn->pn_value, key) == 0);
 }
 
-static int
-/*ARGSUSED*/
-_prop_number_rb_compare_key(void *ctx _PROP_ARG_UNUSED,
-			    const void *n, const void *v)
+static uint32_t
+_prop_number_hash(const struct _prop_number_value *pnv)
 {
-	const struct _prop_number *pn = n;
-	const struct _prop_number_value *pnv = v;
+	uint64_t h = pnv->pnv_unsigned;
 
-	return _prop_number_compare_values(&pn->pn_value, pnv);
-}
+	/* 64 bit finalizer from MurmurHash3, mixes all bits into the top ones */
+	h ^= pnv->pnv_is_unsigned;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
 
-static const rb_tree_ops_t _prop_number_rb_tree_ops = {
-	.rbto_compare_nodes = _prop_number_rb_compare_nodes,
-	.rbto_compare_key = _prop_number_rb_compare_key,
-	.rbto_node_offset = offsetof(struct _prop_number, pn_link),
-	.rbto_context = NULL
-};
+	return ((uint32_t)h);
+}
 
-static struct rb_tree _prop_number_tree;
-_PROP_MUTEX_DECL_STATIC(_prop_number_tree_mutex)
+static struct _prop_uniq_table _prop_number_table;
 
 /* ARGSUSED */
 static _prop_object_free_rv_t
@@ -150,7 +138,7 @@ _prop_number_free(prop_stack_t stack, prop_object_t *obj)
 {
 	prop_number_t pn = *obj;
 
-	_prop_rb_tree_remove_node(&_prop_number_tree, pn);
+	_prop_uniq_remove(&_prop_number_table, pn);
 
 	_PROP_POOL_PUT(_prop_number_pool, pn);
 
@@ -163,25 +151,11 @@ static int
 _prop_number_init(void)
 {
 
-	_PROP_MUTEX_INIT(_prop_number_tree_mutex);
-	_prop_rb_tree_init(&_prop_number_tree, &_prop_number_rb_tree_ops);
+	_prop_uniq_init(&_prop_number_table, _prop_number_match,
+	    offsetof(struct _prop_number, pn_link));
 	return 0;
 }
 
-static void 
-_prop_number_lock(void)
-{
-	/* XXX: init necessary? */
-	_PROP_ONCE_RUN(_prop_number_init_once, _prop_number_init);
-	_PROP_MUTEX_LOCK(_prop_number_tree_mutex);
-}
-
-static void
-_prop_number_unlock(void)
-{
-	_PROP_MUTEX_UNLOCK(_prop_number_tree_mutex);
-}
-	
 static bool
 _prop_number_externalize(struct _prop_object_externalize_context *ctx,
 			 void *v)
@@ -267,25 +241,22 @@ _prop_number_equals(prop_object_t v1, prop_object_t v2,
 static prop_number_t
 _prop_number_alloc(const struct _prop_number_value *pnv)
 {
-	prop_number_t opn, pn, rpn;
+	prop_number_t opn, pn;
+	uint32_t hash;
 
 	_PROP_ONCE_RUN(_prop_number_init_once, _prop_number_init);
 
 	/*
-	 * Check to see if this already exists in the tree.  If it does,
+	 * Check to see if this already exists in the table.  If it does,
 	 * we just retain it and return it.
 	 */
-	_PROP_MUTEX_LOCK(_prop_number_tree_mutex);
-	opn = _prop_rb_tree_find(&_prop_number_tree, pnv);
-	if (opn != NULL) {
-		prop_object_retain(opn);
-		_PROP_MUTEX_UNLOCK(_prop_number_tree_mutex);
+	hash = _prop_number_hash(pnv);
+	opn = _prop_uniq_find(&_prop_number_table, hash, pnv);
+	if (opn != NULL)
 		return (opn);
-	}
-	_PROP_MUTEX_UNLOCK(_prop_number_tree_mutex);
 
 	/*
-	 * Not in the tree.  Create it now.
+	 * Not in the table.  Create it now.
 	 */
 
 	pn = _PROP_POOL_GET(_prop_number_pool);
@@ -295,23 +266,16 @@ _prop_number_alloc(const struct _prop_number_value *pnv)
 	_prop_object_init(&pn->pn_obj, &_prop_object_type_number);
 
 	pn->pn_value = *pnv;
+	pn->pn_link.pun_hash = hash;
 
 	/*
-	 * We dropped the mutex when we allocated the new object, so
-	 * we have to check again if it is in the tree.
+	 * Another thread may have inserted the same value meanwhile,
+	 * in that case use theirs.
 	 */
-	_PROP_MUTEX_LOCK(_prop_number_tree_mutex);
-	opn = _prop_rb_tree_find(&_prop_number_tree, pnv);
-	if (opn != NULL) {
-		prop_object_retain(opn);
-		_PROP_MUTEX_UNLOCK(_prop_number_tree_mutex);
+	opn = _prop_uniq_insert(&_prop_number_table, pn, pnv);
+	if (opn != pn)
 		_PROP_POOL_PUT(_prop_number_pool, pn);
-		return (opn);
-	}
-	rpn = _prop_rb_tree_insert_node(&_prop_number_tree, pn);
-	_PROP_ASSERT(rpn == pn);
-	_PROP_MUTEX_UNLOCK(_prop_number_tree_mutex);
-	return (rpn);
+	return (opn);
 }
 
 /*
@@ -35,7 +35,7 @@
 #include <prop/prop_object.h>
 
 #ifdef _PROP_NEED_REFCNT_MTX
-static pthread_mutex_t _prop_refcnt_mtx = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t _prop_refcnt_mtx = PTHREAD_MUTEX_INITIALIZER;
 #endif /* _PROP_NEED_REFCNT_MTX */
 
 #define __USE_MISC     /* MAP_ANON on glibc */
@@ -73,6 +73,268 @@ _prop_object_fini(struct _prop_object *po _PROP_ARG_UNUSED)
 	/* Nothing to do, currently. */
 }
 
+/*
+ * Arena blocks are aligned to their size, so that the arena owning
+ * an object can be found from the object address.  They are mapped
+ * directly rather than allocated with posix_memalign(3), which wastes
+ * up to a whole block of padding for each one.
+ */
+#define	_PROP_ARENA_BLKSIZE	(64 * 1024)
+#define	_PROP_ARENA_ALIGN	sizeof(uint64_t)
+#define	_PROP_ARENA_ROUND(s)	\
+	(((s) + _PROP_ARENA_ALIGN - 1) & ~(_PROP_ARENA_ALIGN - 1))
+
+struct _prop_arena_block {
+	struct _prop_arena		*pab_arena;
+	struct _prop_arena_block	*pab_next;
+};
+
+struct _prop_arena {
+	struct _prop_arena_block	*pa_blocks;
+	char				*pa_cur;
+	size_t				pa_avail;
+	uint32_t			pa_refcnt;
+};
+
+/*
+ * _prop_arena_block_alloc --
+ *	Map an arena block aligned to its size.
+ */
+static void *
+_prop_arena_block_alloc(void)
+{
+	char *p, *v;
+	size_t lead;
+
+	p = mmap(NULL, 2 * _PROP_ARENA_BLKSIZE, PROT_READ|PROT_WRITE,
+	    MAP_ANON|MAP_PRIVATE, -1, (off_t)0);
+	if (p == MAP_FAILED)
+		return (NULL);
+	v = (char *)(((uintptr_t)p + _PROP_ARENA_BLKSIZE - 1) &
+	    ~((uintptr_t)_PROP_ARENA_BLKSIZE - 1));
+	lead = (size_t)(v - p);
+	if (lead != 0)
+		munmap(p, lead);
+	munmap(v + _PROP_ARENA_BLKSIZE, _PROP_ARENA_BLKSIZE - lead);
+	return (v);
+}
+
+/*
+ * _prop_arena_create --
+ *	Create an arena.  The caller holds a reference to it that must be
+ *	dropped with _prop_arena_release() once it's done allocating;
+ *	every object allocated from the arena holds another one.
+ */
+struct _prop_arena *
+_prop_arena_create(void)
+{
+	struct _prop_arena *pa;
+
+	pa = _PROP_CALLOC(sizeof(*pa), M_TEMP);
+	if (pa != NULL)
+		pa->pa_refcnt = 1;
+
+	return (pa);
+}
+
+/*
+ * _prop_arena_release --
+ *	Drop a reference to the arena, all of its blocks are freed
+ *	once the last one is gone.
+ */
+void
+_prop_arena_release(struct _prop_arena *pa)
+{
+	struct _prop_arena_block *pab;
+	uint32_t ocnt;
+
+	_PROP_ATOMIC_DEC32_NV(&pa->pa_refcnt, ocnt);
+	if (ocnt != 0)
+		return;
+
+	while ((pab = pa->pa_blocks) != NULL) {
+		pa->pa_blocks = pab->pab_next;
+		munmap(pab, _PROP_ARENA_BLKSIZE);
+	}
+	_PROP_FREE(pa, M_TEMP);
+}
+
+/*
+ * _prop_arena_alloc --
+ *	Allocate memory from the arena.  The memory is only released with
+ *	the arena.  Returns NULL if the request is too large to be served
+ *	from an arena block, or on allocation failure.
+ */
+void *
+_prop_arena_alloc(struct _prop_arena *pa, size_t size)
+{
+	struct _prop_arena_block *pab;
+	const size_t hdrsize = _PROP_ARENA_ROUND(sizeof(*pab));
+	void *v;
+
+	size = _PROP_ARENA_ROUND(size);
+	if (size > (_PROP_ARENA_BLKSIZE - hdrsize) / 4)
+		return (NULL);
+
+	if (size > pa->pa_avail) {
+		if ((v = _prop_arena_block_alloc()) == NULL)
+			return (NULL);
+		pab = v;
+		pab->pab_arena = pa;
+		pab->pab_next = pa->pa_blocks;
+		pa->pa_blocks = pab;
+		pa->pa_cur = (char *)v + hdrsize;
+		pa->pa_avail = _PROP_ARENA_BLKSIZE - hdrsize;
+	}
+	v = pa->pa_cur;
+	pa->pa_cur += size;
+	pa->pa_avail -= size;
+
+	return (v);
+}
+
+/*
+ * _prop_pool_get --
+ *	Allocate an object from the arena if specified, or with malloc(3).
+ */
+void *
+_prop_pool_get(size_t size, struct _prop_arena *pa)
+{
+	struct _prop_object *po;
+
+	if (pa != NULL && (po = _prop_arena_alloc(pa, size)) != NULL) {
+		po->po_flags = _PROP_OBJECT_F_ARENA;
+		_PROP_ATOMIC_INC32(&pa->pa_refcnt);
+		return (po);
+	}
+	po = _PROP_MALLOC(size, M_TEMP);
+	if (po != NULL)
+		po->po_flags = 0;
+
+	return (po);
+}
+
+/*
+ * _prop_pool_put --
+ *	Free an object allocated by _prop_pool_get().
+ */
+void
+_prop_pool_put(void *v)
+{
+	struct _prop_object *po = v;
+	struct _prop_arena_block *pab;
+
+	if ((po->po_flags & _PROP_OBJECT_F_ARENA) == 0) {
+		_PROP_FREE(v, M_TEMP);
+		return;
+	}
+	pab = (struct _prop_arena_block *)
+	    ((uintptr_t)v & ~((uintptr_t)_PROP_ARENA_BLKSIZE - 1));
+	_prop_arena_release(pab->pab_arena);
+}
+
+#define	BUF_EXPAND		256
+#define	BUF_FLUSH		(64 * 1024)
+
+/*
+ * _prop_object_externalize_flush --
+ *	Write the contents of the externalize buffer to the context's
+ *	file descriptor, if it has one.
+ */
+static bool
+_prop_object_externalize_flush(struct _prop_object_externalize_context *ctx)
+{
+	const char *cp = ctx->poec_buf;
+	ssize_t nbytes;
+
+	if (ctx->poec_fd == -1)
+		return (true);
+
+	while (ctx->poec_len != 0) {
+		nbytes = write(ctx->poec_fd, cp, ctx->poec_len);
+		if (nbytes == -1) {
+			if (errno == EINTR)
+				continue;
+			return (false);
+		}
+		cp += nbytes;
+		ctx->poec_len -= (size_t)nbytes;
+	}
+	return (true);
+}
+
+/*
+ * _prop_object_externalize_reserve --
+ *	Make room for len more octets in the externalize buffer, either
+ *	by flushing it to the file descriptor or by growing it.
+ */
+static bool
+_prop_object_externalize_reserve(struct _prop_object_externalize_context *ctx,
+    size_t len)
+{
+	size_t capacity;
+	char *cp;
+
+	_PROP_ASSERT(ctx->poec_capacity != 0);
+	_PROP_ASSERT(ctx->poec_buf != NULL);
+	_PROP_ASSERT(ctx->poec_len <= ctx->poec_capacity);
+
+	if (ctx->poec_capacity - ctx->poec_len >= len)
+		return (true);
+
+	if (ctx->poec_fd != -1) {
+		if (_prop_object_externalize_flush(ctx) == false)
+			return (false);
+		if (ctx->poec_capacity >= len)
+			return (true);
+	}
+	/* Grow geometrically, externalized plists can be large. */
+	capacity = ctx->poec_capacity;
+	while (capacity - ctx->poec_len < len)
+		capacity *= 2;
+	cp = _PROP_REALLOC(ctx->poec_buf, capacity, M_TEMP);
+	if (cp == NULL)
+		return (false);
+	ctx->poec_capacity = capacity;
+	ctx->poec_buf = cp;
+
+	return (true);
+}
+
+/*
+ * _prop_object_externalize_append --
+ *	Append a block of octets to the externalize buffer.
+ */
+static bool
+_prop_object_externalize_append(struct _prop_object_externalize_context *ctx,
+    const void *v, size_t len)
+{
+
+	if (_prop_object_externalize_reserve(ctx, len) == false)
+		return (false);
+	memcpy(ctx->poec_buf + ctx->poec_len, v, len);
+	ctx->poec_len += len;
+
+	return (true);
+}
+
+/*
+ * _prop_object_externalize_append_indent --
+ *	Append a tab for each nesting level to the externalize buffer.
+ */
+static bool
+_prop_object_externalize_append_indent(
+    struct _prop_object_externalize_context *ctx)
+{
+
+	if (_prop_object_externalize_reserve(ctx, ctx->poec_depth) == false)
+		return (false);
+	memset(ctx->poec_buf + ctx->poec_len, '\t', ctx->poec_depth);
+	ctx->poec_len += ctx->poec_depth;
+
+	return (true);
+}
+
 /*
  * _prop_object_externalize_start_tag --
  *	Append an XML-style start tag to the externalize buffer.
@@ -81,13 +343,9 @@ bool
 _prop_object_externalize_start_tag(
     struct _prop_object_externalize_context *ctx, const char *tag)
 {
-	unsigned int i;
 
-	for (i = 0; i < ctx->poec_depth; i++) {
-		if (_prop_object_externalize_append_char(ctx, '\t') == false)
-			return (false);
-	}
-	if (_prop_object_externalize_append_char(ctx, '<') == false ||
+	if (_prop_object_externalize_append_indent(ctx) == false ||
+	    _prop_object_externalize_append_char(ctx, '<') == false ||
 	    _prop_object_externalize_append_cstring(ctx, tag) == false ||
 	    _prop_object_externalize_append_char(ctx, '>') == false)
 		return (false);
@@ -104,11 +362,9 @@ _prop_object_externalize_end_tag(
     struct _prop_object_externalize_context *ctx, const char *tag)
 {
 
-	if (_prop_object_externalize_append_char(ctx, '<') == false ||
-	    _prop_object_externalize_append_char(ctx, '/') == false ||
+	if (_prop_object_externalize_append(ctx, "</", 2) == false ||
 	    _prop_object_externalize_append_cstring(ctx, tag) == false ||
-	    _prop_object_externalize_append_char(ctx, '>') == false ||
-	    _prop_object_externalize_append_char(ctx, '\n') == false)
+	    _prop_object_externalize_append(ctx, ">\n", 2) == false)
 		return (false);
 
 	return (true);
@@ -122,18 +378,11 @@ bool
 _prop_object_externalize_empty_tag(
     struct _prop_object_externalize_context *ctx, const char *tag)
 {
-	unsigned int i;
-
-	for (i = 0; i < ctx->poec_depth; i++) {
-		if (_prop_object_externalize_append_char(ctx, '\t') == false)
-			return (false);
-	}
 
-	if (_prop_object_externalize_append_char(ctx, '<') == false ||
+	if (_prop_object_externalize_append_indent(ctx) == false ||
+	    _prop_object_externalize_append_char(ctx, '<') == false ||
 	    _prop_object_externalize_append_cstring(ctx, tag) == false ||
-	    _prop_object_externalize_append_char(ctx, '/') == false ||
-	    _prop_object_externalize_append_char(ctx, '>') == false ||
-	    _prop_object_externalize_append_char(ctx, '\n') == false)
+	    _prop_object_externalize_append(ctx, "/>\n", 3) == false)
 	    	return (false);
 	
 	return (true);
@@ -148,56 +397,50 @@ _prop_object_externalize_append_cstring(
     struct _prop_object_externalize_context *ctx, const char *cp)
 {
 
-	while (*cp != '\0') {
-		if (_prop_object_externalize_append_char(ctx,
-						(unsigned char) *cp) == false)
-			return (false);
-		cp++;
-	}
-
-	return (true);
+	return (_prop_object_externalize_append(ctx, cp, strlen(cp)));
 }
 
 /*
  * _prop_object_externalize_append_encoded_cstring --
- *	Append an encoded C string to the externalize buffer.
+ *	Append an encoded C string to the externalize buffer.  Runs of
+ *	characters that don't need to be escaped are copied at once.
  */
 bool
 _prop_object_externalize_append_encoded_cstring(
     struct _prop_object_externalize_context *ctx, const char *cp)
 {
+	size_t len;
+
+	for (;;) {
+		len = strcspn(cp, "<>&");
+		if (len != 0 &&
+		    _prop_object_externalize_append(ctx, cp, len) == false)
+			return (false);
+		cp += len;
 
-	while (*cp != '\0') {
 		switch (*cp) {
+		case '\0':
+			return (true);
 		case '<':
-			if (_prop_object_externalize_append_cstring(ctx,
-					"&lt;") == false)
+			if (_prop_object_externalize_append(ctx,
+					"&lt;", 4) == false)
 				return (false);
 			break;
 		case '>':
-			if (_prop_object_externalize_append_cstring(ctx,
-					"&gt;") == false)
+			if (_prop_object_externalize_append(ctx,
+					"&gt;", 4) == false)
 				return (false);
 			break;
 		case '&':
-			if (_prop_object_externalize_append_cstring(ctx,
-					"&amp;") == false)
-				return (false);
-			break;
-		default:
-			if (_prop_object_externalize_append_char(ctx,
-					(unsigned char) *cp) == false)
+			if (_prop_object_externalize_append(ctx,
+					"&amp;", 5) == false)
 				return (false);
 			break;
 		}
 		cp++;
 	}
-
-	return (true);
 }
 
-#define	BUF_EXPAND		256
-
 /*
  * _prop_object_externalize_append_char --
  *	Append a single character to the externalize buffer.
@@ -207,19 +450,9 @@ _prop_object_externalize_append_char(
     struct _prop_object_externalize_context *ctx, unsigned char c)
 {
 
-	_PROP_ASSERT(ctx->poec_capacity != 0);
-	_PROP_ASSERT(ctx->poec_buf != NULL);
-	_PROP_ASSERT(ctx->poec_len <= ctx->poec_capacity);
-
-	if (ctx->poec_len == ctx->poec_capacity) {
-		char *cp = _PROP_REALLOC(ctx->poec_buf,
-					 ctx->poec_capacity + BUF_EXPAND,
-					 M_TEMP);
-		if (cp == NULL)
-			return (false);
-		ctx->poec_capacity = ctx->poec_capacity + BUF_EXPAND;
-		ctx->poec_buf = cp;
-	}
+	if (ctx->poec_len == ctx->poec_capacity &&
+	    _prop_object_externalize_reserve(ctx, 1) == false)
+		return (false);
 
 	ctx->poec_buf[ctx->poec_len++] = c;
 
@@ -250,17 +483,20 @@ _prop_object_externalize_header(struct _prop_object_externalize_context *ctx)
 /*
  * _prop_object_externalize_footer --
  *	Append the standard XML footer to the externalize buffer.  This
- *	also NUL-terminates the buffer.
+ *	also NUL-terminates the buffer, or flushes it to the file.
  */
 bool
 _prop_object_externalize_footer(struct _prop_object_externalize_context *ctx)
 {
 
-	if (_prop_object_externalize_end_tag(ctx, "plist") == false ||
-	    _prop_object_externalize_append_char(ctx, '\0') == false)
+	if (_prop_object_externalize_end_tag(ctx, "plist") == false)
 		return (false);
 
-	return (true);
+	/* Nothing to terminate when writing to a file. */
+	if (ctx->poec_fd != -1)
+		return (_prop_object_externalize_flush(ctx));
+
+	return (_prop_object_externalize_append_char(ctx, '\0'));
 }
 
 /*
@@ -282,6 +518,7 @@ _prop_object_externalize_context_alloc(void)
 		ctx->poec_len = 0;
 		ctx->poec_capacity = BUF_EXPAND;
 		ctx->poec_depth = 0;
+		ctx->poec_fd = -1;
 	}
 	return (ctx);
 }
@@ -469,6 +706,36 @@ _prop_object_internalize_find_tag(struct _prop_object_internalize_context *ctx,
 	return (true);
 }
 
+/*
+ * _prop_object_internalize_skip --
+ *	Skip the element whose start tag has just been found, without
+ *	creating any object.  Upon success, the context points to the
+ *	first octet after the matching end tag.
+ */
+bool
+_prop_object_internalize_skip(struct _prop_object_internalize_context *ctx)
+{
+	unsigned int depth = 1;
+
+	if (ctx->poic_is_empty_element)
+		return (true);
+
+	while (depth != 0) {
+		/* Skip the contents up to the next tag. */
+		ctx->poic_cp = strchr(ctx->poic_cp, '<');
+		if (ctx->poic_cp == NULL)
+			return (false);
+		if (_prop_object_internalize_find_tag(ctx, NULL,
+		    _PROP_TAG_TYPE_EITHER) == false)
+			return (false);
+		if (ctx->poic_tag_type == _PROP_TAG_TYPE_END)
+			depth--;
+		else if (!ctx->poic_is_empty_element)
+			depth++;
+	}
+	return (true);
+}
+
 /*
  * _prop_object_internalize_decode_string --
  *	Decode an encoded string.
@@ -632,8 +899,9 @@ match_start:
 	return (parent_obj);
 }
 
-prop_object_t
-_prop_generic_internalize(const char *xml, const char *master_tag)
+static prop_object_t
+_prop_generic_internalize_common(const char *xml, const char *master_tag,
+    bool arena)
 {
 	prop_object_t obj = NULL;
 	struct _prop_object_internalize_context *ctx;
@@ -642,6 +910,10 @@ _prop_generic_internalize(const char *xml, const char *master_tag)
 	if (ctx == NULL)
 		return (NULL);
 
+	if (arena && ((ctx->poic_arena = _prop_arena_create()) == NULL ||
+	    (ctx->poic_intern = _prop_string_intern_create()) == NULL))
+		goto out;
+
 	/* We start with a <plist> tag. */
 	if (_prop_object_internalize_find_tag(ctx, "plist",
 					      _PROP_TAG_TYPE_START) == false)
@@ -684,6 +956,23 @@ _prop_generic_internalize(const char *xml, const char *master_tag)
 	return (obj);
 }
 
+prop_object_t
+_prop_generic_internalize(const char *xml, const char *master_tag)
+{
+	return _prop_generic_internalize_common(xml, master_tag, false);
+}
+
+/*
+ * _prop_generic_internalize_arena --
+ *	Like _prop_generic_internalize(), but the objects are allocated
+ *	from an arena that is freed when all of them have been released.
+ */
+prop_object_t
+_prop_generic_internalize_arena(const char *xml, const char *master_tag)
+{
+	return _prop_generic_internalize_common(xml, master_tag, true);
+}
+
 /*
  * _prop_object_internalize_context_alloc --
  *	Allocate an internalize context.
@@ -702,6 +991,8 @@ _prop_object_internalize_context_alloc(const char *xml)
 		return (NULL);
 	
 	ctx->poic_xml = ctx->poic_cp = xml;
+	ctx->poic_arena = NULL;
+	ctx->poic_intern = NULL;
 
 	/*
 	 * Skip any whitespace and XML preamble stuff that we don't
@@ -764,6 +1055,10 @@ _prop_object_internalize_context_free(
 		struct _prop_object_internalize_context *ctx)
 {
 
+	if (ctx->poic_intern != NULL)
+		_prop_string_intern_destroy(ctx->poic_intern);
+	if (ctx->poic_arena != NULL)
+		_prop_arena_release(ctx->poic_arena);
 	_PROP_FREE(ctx, M_TEMP);
 }
 
@@ -813,6 +1108,104 @@ _prop_object_externalize_file_dirname(const char *path, char *result)
 	strcpy(result, ".");
 }
 
+/*
+ * _prop_object_externalize_mkstemp --
+ *	Create the temporary file an externalized object is written to,
+ *	in the same directory as fname.  tname must be PATH_MAX long.
+ */
+static int
+_prop_object_externalize_mkstemp(const char *fname, char *tname)
+{
+	mode_t myumask;
+	int fd;
+
+	/*
+	 * Get the directory name where the file is to be written
+	 * and create the temporary file.
+	 */
+	_prop_object_externalize_file_dirname(fname, tname);
+#define PLISTTMP "/.plistXXXXXX"
+	if (strlen(tname) + strlen(PLISTTMP) >= PATH_MAX) {
+		errno = ENAMETOOLONG;
+		return (-1);
+	}
+	strcat(tname, PLISTTMP);
+#undef PLISTTMP
+
+	myumask = umask(S_IXUSR|S_IRWXG|S_IRWXO);
+	fd = mkstemp(tname);
+	umask(myumask);
+
+	return (fd);
+}
+
+/*
+ * _prop_object_externalize_to_file --
+ *	Externalize an object to the specified file, as done by
+ *	_prop_object_externalize_write_file(), but the XML is written
+ *	in blocks while it's generated instead of being built in memory.
+ */
+bool
+_prop_object_externalize_to_file(prop_object_t obj, const char *fname)
+{
+	struct _prop_object *po = obj;
+	struct _prop_object_externalize_context *ctx;
+	char tname[PATH_MAX], *cp;
+	int fd, save_errno;
+	mode_t myumask;
+	bool rv;
+
+	if ((fd = _prop_object_externalize_mkstemp(fname, tname)) == -1)
+		return (false);
+
+	if ((ctx = _prop_object_externalize_context_alloc()) == NULL)
+		goto bad;
+	if ((cp = _PROP_REALLOC(ctx->poec_buf, BUF_FLUSH, M_TEMP)) == NULL) {
+		_PROP_FREE(ctx->poec_buf, M_TEMP);
+		_prop_object_externalize_context_free(ctx);
+		goto bad;
+	}
+	ctx->poec_buf = cp;
+	ctx->poec_capacity = BUF_FLUSH;
+	ctx->poec_fd = fd;
+
+	rv = _prop_object_externalize_header(ctx) &&
+	    (*po->po_type->pot_extern)(ctx, po) &&
+	    _prop_object_externalize_footer(ctx);
+	_PROP_FREE(ctx->poec_buf, M_TEMP);
+	_prop_object_externalize_context_free(ctx);
+	if (rv == false)
+		goto bad;
+
+#ifdef HAVE_FDATASYNC
+	if (fdatasync(fd) == -1)
+#else
+	if (fsync(fd) == -1)
+#endif
+		goto bad;
+
+	myumask = umask(0);
+	(void)umask(myumask);
+	if (fchmod(fd, 0666 & ~myumask) == -1)
+		goto bad;
+
+	(void)close(fd);
+	fd = -1;
+
+	if (rename(tname, fname) == -1)
+		goto bad;
+
+	return (true);
+
+ bad:
+	save_errno = errno;
+	if (fd != -1)
+		(void)close(fd);
+	(void)unlink(tname);
+	errno = save_errno;
+	return (false);
+}
+
 /*
  * _prop_object_externalize_write_file --
  *	Write an externalized dictionary to the specified file.
@@ -837,25 +1230,8 @@ _prop_object_externalize_write_file(const char *fname, const char *xml,
 		return (false);
 	}
 
-	/*
-	 * Get the directory name where the file is to be written
-	 * and create the temporary file.
-	 */
-	_prop_object_externalize_file_dirname(fname, tname);
-#define PLISTTMP "/.plistXXXXXX"
-	if (strlen(tname) + strlen(PLISTTMP) >= sizeof(tname)) {
-		errno = ENAMETOOLONG;
-		return (false);
-	}
-	strcat(tname, PLISTTMP);
-#undef PLISTTMP
-
-	myumask = umask(S_IXUSR|S_IRWXG|S_IRWXO);
-	if ((fd = mkstemp(tname)) == -1) {
-		umask(myumask);
+	if ((fd = _prop_object_externalize_mkstemp(fname, tname)) == -1)
 		return (false);
-	}
-	umask(myumask);
 
 	if (do_compress) {
 		if ((gzf = gzdopen(fd, "a")) == NULL)
@@ -996,6 +1372,165 @@ _prop_object_internalize_unmap_file(
 	_PROP_FREE(mf, M_TEMP);
 }
 
+#define	PUT_MINSIZE	64
+#define	PUT_SHARD(put, h)	\
+	(&(put)->put_shards[((h) >> 24) % _PROP_UNIQ_NSHARDS])
+#define	PUT_NODE(put, po)	\
+	((struct _prop_uniq_node *)((char *)(po) + (put)->put_node_offset))
+#define	PUT_OBJECT(put, n)	\
+	((prop_object_t)((char *)(n) - (put)->put_node_offset))
+
+/*
+ * _prop_uniq_init --
+ *	Initialize an empty uniquing table.
+ */
+void
+_prop_uniq_init(struct _prop_uniq_table *put,
+    bool (*match)(const void *, const void *), size_t node_offset)
+{
+	unsigned int i;
+
+	put->put_match = match;
+	put->put_node_offset = node_offset;
+	for (i = 0; i < _PROP_UNIQ_NSHARDS; i++) {
+		_PROP_MUTEX_INIT(put->put_shards[i].pus_mtx);
+		put->put_shards[i].pus_buckets = NULL;
+		put->put_shards[i].pus_size = 0;
+		put->put_shards[i].pus_count = 0;
+	}
+}
+
+/*
+ * _prop_uniq_lookup --
+ *	Find a live object matching key and retain it.  The shard
+ *	must be locked.
+ */
+static prop_object_t
+_prop_uniq_lookup(struct _prop_uniq_table *put, struct _prop_uniq_shard *pus,
+    uint32_t hash, const void *key)
+{
+	struct _prop_uniq_node *pun;
+	struct _prop_object *po;
+	bool live;
+
+	if (pus->pus_size == 0)
+		return (NULL);
+
+	for (pun = pus->pus_buckets[hash & (pus->pus_size - 1)]; pun != NULL;
+	     pun = pun->pun_next) {
+		if (pun->pun_hash != hash)
+			continue;
+		po = PUT_OBJECT(put, pun);
+		if (!(*put->put_match)(po, key))
+			continue;
+		/* Skip objects being freed, their pot_free will unlink them. */
+		_PROP_ATOMIC_INC32_NZ(&po->po_refcnt, live);
+		if (live)
+			return (po);
+	}
+	return (NULL);
+}
+
+/*
+ * _prop_uniq_grow --
+ *	Double the number of buckets in a shard.  The shard must be locked.
+ */
+static bool
+_prop_uniq_grow(struct _prop_uniq_shard *pus)
+{
+	struct _prop_uniq_node **buckets, *pun, *next;
+	unsigned int i, nsize, mask;
+
+	nsize = pus->pus_size == 0 ? PUT_MINSIZE : pus->pus_size * 2;
+	buckets = _PROP_CALLOC(nsize * sizeof(*buckets), M_TEMP);
+	if (buckets == NULL)
+		return (false);
+
+	mask = nsize - 1;
+	for (i = 0; i < pus->pus_size; i++) {
+		for (pun = pus->pus_buckets[i]; pun != NULL; pun = next) {
+			next = pun->pun_next;
+			pun->pun_next = buckets[pun->pun_hash & mask];
+			buckets[pun->pun_hash & mask] = pun;
+		}
+	}
+	if (pus->pus_buckets != NULL)
+		_PROP_FREE(pus->pus_buckets, M_TEMP);
+	pus->pus_buckets = buckets;
+	pus->pus_size = nsize;
+	return (true);
+}
+
+/*
+ * _prop_uniq_find --
+ *	Return the object matching key retained, or NULL.
+ */
+prop_object_t
+_prop_uniq_find(struct _prop_uniq_table *put, uint32_t hash, const void *key)
+{
+	struct _prop_uniq_shard *pus = PUT_SHARD(put, hash);
+	prop_object_t po;
+
+	_PROP_MUTEX_LOCK(pus->pus_mtx);
+	po = _prop_uniq_lookup(put, pus, hash, key);
+	_PROP_MUTEX_UNLOCK(pus->pus_mtx);
+
+	return (po);
+}
+
+/*
+ * _prop_uniq_insert --
+ *	Insert a new object, whose node hash has been set, unless another
+ *	thread beat us to it.  Returns the object in the table (retained
+ *	if it's not ours) or NULL if we ran out of memory; in both latter
+ *	cases the caller must dispose of its object.
+ */
+prop_object_t
+_prop_uniq_insert(struct _prop_uniq_table *put, prop_object_t obj,
+    const void *key)
+{
+	struct _prop_uniq_node *pun = PUT_NODE(put, obj);
+	struct _prop_uniq_shard *pus = PUT_SHARD(put, pun->pun_hash);
+	prop_object_t po;
+
+	_PROP_MUTEX_LOCK(pus->pus_mtx);
+	po = _prop_uniq_lookup(put, pus, pun->pun_hash, key);
+	if (po == NULL) {
+		if (pus->pus_count >= pus->pus_size &&
+		    !_prop_uniq_grow(pus) && pus->pus_size == 0) {
+			_PROP_MUTEX_UNLOCK(pus->pus_mtx);
+			return (NULL);
+		}
+		pun->pun_next =
+		    pus->pus_buckets[pun->pun_hash & (pus->pus_size - 1)];
+		pus->pus_buckets[pun->pun_hash & (pus->pus_size - 1)] = pun;
+		pus->pus_count++;
+		po = obj;
+	}
+	_PROP_MUTEX_UNLOCK(pus->pus_mtx);
+
+	return (po);
+}
+
+/*
+ * _prop_uniq_remove --
+ *	Unlink an object from its table, called from its pot_free.
+ */
+void
+_prop_uniq_remove(struct _prop_uniq_table *put, prop_object_t obj)
+{
+	struct _prop_uniq_node *pun = PUT_NODE(put, obj), **pp;
+	struct _prop_uniq_shard *pus = PUT_SHARD(put, pun->pun_hash);
+
+	_PROP_MUTEX_LOCK(pus->pus_mtx);
+	for (pp = &pus->pus_buckets[pun->pun_hash & (pus->pus_size - 1)];
+	     *pp != pun; pp = &(*pp)->pun_next)
+		_PROP_ASSERT(*pp != NULL);
+	*pp = pun->pun_next;
+	pus->pus_count--;
+	_PROP_MUTEX_UNLOCK(pus->pus_mtx);
+}
+
 /*
  * prop_object_retain --
  *	Increment the reference count on an object.
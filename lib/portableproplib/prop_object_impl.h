@@ -40,6 +40,7 @@ struct _prop_object_externalize_context {
 	size_t		poec_capacity;		/* capacity of buffer */
 	size_t		poec_len;		/* current length of string */
 	unsigned int	poec_depth;		/* nesting depth */
+	int		poec_fd;		/* file to flush to, or -1 */
 };
 
 bool		_prop_object_externalize_start_tag(
@@ -91,6 +92,9 @@ struct _prop_object_internalize_context {
 
 	bool   poic_is_empty_element;
 	_prop_tag_type_t poic_tag_type;
+
+	struct _prop_arena *poic_arena;	/* arena for new objects, or NULL */
+	struct _prop_string_intern *poic_intern; /* interned strings, or NULL */
 };
 
 typedef enum {
@@ -131,10 +135,13 @@ bool		_prop_object_internalize_match(const char *, size_t,
 					       const char *, size_t);
 prop_object_t	_prop_object_internalize_by_tag(
 				struct _prop_object_internalize_context *);
+bool		_prop_object_internalize_skip(
+				struct _prop_object_internalize_context *);
 bool		_prop_object_internalize_decode_string(
 				struct _prop_object_internalize_context *,
 				char *, size_t, size_t *, const char **);
 prop_object_t	_prop_generic_internalize(const char *, const char *);
+prop_object_t	_prop_generic_internalize_arena(const char *, const char *);
 
 struct _prop_object_internalize_context *
 		_prop_object_internalize_context_alloc(const char *);
@@ -143,6 +150,7 @@ void		_prop_object_internalize_context_free(
 
 bool		_prop_object_externalize_write_file(const char *,
 						    const char *, size_t, bool);
+bool		_prop_object_externalize_to_file(prop_object_t, const char *);
 
 struct _prop_object_internalize_mapped_file {
 	char *	poimf_xml;
@@ -210,8 +218,31 @@ struct _prop_object_type {
 struct _prop_object {
 	const struct _prop_object_type *po_type;/* type descriptor */
 	uint32_t	po_refcnt;		/* reference count */
+	uint32_t	po_flags;		/* set by the pool allocator */
 };
 
+#define	_PROP_OBJECT_F_ARENA	0x01	/* object lives in an arena */
+
+/*
+ * Arenas are used to allocate the objects created by a single internalize
+ * call from a few large blocks rather than one malloc(3) per object.
+ * An arena is freed at once when its last object is released.
+ */
+struct _prop_arena;
+
+struct _prop_arena *
+		_prop_arena_create(void);
+void		_prop_arena_release(struct _prop_arena *);
+void *		_prop_arena_alloc(struct _prop_arena *, size_t);
+void *		_prop_pool_get(size_t, struct _prop_arena *);
+
+struct _prop_string_intern;
+
+struct _prop_string_intern *
+		_prop_string_intern_create(void);
+void		_prop_string_intern_destroy(struct _prop_string_intern *);
+void		_prop_pool_put(void *);
+
 void		_prop_object_init(struct _prop_object *,
 				  const struct _prop_object_type *);
 void		_prop_object_fini(struct _prop_object *);
@@ -249,21 +280,65 @@ struct _prop_object_iterator {
 #define	_PROP_REALLOC(v, s, t)		realloc((v), (s))
 #define	_PROP_FREE(v, t)		free((v))
 
-#define	_PROP_POOL_GET(p)		malloc((p))
-#define	_PROP_POOL_PUT(p, v)		free((v))
+#define	_PROP_POOL_GET(p)		_prop_pool_get((p), NULL)
+#define	_PROP_POOL_GET_ARENA(p, a)	_prop_pool_get((p), (a))
+#define	_PROP_POOL_PUT(p, v)		_prop_pool_put((v))
 
 #define	_PROP_POOL_INIT(p, s, d)	static const size_t p = s;
 
 #define	_PROP_MALLOC_DEFINE(t, s, l)	/* nothing */
 
+#ifdef SINGLE_THREADED
+/*
+ * Built for single threaded programs: objects are never shared across
+ * threads, so there's nothing to lock and reference counts don't need
+ * to be updated atomically.
+ */
+#define	_PROP_MUTEX_DECL(x)		/* nothing */
+#define	_PROP_MUTEX_DECL_STATIC(x)	/* nothing */
+#define	_PROP_MUTEX_INIT(x)		((void)0)
+#define	_PROP_MUTEX_LOCK(x)		((void)0)
+#define	_PROP_MUTEX_UNLOCK(x)		((void)0)
+#define	_PROP_MUTEX_DESTROY(x)		((void)0)
+
+#define	_PROP_RWLOCK_DECL(x)		/* nothing */
+#define	_PROP_RWLOCK_INIT(x)		((void)0)
+#define	_PROP_RWLOCK_RDLOCK(x)		((void)0)
+#define	_PROP_RWLOCK_WRLOCK(x)		((void)0)
+#define	_PROP_RWLOCK_UNLOCK(x)		((void)0)
+#define	_PROP_RWLOCK_DESTROY(x)		((void)0)
+
+#define _PROP_ONCE_DECL(x)		static bool x;
+#define _PROP_ONCE_RUN(x,f)						\
+do {									\
+	if (!(x)) {							\
+		(x) = true;						\
+		(void)(f)();						\
+	}								\
+} while (/*CONSTCOND*/0)
+
+#define _PROP_ATOMIC_INC32(x)		((void)++(*(x)))
+#define _PROP_ATOMIC_DEC32(x)		((void)--(*(x)))
+#define _PROP_ATOMIC_INC32_NV(x, v)	((v) = ++(*(x)))
+#define _PROP_ATOMIC_DEC32_NV(x, v)	((v) = --(*(x)))
+#define _PROP_ATOMIC_INC32_NZ(x, r)	((r) = (*(x) != 0 && ++(*(x))))
+
+#define _PROP_ATOMIC_LOAD32(x, v)	((v) = *(x))
+#define _PROP_ATOMIC_LOAD_PTR(x, v)	((v) = *(x))
+#define _PROP_ATOMIC_STORE_PTR(x, v)	((void)(*(x) = (v)))
+
+#else /* !SINGLE_THREADED */
+
 /*
  * Use pthread mutexes everywhere else.
  */
 #include <pthread.h>
+#define	_PROP_MUTEX_DECL(x)		pthread_mutex_t x;
 #define	_PROP_MUTEX_DECL_STATIC(x)	static pthread_mutex_t x;
 #define	_PROP_MUTEX_INIT(x)		pthread_mutex_init(&(x), NULL)
 #define	_PROP_MUTEX_LOCK(x)		pthread_mutex_lock(&(x))
 #define	_PROP_MUTEX_UNLOCK(x)		pthread_mutex_unlock(&(x))
+#define	_PROP_MUTEX_DESTROY(x)		pthread_mutex_destroy(&(x))
 
 #define	_PROP_RWLOCK_DECL(x)		pthread_rwlock_t x ;
 #define	_PROP_RWLOCK_INIT(x)		pthread_rwlock_init(&(x), NULL)
@@ -279,6 +354,7 @@ struct _prop_object_iterator {
 #ifndef HAVE_ATOMICS /* NO ATOMIC SUPPORT, USE A MUTEX */
 
 #define _PROP_NEED_REFCNT_MTX
+extern pthread_mutex_t _prop_refcnt_mtx;
 #define _PROP_ATOMIC_INC32(x) \
 	do { \
 		pthread_mutex_lock(&_prop_refcnt_mtx); \
@@ -303,6 +379,30 @@ struct _prop_object_iterator {
 		v = --(*(x)); \
 		pthread_mutex_unlock(&_prop_refcnt_mtx); \
 	} while (/*CONSTCOND*/0)
+#define _PROP_ATOMIC_INC32_NZ(x, r) \
+	do { \
+		pthread_mutex_lock(&_prop_refcnt_mtx); \
+		r = (*(x) != 0 && ++(*(x))); \
+		pthread_mutex_unlock(&_prop_refcnt_mtx); \
+	} while (/*CONSTCOND*/0)
+#define _PROP_ATOMIC_LOAD32(x, v) \
+	do { \
+		pthread_mutex_lock(&_prop_refcnt_mtx); \
+		v = *(x); \
+		pthread_mutex_unlock(&_prop_refcnt_mtx); \
+	} while (/*CONSTCOND*/0)
+#define _PROP_ATOMIC_LOAD_PTR(x, v) \
+	do { \
+		pthread_mutex_lock(&_prop_refcnt_mtx); \
+		v = *(x); \
+		pthread_mutex_unlock(&_prop_refcnt_mtx); \
+	} while (/*CONSTCOND*/0)
+#define _PROP_ATOMIC_STORE_PTR(x, v) \
+	do { \
+		pthread_mutex_lock(&_prop_refcnt_mtx); \
+		*(x) = (v); \
+		pthread_mutex_unlock(&_prop_refcnt_mtx); \
+	} while (/*CONSTCOND*/0)
 
 #else /* GCC ATOMIC BUILTINS */
 
@@ -326,8 +426,79 @@ do {									\
 	v = __sync_sub_and_fetch(x, 1);					\
 } while (/*CONSTCOND*/0)
 
+/* Increment unless zero; r tells whether it was incremented. */
+#define _PROP_ATOMIC_INC32_NZ(x, r)					\
+do {									\
+	uint32_t _o;							\
+	r = false;							\
+	for (_o = __sync_fetch_and_add(x, 0); _o != 0;) {		\
+		uint32_t _n = __sync_val_compare_and_swap(x, _o, _o + 1);	\
+		if (_n == _o) {						\
+			r = true;					\
+			break;						\
+		}							\
+		_o = _n;						\
+	}								\
+} while (/*CONSTCOND*/0)
+
+#define _PROP_ATOMIC_LOAD32(x, v)					\
+do {									\
+	v = __atomic_load_n(x, __ATOMIC_ACQUIRE);			\
+} while (/*CONSTCOND*/0)
+
+/* Pointers published to readers that don't take any lock. */
+#define _PROP_ATOMIC_LOAD_PTR(x, v)					\
+do {									\
+	v = __atomic_load_n(x, __ATOMIC_ACQUIRE);			\
+} while (/*CONSTCOND*/0)
+
+#define _PROP_ATOMIC_STORE_PTR(x, v)					\
+do {									\
+	__atomic_store_n(x, v, __ATOMIC_RELEASE);			\
+} while (/*CONSTCOND*/0)
+
 #endif /* !HAVE_ATOMICS */
 
+#endif /* SINGLE_THREADED */
+
+/*
+ * Uniquing tables hold the only copy of the immutable objects which are
+ * shared by value (dictionary keysyms and numbers).  They are split in
+ * shards chosen by the object hash, each one with its own lock, so that
+ * threads creating and releasing unrelated objects don't contend.
+ *
+ * An object whose reference count dropped to zero stays in the table
+ * until its pot_free removes it, lookups skip it in the meantime.
+ */
+#define	_PROP_UNIQ_NSHARDS	32
+
+struct _prop_uniq_node {
+	struct _prop_uniq_node	*pun_next;
+	uint32_t		pun_hash;
+};
+
+struct _prop_uniq_shard {
+	_PROP_MUTEX_DECL(pus_mtx)
+	struct _prop_uniq_node	**pus_buckets;
+	unsigned int		pus_size;
+	unsigned int		pus_count;
+};
+
+struct _prop_uniq_table {
+	/* does the object hold the given key? */
+	bool		(*put_match)(const void *, const void *);
+	size_t		put_node_offset;
+	struct _prop_uniq_shard put_shards[_PROP_UNIQ_NSHARDS];
+};
+
+void		_prop_uniq_init(struct _prop_uniq_table *,
+				bool (*)(const void *, const void *), size_t);
+prop_object_t	_prop_uniq_find(struct _prop_uniq_table *, uint32_t,
+				const void *);
+prop_object_t	_prop_uniq_insert(struct _prop_uniq_table *, prop_object_t,
+				  const void *);
+void		_prop_uniq_remove(struct _prop_uniq_table *, prop_object_t);
+
 /*
  * Language features.
  */
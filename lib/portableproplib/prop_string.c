@@ -45,6 +45,23 @@ struct _prop_string {
 };
 
 #define	PS_F_NOCOPY		0x01
+#define	PS_F_ARENA		0x02	/* contents live in the object's arena */
+#define	PS_F_INTERNED		0x04	/* shared through an intern table */
+
+/*
+ * Internalizing into an arena also interns short string values, so that
+ * values repeated across a large tree (architectures, licenses, common
+ * dependency patterns) are stored only once.  Interned strings are
+ * shared, and thus immutable.
+ */
+#define	PS_INTERN_MAXLEN	128
+#define	PS_INTERN_MINSIZE	256	/* power of 2 */
+
+struct _prop_string_intern {
+	prop_string_t		*psi_tab;
+	unsigned int		psi_size;
+	unsigned int		psi_count;
+};
 
 _PROP_POOL_INIT(_prop_string_pool, sizeof(struct _prop_string), "propstng")
 
@@ -76,7 +93,8 @@ _prop_string_free(prop_stack_t stack, prop_object_t *obj)
 {
 	prop_string_t ps = *obj;
 
-	if ((ps->ps_flags & PS_F_NOCOPY) == 0 && ps->ps_mutable != NULL)
+	if ((ps->ps_flags & (PS_F_NOCOPY|PS_F_ARENA)) == 0 &&
+	    ps->ps_mutable != NULL)
 	    	_PROP_FREE(ps->ps_mutable, M_PROP_STRING);
 	_PROP_POOL_PUT(_prop_string_pool, ps);
 
@@ -121,11 +139,11 @@ _prop_string_equals(prop_object_t v1, prop_object_t v2,
 }
 
 static prop_string_t
-_prop_string_alloc(void)
+_prop_string_alloc(struct _prop_arena *arena)
 {
 	prop_string_t ps;
 
-	ps = _PROP_POOL_GET(_prop_string_pool);
+	ps = _PROP_POOL_GET_ARENA(_prop_string_pool, arena);
 	if (ps != NULL) {
 		_prop_object_init(&ps->ps_obj, &_prop_object_type_string);
 
@@ -145,7 +163,7 @@ prop_string_t
 prop_string_create(void)
 {
 
-	return (_prop_string_alloc());
+	return (_prop_string_alloc(NULL));
 }
 
 /*
@@ -159,7 +177,7 @@ prop_string_create_cstring(const char *str)
 	char *cp;
 	size_t len;
 
-	ps = _prop_string_alloc();
+	ps = _prop_string_alloc(NULL);
 	if (ps != NULL) {
 		len = strlen(str);
 		cp = _PROP_MALLOC(len + 1, M_PROP_STRING);
@@ -184,7 +202,7 @@ prop_string_create_cstring_nocopy(const char *str)
 {
 	prop_string_t ps;
 	
-	ps = _prop_string_alloc();
+	ps = _prop_string_alloc(NULL);
 	if (ps != NULL) {
 		ps->ps_immutable = str;
 		ps->ps_size = strlen(str);
@@ -206,10 +224,10 @@ prop_string_copy(prop_string_t ops)
 	if (! prop_object_is_string(ops))
 		return (NULL);
 
-	ps = _prop_string_alloc();
+	ps = _prop_string_alloc(NULL);
 	if (ps != NULL) {
 		ps->ps_size = ops->ps_size;
-		ps->ps_flags = ops->ps_flags;
+		ps->ps_flags = ops->ps_flags & ~(PS_F_ARENA|PS_F_INTERNED);
 		if (ops->ps_flags & PS_F_NOCOPY)
 			ps->ps_immutable = ops->ps_immutable;
 		else {
@@ -238,7 +256,7 @@ prop_string_copy_mutable(prop_string_t ops)
 	if (! prop_object_is_string(ops))
 		return (NULL);
 
-	ps = _prop_string_alloc();
+	ps = _prop_string_alloc(NULL);
 	if (ps != NULL) {
 		ps->ps_size = ops->ps_size;
 		cp = _PROP_MALLOC(ps->ps_size + 1, M_PROP_STRING);
@@ -277,7 +295,7 @@ prop_string_mutable(prop_string_t ps)
 	if (! prop_object_is_string(ps))
 		return (false);
 
-	return ((ps->ps_flags & PS_F_NOCOPY) == 0);
+	return ((ps->ps_flags & (PS_F_NOCOPY|PS_F_INTERNED)) == 0);
 }
 
 /*
@@ -330,7 +348,7 @@ prop_string_append(prop_string_t dst, prop_string_t src)
 	       prop_object_is_string(src)))
 		return (false);
 
-	if (dst->ps_flags & PS_F_NOCOPY)
+	if (dst->ps_flags & (PS_F_NOCOPY|PS_F_INTERNED))
 		return (false);
 
 	len = dst->ps_size + src->ps_size;
@@ -342,8 +360,9 @@ prop_string_append(prop_string_t dst, prop_string_t src)
 	ocp = dst->ps_mutable;
 	dst->ps_mutable = cp;
 	dst->ps_size = len;
-	if (ocp != NULL)
+	if (ocp != NULL && (dst->ps_flags & PS_F_ARENA) == 0)
 		_PROP_FREE(ocp, M_PROP_STRING);
+	dst->ps_flags &= ~PS_F_ARENA;
 	
 	return (true);
 }
@@ -364,7 +383,7 @@ prop_string_append_cstring(prop_string_t dst, const char *src)
 
 	_PROP_ASSERT(src != NULL);
 
-	if (dst->ps_flags & PS_F_NOCOPY)
+	if (dst->ps_flags & (PS_F_NOCOPY|PS_F_INTERNED))
 		return (false);
 	
 	len = dst->ps_size + strlen(src);
@@ -375,8 +394,9 @@ prop_string_append_cstring(prop_string_t dst, const char *src)
 	ocp = dst->ps_mutable;
 	dst->ps_mutable = cp;
 	dst->ps_size = len;
-	if (ocp != NULL)
+	if (ocp != NULL && (dst->ps_flags & PS_F_ARENA) == 0)
 		_PROP_FREE(ocp, M_PROP_STRING);
+	dst->ps_flags &= ~PS_F_ARENA;
 	
 	return (true);
 }
@@ -409,6 +429,141 @@ prop_string_equals_cstring(prop_string_t ps, const char *cp)
 	return (strcmp(prop_string_contents(ps), cp) == 0);
 }
 
+/*
+ * _prop_string_hash --
+ *	FNV-1a hash of a string.
+ */
+static uint32_t
+_prop_string_hash(const char *cp, size_t len)
+{
+	uint32_t h = 2166136261U;
+
+	while (len-- != 0) {
+		h ^= (unsigned char)*cp++;
+		h *= 16777619U;
+	}
+	return (h);
+}
+
+/*
+ * _prop_string_intern_create --
+ *	Create an empty intern table.
+ */
+struct _prop_string_intern *
+_prop_string_intern_create(void)
+{
+
+	return (_PROP_CALLOC(sizeof(struct _prop_string_intern), M_TEMP));
+}
+
+/*
+ * _prop_string_intern_destroy --
+ *	Drop the references held by an intern table and free it.
+ */
+void
+_prop_string_intern_destroy(struct _prop_string_intern *psi)
+{
+	unsigned int i;
+
+	for (i = 0; i < psi->psi_size; i++) {
+		if (psi->psi_tab[i] != NULL)
+			prop_object_release(psi->psi_tab[i]);
+	}
+	if (psi->psi_tab != NULL)
+		_PROP_FREE(psi->psi_tab, M_TEMP);
+	_PROP_FREE(psi, M_TEMP);
+}
+
+/*
+ * _prop_string_intern_slot --
+ *	Return the slot holding the string, or the empty slot where it
+ *	should be inserted.
+ */
+static prop_string_t *
+_prop_string_intern_slot(struct _prop_string_intern *psi, const char *cp,
+    size_t len)
+{
+	prop_string_t *slot;
+	unsigned int i, mask = psi->psi_size - 1;
+
+	for (i = _prop_string_hash(cp, len) & mask;; i = (i + 1) & mask) {
+		slot = &psi->psi_tab[i];
+		if (*slot == NULL || ((*slot)->ps_size == len &&
+		    memcmp((*slot)->ps_immutable, cp, len) == 0))
+			return (slot);
+	}
+}
+
+/*
+ * _prop_string_intern_grow --
+ *	Double the size of an intern table, keeping it at most half full.
+ */
+static bool
+_prop_string_intern_grow(struct _prop_string_intern *psi)
+{
+	prop_string_t *otab = psi->psi_tab, ps;
+	unsigned int i, osize = psi->psi_size;
+
+	psi->psi_size = osize ? osize * 2 : PS_INTERN_MINSIZE;
+	psi->psi_tab = _PROP_CALLOC(psi->psi_size * sizeof(*psi->psi_tab),
+	    M_TEMP);
+	if (psi->psi_tab == NULL) {
+		psi->psi_tab = otab;
+		psi->psi_size = osize;
+		return (false);
+	}
+	for (i = 0; i < osize; i++) {
+		if ((ps = otab[i]) != NULL)
+			*_prop_string_intern_slot(psi, ps->ps_immutable,
+			    ps->ps_size) = ps;
+	}
+	if (otab != NULL)
+		_PROP_FREE(otab, M_TEMP);
+
+	return (true);
+}
+
+/*
+ * _prop_string_intern --
+ *	Return the interned string with the specified contents, creating
+ *	it in the arena if it's not in the table yet.
+ */
+static prop_string_t
+_prop_string_intern(struct _prop_object_internalize_context *ctx,
+    const char *cp, size_t len)
+{
+	struct _prop_string_intern *psi = ctx->poic_intern;
+	prop_string_t *slot, ps;
+	char *str;
+
+	if (psi->psi_count >= psi->psi_size / 2 &&
+	    _prop_string_intern_grow(psi) == false)
+		return (NULL);
+
+	slot = _prop_string_intern_slot(psi, cp, len);
+	if (*slot != NULL) {
+		prop_object_retain(*slot);
+		return (*slot);
+	}
+
+	if ((str = _prop_arena_alloc(ctx->poic_arena, len + 1)) == NULL)
+		return (NULL);
+	if ((ps = _prop_string_alloc(ctx->poic_arena)) == NULL)
+		return (NULL);
+	memcpy(str, cp, len);
+	str[len] = '\0';
+	ps->ps_mutable = str;
+	ps->ps_size = len;
+	ps->ps_flags = PS_F_ARENA|PS_F_INTERNED;
+
+	/* One reference for the table, one for the caller. */
+	prop_object_retain(ps);
+	*slot = ps;
+	psi->psi_count++;
+
+	return (ps);
+}
+
 /*
  * _prop_string_internalize --
  *	Parse a <string>...</string> and return the object created from the
@@ -420,8 +575,9 @@ _prop_string_internalize(prop_stack_t stack, prop_object_t *obj,
     struct _prop_object_internalize_context *ctx)
 {
 	prop_string_t string;
-	char *str;
+	char *str = NULL;
 	size_t len, alen;
+	int flags = 0;
 
 	if (ctx->poic_is_empty_element) {
 		*obj = prop_string_create();
@@ -436,34 +592,51 @@ _prop_string_internalize(prop_stack_t stack, prop_object_t *obj,
 	if (_prop_object_internalize_decode_string(ctx, NULL, 0, &len,
 						   NULL) == false)
 		return (true);
+
+	if (ctx->poic_intern != NULL && len <= PS_INTERN_MAXLEN) {
+		char tmp[PS_INTERN_MAXLEN + 1];
+
+		if (_prop_object_internalize_decode_string(ctx, tmp, len,
+		    &alen, &ctx->poic_cp) == false || alen != len ||
+		    _prop_object_internalize_find_tag(ctx, "string",
+		    _PROP_TAG_TYPE_END) == false)
+			return (true);
+		*obj = _prop_string_intern(ctx, tmp, len);
+		return (true);
+	}
 	
-	str = _PROP_MALLOC(len + 1, M_PROP_STRING);
-	if (str == NULL)
+	/*
+	 * The contents can share the arena with the object, if any.
+	 */
+	if (ctx->poic_arena != NULL &&
+	    (str = _prop_arena_alloc(ctx->poic_arena, len + 1)) != NULL)
+		flags = PS_F_ARENA;
+	else if ((str = _PROP_MALLOC(len + 1, M_PROP_STRING)) == NULL)
 		return (true);
 	
 	if (_prop_object_internalize_decode_string(ctx, str, len, &alen,
 						   &ctx->poic_cp) == false ||
-	    alen != len) {
-		_PROP_FREE(str, M_PROP_STRING);
-		return (true);
-	}
+	    alen != len)
+		goto bad;
 	str[len] = '\0';
 
 	if (_prop_object_internalize_find_tag(ctx, "string",
-					      _PROP_TAG_TYPE_END) == false) {
-		_PROP_FREE(str, M_PROP_STRING);
-		return (true);
-	}
+					      _PROP_TAG_TYPE_END) == false)
+		goto bad;
 
-	string = _prop_string_alloc();
-	if (string == NULL) {
-		_PROP_FREE(str, M_PROP_STRING);
-		return (true);
-	}
+	string = _prop_string_alloc(ctx->poic_arena);
+	if (string == NULL)
+		goto bad;
 
 	string->ps_mutable = str;
 	string->ps_size = len;
+	string->ps_flags = flags;
 	*obj = string;
 
 	return (true);
+
+ bad:
+	if ((flags & PS_F_ARENA) == 0)
+		_PROP_FREE(str, M_PROP_STRING);
+	return (true);
 }
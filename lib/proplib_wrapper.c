@@ -512,6 +512,32 @@ xbps_dictionary_set(xbps_dictionary_t d, const char *s, xbps_object_t o)
 	return prop_dictionary_set(d, s, o);
 }
 
+bool
+xbps_dictionary_append(xbps_dictionary_t d, const char *s, xbps_object_t o)
+{
+	return prop_dictionary_append(d, s, o);
+}
+
+void
+xbps_dictionary_seal(xbps_dictionary_t d)
+{
+	prop_dictionary_seal(d);
+}
+
+xbps_dictionary_t
+xbps_dictionary_create_lazy(unsigned int n,
+		xbps_object_t (*decode)(void *, const void *),
+		void (*fini)(void *), void *cookie)
+{
+	return prop_dictionary_create_lazy(n, decode, fini, cookie);
+}
+
+bool
+xbps_dictionary_append_lazy(xbps_dictionary_t d, const char *s, const void *arg)
+{
+	return prop_dictionary_append_lazy(d, s, arg);
+}
+
 void
 xbps_dictionary_remove(xbps_dictionary_t d, const char *s)
 {
@@ -555,6 +581,32 @@ xbps_dictionary_internalize(const char *s)
 	return prop_dictionary_internalize(s);
 }
 
+xbps_dictionary_t
+xbps_dictionary_internalize_arena(const char *s)
+{
+	return prop_dictionary_internalize_arena(s);
+}
+
+xbps_dictionary_t
+xbps_dictionary_internalize_lazy(char *s)
+{
+	return prop_dictionary_internalize_lazy(s);
+}
+
+xbps_dictionary_t
+xbps_dictionary_internalize_stream(ssize_t (*fn)(void *, void *, size_t),
+		void *arg)
+{
+	return prop_dictionary_internalize_stream(fn, arg);
+}
+
+xbps_dictionary_t
+xbps_dictionary_internalize_stream_arena(ssize_t (*fn)(void *, void *, size_t),
+		void *arg)
+{
+	return prop_dictionary_internalize_stream_arena(fn, arg);
+}
+
 bool
 xbps_dictionary_externalize_to_file(xbps_dictionary_t d, const char *s)
 {
@@ -573,6 +625,12 @@ xbps_dictionary_internalize_from_file(const char *s)
 	return prop_dictionary_internalize_from_file(s);
 }
 
+xbps_dictionary_t
+xbps_dictionary_internalize_from_file_arena(const char *s)
+{
+	return prop_dictionary_internalize_from_file_arena(s);
+}
+
 xbps_dictionary_t
 xbps_dictionary_internalize_from_zfile(const char *s)
 {
@@ -62,9 +62,11 @@ xbps_repo_path_with_name(struct xbps_handle *xhp, const char *url, const char *n
 }
 
 static xbps_dictionary_t
-repo_get_dict(struct xbps_repo *repo)
+repo_get_dict(struct xbps_repo *repo, bool lazy)
 {
 	struct archive_entry *entry;
+	xbps_dictionary_t d;
+	char *buf;
 	int rv;
 
 	if (repo->ar == NULL)
@@ -77,7 +79,26 @@ repo_get_dict(struct xbps_repo *repo)
 		    archive_error_string(repo->ar));
 		return NULL;
 	}
-	return xbps_archive_get_dictionary(repo->ar, entry);
+	/*
+	 * Repository indexes are kept until the repository is released,
+	 * allocate the whole tree from an arena.
+	 */
+	if (!lazy)
+		return xbps_archive_get_dictionary_arena(repo->ar, entry);
+	/*
+	 * Most transactions only look at a handful of packages, so the
+	 * index is internalized lazily: package dictionaries are parsed
+	 * when first requested and the buffer is owned by the dictionary
+	 * from now on.  The whole index XML is therefore kept in memory
+	 * for as long as the repository is open; this is the one index
+	 * path whose memory use is not bounded by the streaming
+	 * internalizer.
+	 */
+	if ((buf = xbps_archive_get_file(repo->ar, entry)) == NULL)
+		return NULL;
+	if ((d = xbps_dictionary_internalize_lazy(buf)) == NULL)
+		free(buf);
+	return d;
 }
 
 bool
@@ -134,12 +155,29 @@ static bool
 repo_open_local(struct xbps_repo *repo, const char *repofile)
 {
 	struct stat st;
+	int rv;
 
 	if (fstat(repo->fd, &st) == -1) {
 		xbps_dbg_printf(repo->xhp, "[repo] `%s' fstat repodata %s\n",
 		    repofile, strerror(errno));
 		return false;
 	}
+	/*
+	 * Use the binary index if it's available and up-to-date.
+	 */
+	if (xbps_repo_binidx_open(repo, repofile, &st)) {
+		xbps_repo_close(repo);
+		return true;
+	}
+
+	/*
+	 * Archives written as multiple zstd frames are decompressed in
+	 * parallel, anything else is streamed through libarchive.
+	 */
+	if ((rv = xbps_repo_frames_open(repo, repofile, &st)) == 0)
+		goto internalize;
+	else if (rv == ENOENT)
+		return false;
 
 	repo->ar = archive_read_new();
 	assert(repo->ar);
@@ -156,7 +194,8 @@ repo_open_local(struct xbps_repo *repo, const char *repofile)
 		    repofile, archive_error_string(repo->ar));
 		return false;
 	}
-	if ((repo->idx = repo_get_dict(repo)) == NULL) {
+internalize:
+	if ((repo->idx = repo_get_dict(repo, true)) == NULL) {
 		xbps_dbg_printf(repo->xhp, "[repo] `%s' failed to internalize "
 		    " index on archive, removing file.\n", repofile);
 		/* broken archive, remove it */
@@ -164,7 +203,7 @@ repo_open_local(struct xbps_repo *repo, const char *repofile)
 		return false;
 	}
 	xbps_dictionary_make_immutable(repo->idx);
-	repo->idxmeta = repo_get_dict(repo);
+	repo->idxmeta = repo_get_dict(repo, false);
 	if (repo->idxmeta != NULL) {
 		repo->is_signed = true;
 		xbps_dictionary_make_immutable(repo->idxmeta);
@@ -174,7 +213,15 @@ repo_open_local(struct xbps_repo *repo, const char *repofile)
 	 * interested in the proplib dictionaries.
 	 */
 	xbps_repo_close(repo);
-
+	/*
+	 * Cache the decoded index of repositories synchronized into
+	 * the metadir, next time the binary index will be used.
+	 */
+	if (repo->is_remote && (rv = xbps_repo_binidx_write(repo->xhp,
+	    repofile, repo->idx, repo->idxmeta)) != 0) {
+		xbps_dbg_printf(repo->xhp, "[repo] `%s' failed to write "
+		    "binary index %s\n", repofile, strerror(rv));
+	}
 	return true;
 }
 
@@ -188,6 +235,9 @@ repo_open_remote(struct xbps_repo *repo)
 	rv = xbps_repo_fetch_remote(repo, rpath);
 	free(rpath);
 	if (rv) {
+		xbps_dictionary_make_immutable(repo->idx);
+		if (repo->idxmeta != NULL)
+			xbps_dictionary_make_immutable(repo->idxmeta);
 		xbps_dbg_printf(repo->xhp, "[repo] `%s' used remotely (kept in memory).\n", repo->uri);
 		if (repo->xhp->state_cb && xbps_repo_key_import(repo) != 0)
 			rv = false;
@@ -195,41 +245,54 @@ repo_open_remote(struct xbps_repo *repo)
 	return rv;
 }
 
+/*
+ * Returns the path to the repository archive of url, in the metadir
+ * for remote repositories.
+ */
+char HIDDEN *
+xbps_repo_file(struct xbps_handle *xhp, const char *url, const char *name)
+{
+	const char *arch;
+	char *rpath, *repofile;
+
+	if (!xbps_repository_is_remote(url)) {
+		/* local repository */
+		return xbps_repo_path_with_name(xhp, url, name);
+	}
+	/* remote repository */
+	if (xhp->target_arch)
+		arch = xhp->target_arch;
+	else
+		arch = xhp->native_arch;
+
+	if ((rpath = xbps_get_remote_repo_string(url)) == NULL)
+		return NULL;
+	repofile = xbps_xasprintf("%s/%s/%s-%s", xhp->metadir, rpath, arch, name);
+	free(rpath);
+	return repofile;
+}
+
 static struct xbps_repo *
 repo_open_with_type(struct xbps_handle *xhp, const char *url, const char *name)
 {
 	struct xbps_repo *repo = NULL;
-	const char *arch;
 	char *repofile = NULL;
 
 	assert(xhp);
 	assert(url);
 
-	if (xhp->target_arch)
-		arch = xhp->target_arch;
-	else
-		arch = xhp->native_arch;
-
 	repo = calloc(1, sizeof(struct xbps_repo));
 	assert(repo);
+	repo->pkgs = xbps_dictionary_create();
+	assert(repo->pkgs);
+	pthread_mutex_init(&repo->lock, NULL);
 	repo->fd = -1;
 	repo->xhp = xhp;
 	repo->uri = url;
+	repo->is_remote = xbps_repository_is_remote(url);
 
-	if (xbps_repository_is_remote(url)) {
-		/* remote repository */
-		char *rpath;
-
-		if ((rpath = xbps_get_remote_repo_string(url)) == NULL) {
-			goto out;
-		}
-		repofile = xbps_xasprintf("%s/%s/%s-%s", xhp->metadir, rpath, arch, name);
-		free(rpath);
-		repo->is_remote = true;
-	} else {
-		/* local repository */
-		repofile = xbps_repo_path_with_name(xhp, url, name);
-	}
+	if ((repofile = xbps_repo_file(xhp, url, name)) == NULL)
+		goto out;
 	/*
 	 * In memory repo sync.
 	 */
@@ -350,17 +413,24 @@ xbps_repo_open(struct xbps_handle *xhp, const char *url)
 		stage = xbps_repo_stage_open(xhp, url);
 		if (stage == NULL)
 			return repo;
+		/*
+		 * The copy shares its entries with the index, release the
+		 * index first so that they don't need to be copied when
+		 * they're modified.
+		 */
 		idx = xbps_dictionary_copy_mutable(repo->idx);
+		xbps_object_release(repo->idx);
+		repo->idx = idx;
 		iter = xbps_dictionary_iterator(stage->idx);
 		while ((keysym = xbps_object_iterator_next(iter))) {
 			pkgname = xbps_dictionary_keysym_cstring_nocopy(keysym);
-			xbps_dictionary_set(idx, pkgname,
+			xbps_dictionary_append(idx, pkgname,
 					xbps_dictionary_get_keysym(stage->idx, keysym));
 		}
 		xbps_object_iterator_release(iter);
-		xbps_object_release(repo->idx);
+		xbps_dictionary_seal(idx);
+		xbps_dictionary_make_immutable(idx);
 		xbps_repo_release(stage);
-		repo->idx = idx;
 		return repo;
 	}
 	return repo;
@@ -398,80 +468,214 @@ xbps_repo_release(struct xbps_repo *repo)
 		xbps_object_release(repo->idxmeta);
 		repo->idxmeta = NULL;
 	}
+	if (repo->vpkgs != NULL) {
+		xbps_object_release(repo->vpkgs);
+		repo->vpkgs = NULL;
+	}
+	if (repo->revdeps != NULL) {
+		xbps_object_release(repo->revdeps);
+		repo->revdeps = NULL;
+	}
+	if (repo->pkgs != NULL) {
+		xbps_object_release(repo->pkgs);
+		repo->pkgs = NULL;
+	}
+	pthread_mutex_destroy(&repo->lock);
 	free(repo);
 }
 
-xbps_dictionary_t
-xbps_repo_get_virtualpkg(struct xbps_repo *repo, const char *pkg)
+/*
+ * Returns a dictionary mapping virtual package names to the array of
+ * packages providing them, in index order.
+ */
+static xbps_dictionary_t
+repo_build_vpkgs(struct xbps_repo *repo)
 {
-	xbps_dictionary_t pkgd;
-	const char *pkgver;
-	char pkgname[XBPS_NAME_SIZE] = {0};
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym;
+	xbps_dictionary_t vpkgs, pkgd;
+	xbps_array_t provides, providers;
+	const char *vpkg;
+	char vpkgname[XBPS_NAME_SIZE];
 
-	if (!repo || !repo->idx || !pkg) {
-		return NULL;
-	}
-	pkgd = xbps_find_virtualpkg_in_dict(repo->xhp, repo->idx, pkg);
-	if (!pkgd) {
-		return NULL;
-	}
-	if (xbps_dictionary_get(pkgd, "repository") && xbps_dictionary_get(pkgd, "pkgname")) {
-		return pkgd;
-	}
-	if (!xbps_dictionary_set_cstring_nocopy(pkgd, "repository", repo->uri)) {
+	if ((vpkgs = xbps_dictionary_create()) == NULL)
 		return NULL;
-	}
-	if (!xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &pkgver)) {
-		return NULL;
-	}
-	if (!xbps_pkg_name(pkgname, sizeof(pkgname), pkgver)) {
+	if ((iter = xbps_dictionary_iterator(repo->idx)) == NULL) {
+		xbps_object_release(vpkgs);
 		return NULL;
 	}
-	if (!xbps_dictionary_set_cstring(pkgd, "pkgname", pkgname)) {
-		return NULL;
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		pkgd = xbps_dictionary_get_keysym(repo->idx, keysym);
+		provides = xbps_dictionary_get(pkgd, "provides");
+		for (unsigned int i = 0; i < xbps_array_count(provides); i++) {
+			xbps_array_get_cstring_nocopy(provides, i, &vpkg);
+			if (!xbps_pkg_name(vpkgname, sizeof(vpkgname), vpkg) &&
+			    !xbps_pkgpattern_name(vpkgname, sizeof(vpkgname), vpkg))
+				continue;
+			providers = xbps_dictionary_get(vpkgs, vpkgname);
+			if (providers == NULL) {
+				providers = xbps_array_create();
+				if (providers == NULL)
+					continue;
+				xbps_dictionary_set(vpkgs, vpkgname, providers);
+				xbps_object_release(providers);
+			}
+			/* a package may provide several versions */
+			if (xbps_array_get(providers,
+			    xbps_array_count(providers) - 1) != pkgd)
+				xbps_array_add(providers, pkgd);
+		}
 	}
-	xbps_dbg_printf(repo->xhp, "%s: found %s\n", __func__, pkgver);
+	xbps_object_iterator_release(iter);
+	xbps_dictionary_make_immutable(vpkgs);
+	xbps_dbg_printf(repo->xhp, "[repo] `%s' indexed %u virtual packages\n",
+	    repo->uri, xbps_dictionary_count(vpkgs));
+	return vpkgs;
+}
 
-	return pkgd;
+/*
+ * Returns the virtual packages map of repo, it's built the first time
+ * a virtual package is looked up in the repository.
+ */
+static xbps_dictionary_t
+repo_get_vpkgs(struct xbps_repo *repo)
+{
+	xbps_dictionary_t vpkgs;
+
+	pthread_mutex_lock(&repo->lock);
+	if (repo->vpkgs == NULL)
+		repo->vpkgs = repo_build_vpkgs(repo);
+	vpkgs = repo->vpkgs;
+	pthread_mutex_unlock(&repo->lock);
+	return vpkgs;
 }
 
-xbps_dictionary_t
-xbps_repo_get_pkg(struct xbps_repo *repo, const char *pkg)
+static xbps_dictionary_t
+repo_find_virtualpkg(struct xbps_repo *repo, const char *pkg)
 {
-	xbps_dictionary_t pkgd = NULL;
-	const char *pkgver;
-	char pkgname[XBPS_NAME_SIZE] = {0};
+	xbps_dictionary_t vpkgs, pkgd;
+	xbps_array_t providers;
+	const char *vpkg;
+	char vpkgname[XBPS_NAME_SIZE];
 
-	if (!repo || !repo->idx || !pkg) {
-		return NULL;
-	}
-	/* Try matching vpkg from configuration files */
-	if ((pkgd = xbps_find_virtualpkg_in_conf(repo->xhp, repo->idx, pkg))) {
-		goto add;
+	/* Try matching vpkg via xhp->vpkgd */
+	if ((vpkg = vpkg_user_conf(repo->xhp, pkg, false)) != NULL &&
+	    (pkgd = xbps_find_pkg_in_dict(repo->idx, vpkg)) != NULL)
+		return pkgd;
+	/*
+	 * Globs may match any name, look at all packages.
+	 */
+	if (strpbrk(pkg, "*?[]") != NULL ||
+	    (vpkgs = repo_get_vpkgs(repo)) == NULL)
+		return xbps_find_virtualpkg_in_dict(repo->xhp, repo->idx, pkg);
+
+	if (!xbps_pkgpattern_name(vpkgname, sizeof(vpkgname), pkg) &&
+	    !xbps_pkg_name(vpkgname, sizeof(vpkgname), pkg)) {
+		if (xbps_strlcpy(vpkgname, pkg, sizeof(vpkgname)) >= sizeof(vpkgname))
+			return NULL;
 	}
-	/* ... otherwise match a real pkg */
-	if ((pkgd = xbps_find_pkg_in_dict(repo->idx, pkg))) {
-		goto add;
+	providers = xbps_dictionary_get(vpkgs, vpkgname);
+	for (unsigned int i = 0; i < xbps_array_count(providers); i++) {
+		pkgd = xbps_array_get(providers, i);
+		if (xbps_match_virtual_pkg_in_dict(pkgd, pkg))
+			return pkgd;
 	}
 	return NULL;
-add:
-	if (xbps_dictionary_get(pkgd, "repository") && xbps_dictionary_get(pkgd, "pkgname")) {
-		return pkgd;
-	}
-	if (!xbps_dictionary_set_cstring_nocopy(pkgd, "repository", repo->uri)) {
-		return NULL;
+}
+
+static bool
+repo_pkg_init(struct xbps_repo *repo, xbps_dictionary_t pkgd,
+		struct xbps_repo_pkg *rpkg)
+{
+	rpkg->repo = repo;
+	rpkg->pkgd = pkgd;
+	if (!xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &rpkg->pkgver))
+		return false;
+	return xbps_pkg_name(rpkg->pkgname, sizeof(rpkg->pkgname), rpkg->pkgver);
+}
+
+bool
+xbps_repo_lookup_virtualpkg(struct xbps_repo *repo, const char *pkg,
+		struct xbps_repo_pkg *rpkg)
+{
+	xbps_dictionary_t pkgd;
+
+	if (!repo || !repo->idx || !pkg)
+		return false;
+
+	if ((pkgd = repo_find_virtualpkg(repo, pkg)) == NULL)
+		return false;
+	return repo_pkg_init(repo, pkgd, rpkg);
+}
+
+bool
+xbps_repo_lookup_pkg(struct xbps_repo *repo, const char *pkg,
+		struct xbps_repo_pkg *rpkg)
+{
+	xbps_dictionary_t pkgd;
+
+	if (!repo || !repo->idx || !pkg)
+		return false;
+
+	/* Try matching vpkg from configuration files */
+	if ((pkgd = xbps_find_virtualpkg_in_conf(repo->xhp, repo->idx, pkg)) == NULL) {
+		/* ... otherwise match a real pkg */
+		if ((pkgd = xbps_find_pkg_in_dict(repo->idx, pkg)) == NULL)
+			return false;
 	}
-	if (!xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &pkgver)) {
-		return NULL;
+	return repo_pkg_init(repo, pkgd, rpkg);
+}
+
+/*
+ * The repository index is never modified, the package dictionaries
+ * handed out to callers are copies with the repository and pkgname
+ * objects, kept until the repository is released so that every
+ * lookup of a package returns the same object.
+ */
+xbps_dictionary_t
+xbps_repo_pkg_dictionary(struct xbps_repo_pkg *rpkg)
+{
+	struct xbps_repo *repo = rpkg->repo;
+	xbps_dictionary_t pkgd;
+
+	pthread_mutex_lock(&repo->lock);
+	if ((pkgd = xbps_dictionary_get(repo->pkgs, rpkg->pkgname)) != NULL)
+		goto out;
+
+	if ((pkgd = xbps_dictionary_copy_mutable(rpkg->pkgd)) == NULL)
+		goto out;
+	if (!xbps_dictionary_set_cstring_nocopy(pkgd, "repository", repo->uri) ||
+	    !xbps_dictionary_set_cstring(pkgd, "pkgname", rpkg->pkgname) ||
+	    !xbps_dictionary_set(repo->pkgs, rpkg->pkgname, pkgd)) {
+		xbps_object_release(pkgd);
+		pkgd = NULL;
+		goto out;
 	}
-	if (!xbps_pkg_name(pkgname, sizeof(pkgname), pkgver)) {
+	xbps_object_release(pkgd);
+	xbps_dbg_printf(repo->xhp, "%s: found %s\n", __func__, rpkg->pkgver);
+out:
+	pthread_mutex_unlock(&repo->lock);
+	return pkgd;
+}
+
+xbps_dictionary_t
+xbps_repo_get_virtualpkg(struct xbps_repo *repo, const char *pkg)
+{
+	struct xbps_repo_pkg rpkg;
+
+	if (!xbps_repo_lookup_virtualpkg(repo, pkg, &rpkg))
 		return NULL;
-	}
-	if (!xbps_dictionary_set_cstring(pkgd, "pkgname", pkgname)) {
+	return xbps_repo_pkg_dictionary(&rpkg);
+}
+
+xbps_dictionary_t
+xbps_repo_get_pkg(struct xbps_repo *repo, const char *pkg)
+{
+	struct xbps_repo_pkg rpkg;
+
+	if (!xbps_repo_lookup_pkg(repo, pkg, &rpkg))
 		return NULL;
-	}
-	xbps_dbg_printf(repo->xhp, "%s: found %s\n", __func__, pkgver);
-	return pkgd;
+	return xbps_repo_pkg_dictionary(&rpkg);
 }
 
 xbps_dictionary_t
@@ -490,20 +694,195 @@ xbps_repo_get_pkg_plist(struct xbps_handle *xhp, xbps_dictionary_t pkgd,
 	return bpkgd;
 }
 
+/*
+ * Returns a dictionary mapping package names to the array of keysyms
+ * of the packages whose "run_depends" refer to them, in index order.
+ * Dependencies using glob patterns can match any name and are stored
+ * under the "*" key, which can't be a valid package name.
+ */
+static xbps_dictionary_t
+repo_build_revdeps(struct xbps_repo *repo)
+{
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym;
+	xbps_dictionary_t revdeps, pkgd;
+	xbps_array_t pkgdeps, rdeps;
+	const char *pkgdep;
+	char pkgname[XBPS_NAME_SIZE];
+
+	if ((revdeps = xbps_dictionary_create()) == NULL)
+		return NULL;
+	if ((iter = xbps_dictionary_iterator(repo->idx)) == NULL) {
+		xbps_object_release(revdeps);
+		return NULL;
+	}
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		pkgd = xbps_dictionary_get_keysym(repo->idx, keysym);
+		pkgdeps = xbps_dictionary_get(pkgd, "run_depends");
+		for (unsigned int i = 0; i < xbps_array_count(pkgdeps); i++) {
+			xbps_array_get_cstring_nocopy(pkgdeps, i, &pkgdep);
+			if (strpbrk(pkgdep, "*?[]") != NULL) {
+				xbps_strlcpy(pkgname, "*", sizeof(pkgname));
+			} else if (!xbps_pkgpattern_name(pkgname, sizeof(pkgname), pkgdep) &&
+			    !xbps_pkg_name(pkgname, sizeof(pkgname), pkgdep)) {
+				continue;
+			}
+			rdeps = xbps_dictionary_get(revdeps, pkgname);
+			if (rdeps == NULL) {
+				rdeps = xbps_array_create();
+				if (rdeps == NULL)
+					continue;
+				xbps_dictionary_set(revdeps, pkgname, rdeps);
+				xbps_object_release(rdeps);
+			}
+			/* a package may depend on the same name twice */
+			if (xbps_array_get(rdeps,
+			    xbps_array_count(rdeps) - 1) != keysym)
+				xbps_array_add(rdeps, keysym);
+		}
+	}
+	xbps_object_iterator_release(iter);
+	xbps_dictionary_make_immutable(revdeps);
+	xbps_dbg_printf(repo->xhp, "[repo] `%s' indexed reverse dependencies "
+	    "of %u packages\n", repo->uri, xbps_dictionary_count(revdeps));
+	return revdeps;
+}
+
+/*
+ * Returns the reverse dependencies map of repo, it's built the first
+ * time reverse dependencies are looked up.
+ */
+static xbps_dictionary_t
+repo_get_revdeps(struct xbps_repo *repo)
+{
+	xbps_dictionary_t revdeps;
+
+	pthread_mutex_lock(&repo->lock);
+	if (repo->revdeps == NULL)
+		repo->revdeps = repo_build_revdeps(repo);
+	revdeps = repo->revdeps;
+	pthread_mutex_unlock(&repo->lock);
+	return revdeps;
+}
+
+static int
+keysym_cmp(const void *a, const void *b)
+{
+	xbps_dictionary_keysym_t ka = *(xbps_dictionary_keysym_t const *)a;
+	xbps_dictionary_keysym_t kb = *(xbps_dictionary_keysym_t const *)b;
+
+	return strcmp(xbps_dictionary_keysym_cstring_nocopy(ka),
+	    xbps_dictionary_keysym_cstring_nocopy(kb));
+}
+
+static bool
+revdeps_add_candidates(xbps_dictionary_t revdeps, const char *pkgver,
+		xbps_dictionary_keysym_t **cands, unsigned int *ncands)
+{
+	xbps_dictionary_keysym_t *tmp;
+	xbps_array_t rdeps;
+	unsigned int cnt;
+	char pkgname[XBPS_NAME_SIZE];
+
+	if (pkgver == NULL) {
+		xbps_strlcpy(pkgname, "*", sizeof(pkgname));
+	} else if (!xbps_pkg_name(pkgname, sizeof(pkgname), pkgver)) {
+		return false;
+	}
+	rdeps = xbps_dictionary_get(revdeps, pkgname);
+	if ((cnt = xbps_array_count(rdeps)) == 0)
+		return true;
+
+	tmp = realloc(*cands, (*ncands + cnt) * sizeof(*tmp));
+	if (tmp == NULL)
+		return false;
+	for (unsigned int i = 0; i < cnt; i++)
+		tmp[*ncands + i] = xbps_array_get(rdeps, i);
+	*cands = tmp;
+	*ncands += cnt;
+	return true;
+}
+
+/*
+ * Returns the keysyms of the packages that may depend on tpkgd (or str
+ * if set) sorted as in the repository index, or all packages in the
+ * index if the reverse dependencies index is not available.
+ */
+static xbps_dictionary_keysym_t *
+revdeps_candidates(struct xbps_repo *repo, xbps_dictionary_t tpkgd,
+		const char *str, unsigned int *ncands)
+{
+	xbps_dictionary_t revdeps;
+	xbps_dictionary_keysym_t *cands = NULL;
+	xbps_object_iterator_t iter;
+	xbps_object_t obj;
+	xbps_array_t provides;
+	const char *pkgver = NULL, *vpkg = NULL;
+	unsigned int n = 0, i, j;
+	bool ok;
+
+	*ncands = 0;
+	if ((revdeps = repo_get_revdeps(repo)) == NULL)
+		goto all;
+
+	ok = revdeps_add_candidates(revdeps, NULL, &cands, &n);
+	if (str) {
+		ok = ok && revdeps_add_candidates(revdeps, str, &cands, &n);
+	} else {
+		provides = xbps_dictionary_get(tpkgd, "provides");
+		for (i = 0; ok && i < xbps_array_count(provides); i++) {
+			xbps_array_get_cstring_nocopy(provides, i, &vpkg);
+			ok = revdeps_add_candidates(revdeps, vpkg, &cands, &n);
+		}
+		xbps_dictionary_get_cstring_nocopy(tpkgd, "pkgver", &pkgver);
+		ok = ok && pkgver != NULL &&
+		    revdeps_add_candidates(revdeps, pkgver, &cands, &n);
+	}
+	if (!ok) {
+		free(cands);
+		cands = NULL;
+		n = 0;
+		goto all;
+	}
+	if (n > 1) {
+		qsort(cands, n, sizeof(*cands), keysym_cmp);
+		for (i = 1, j = 1; i < n; i++) {
+			if (keysym_cmp(&cands[i], &cands[j-1]) != 0)
+				cands[j++] = cands[i];
+		}
+		n = j;
+	}
+	*ncands = n;
+	return cands;
+all:
+	if ((iter = xbps_dictionary_iterator(repo->idx)) == NULL)
+		return NULL;
+	if ((cands = calloc(xbps_dictionary_count(repo->idx) + 1,
+	    sizeof(*cands))) == NULL) {
+		xbps_object_iterator_release(iter);
+		return NULL;
+	}
+	while ((obj = xbps_object_iterator_next(iter)))
+		cands[n++] = obj;
+	xbps_object_iterator_release(iter);
+	*ncands = n;
+	return cands;
+}
+
 static xbps_array_t
 revdeps_match(struct xbps_repo *repo, xbps_dictionary_t tpkgd, const char *str)
 {
 	xbps_dictionary_t pkgd;
+	xbps_dictionary_keysym_t *cands;
 	xbps_array_t revdeps = NULL, pkgdeps, provides;
-	xbps_object_iterator_t iter;
-	xbps_object_t obj;
 	const char *pkgver = NULL, *tpkgver = NULL, *arch = NULL, *vpkg = NULL;
+	unsigned int ncands = 0;
 
-	iter = xbps_dictionary_iterator(repo->idx);
-	assert(iter);
+	cands = revdeps_candidates(repo, tpkgd, str, &ncands);
+	assert(cands || ncands == 0);
 
-	while ((obj = xbps_object_iterator_next(iter))) {
-		pkgd = xbps_dictionary_get_keysym(repo->idx, obj);
+	for (unsigned int c = 0; c < ncands; c++) {
+		pkgd = xbps_dictionary_get_keysym(repo->idx, cands[c]);
 		if (xbps_dictionary_equals(pkgd, tpkgd))
 			continue;
 
@@ -575,13 +954,14 @@ revdeps_match(struct xbps_repo *repo, xbps_dictionary_t tpkgd, const char *str)
 		if (!xbps_match_string_in_array(revdeps, tpkgver))
 			xbps_array_add_cstring_nocopy(revdeps, tpkgver);
 	}
-	xbps_object_iterator_release(iter);
+	free(cands);
 	return revdeps;
 }
 
 xbps_array_t
 xbps_repo_get_pkg_revdeps(struct xbps_repo *repo, const char *pkg)
 {
+	struct xbps_repo_pkg rpkg;
 	xbps_array_t revdeps = NULL, vdeps = NULL;
 	xbps_dictionary_t pkgd;
 	const char *vpkg;
@@ -590,11 +970,12 @@ xbps_repo_get_pkg_revdeps(struct xbps_repo *repo, const char *pkg)
 	if (repo->idx == NULL)
 		return NULL;
 
-	if (((pkgd = xbps_repo_get_pkg(repo, pkg)) == NULL) &&
-	    ((pkgd = xbps_repo_get_virtualpkg(repo, pkg)) == NULL)) {
+	if (!xbps_repo_lookup_pkg(repo, pkg, &rpkg) &&
+	    !xbps_repo_lookup_virtualpkg(repo, pkg, &rpkg)) {
 		errno = ENOENT;
 		return NULL;
 	}
+	pkgd = rpkg.pkgd;
 	/*
 	 * If pkg is a virtual pkg let's match it instead of the real pkgver.
 	 */
@@ -621,6 +1002,18 @@ xbps_repo_get_pkg_revdeps(struct xbps_repo *repo, const char *pkg)
 	return revdeps;
 }
 
+xbps_array_t
+xbps_repo_get_shlib_providers(struct xbps_repo *repo, const char *shlib)
+{
+	xbps_dictionary_t shlibs;
+
+	assert(repo);
+	assert(shlib);
+
+	shlibs = xbps_dictionary_get(repo->idxmeta, "shlib-providers");
+	return xbps_dictionary_get(shlibs, shlib);
+}
+
 int
 xbps_repo_key_import(struct xbps_repo *repo)
 {
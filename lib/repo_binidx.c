@@ -0,0 +1,837 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "xbps_api_impl.h"
+#include "uthash.h"
+
+/*
+ * Binary repository index.
+ *
+ * The binary index is a companion file (<repofile>.idx) of a repository
+ * archive that contains the same objects than its index and index-meta
+ * plists, but in a format that can be mapped into memory and decoded
+ * without decompressing the archive and without parsing XML.
+ *
+ * Layout (native byte order, validated with the byteorder marker):
+ *
+ *	struct binidx_hdr	header
+ *	char[]			string table (deduplicated NUL terminated
+ *				strings and raw data blobs), padded to 8 bytes
+ *	struct binidx_rec[]	package records, sorted by pkgname
+ *	uint32_t[]		encoded objects
+ *
+ * Package records hold the pkgname and pkgver strings of each package,
+ * which is enough to find out if there are updates for the installed
+ * packages without decoding any object.
+ *
+ * Every encoded object starts with a tag word (type in the low 4 bits,
+ * an argument in the upper bits) followed by its payload:
+ *
+ *	STRING	tag, string offset
+ *	BOOL	tag (argument is the value)
+ *	NUMBER	tag (argument set if unsigned), low word, high word
+ *	DATA	tag (argument is the length), blob offset
+ *	ARRAY	tag (argument is the count), objects
+ *	DICT	tag (argument is the count), [key string offset, object]...
+ *
+ * The header stores the size, modification time and SHA256 digest of
+ * the repository archive it was generated from; if those do not match
+ * the binary index is stale and it is ignored. The archive is only
+ * hashed if its inode number or status change time differ from the
+ * ones in the header too: any write, rename or utimes(2) call on the
+ * archive updates the latter, so while they match the archive is the
+ * one the binary index was generated from. Copies of a repository, or
+ * archives touched after the binary index was written, are hashed on
+ * every open.
+ *
+ * The index dictionary of a repository opened from its binary index
+ * keeps the file mapped: only the keys are set up when it's opened,
+ * each package dictionary is decoded the first time it's looked up.
+ *
+ * Repository archives synchronized into the metadir get their binary
+ * index generated by xbps_repo_sync(), or the first time they are
+ * opened if it's missing or stale.
+ */
+#define BINIDX_MAGIC		"XBPSIDX"
+#define BINIDX_VERSION		5
+#define BINIDX_BYTEORDER	0x01020304U
+#define BINIDX_NOMETA		UINT32_MAX
+#define BINIDX_MAXDEPTH		32
+#define BINIDX_MAXARG		0x0fffffffU
+
+#define BINIDX_REC_REVERTS	0x1
+
+#define BINIDX_T_STRING		1
+#define BINIDX_T_BOOL		2
+#define BINIDX_T_NUMBER		3
+#define BINIDX_T_DATA		4
+#define BINIDX_T_ARRAY		5
+#define BINIDX_T_DICT		6
+
+#define BINIDX_TAG(t, a)	((uint32_t)(t) | ((uint32_t)(a) << 4))
+#define BINIDX_TAG_TYPE(w)	((w) & 0xf)
+#define BINIDX_TAG_ARG(w)	((w) >> 4)
+
+struct binidx_hdr {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteorder;
+	uint64_t repo_size;
+	int64_t repo_mtime;
+	int64_t repo_mtime_nsec;
+	uint64_t repo_ino;
+	int64_t repo_ctime;
+	int64_t repo_ctime_nsec;
+	unsigned char repo_sha256[XBPS_SHA256_DIGEST_SIZE];
+	uint32_t npkgs;
+	uint32_t meta;
+	uint64_t strtab_off;
+	uint64_t strtab_len;
+	uint64_t recs_off;
+	uint64_t words_off;
+	uint64_t nwords;
+};
+
+struct binidx_rec {
+	uint32_t name;
+	uint32_t pkgver;
+	uint32_t flags;
+	uint32_t value;
+	uint32_t nwords;
+};
+
+/*
+ * Writer.
+ */
+struct binidx_str {
+	char *str;
+	uint32_t off;
+	UT_hash_handle hh;
+};
+
+struct binidx_writer {
+	struct binidx_str *strs;
+	char *strtab;
+	size_t strtab_len;
+	size_t strtab_cap;
+	uint32_t *words;
+	size_t nwords;
+	size_t words_cap;
+};
+
+static int
+strtab_append(struct binidx_writer *w, const void *buf, size_t len, uint32_t *off)
+{
+	char *p;
+	size_t cap;
+
+	if (w->strtab_len + len >= UINT32_MAX)
+		return EFBIG;
+	if (w->strtab_len + len > w->strtab_cap) {
+		cap = w->strtab_cap ? w->strtab_cap : 4096;
+		while (cap < w->strtab_len + len)
+			cap *= 2;
+		if ((p = realloc(w->strtab, cap)) == NULL)
+			return ENOMEM;
+		w->strtab = p;
+		w->strtab_cap = cap;
+	}
+	memcpy(w->strtab + w->strtab_len, buf, len);
+	*off = (uint32_t)w->strtab_len;
+	w->strtab_len += len;
+	return 0;
+}
+
+static int
+strtab_add(struct binidx_writer *w, const char *str, uint32_t *off)
+{
+	struct binidx_str *s = NULL;
+	int rv;
+
+	HASH_FIND_STR(w->strs, str, s);
+	if (s != NULL) {
+		*off = s->off;
+		return 0;
+	}
+	if ((rv = strtab_append(w, str, strlen(str) + 1, off)) != 0)
+		return rv;
+	if ((s = malloc(sizeof(*s))) == NULL)
+		return ENOMEM;
+	s->str = __UNCONST(str);
+	s->off = *off;
+	HASH_ADD_KEYPTR(hh, w->strs, s->str, strlen(s->str), s);
+	return 0;
+}
+
+static int
+words_add(struct binidx_writer *w, uint32_t word)
+{
+	uint32_t *p;
+	size_t cap;
+
+	if (w->nwords >= UINT32_MAX - 1)
+		return EFBIG;
+	if (w->nwords == w->words_cap) {
+		cap = w->words_cap ? w->words_cap * 2 : 4096;
+		if ((p = realloc(w->words, cap * sizeof(*p))) == NULL)
+			return ENOMEM;
+		w->words = p;
+		w->words_cap = cap;
+	}
+	w->words[w->nwords++] = word;
+	return 0;
+}
+
+static int
+encode_object(struct binidx_writer *w, xbps_object_t obj)
+{
+	xbps_object_iterator_t iter;
+	xbps_object_t o;
+	const char *str;
+	uint64_t val;
+	uint32_t off;
+	unsigned int cnt;
+	int rv = 0;
+
+	switch (xbps_object_type(obj)) {
+	case XBPS_TYPE_STRING:
+		str = xbps_string_cstring_nocopy(obj);
+		if ((rv = strtab_add(w, str ? str : "", &off)) != 0)
+			return rv;
+		if ((rv = words_add(w, BINIDX_TAG(BINIDX_T_STRING, 0))) != 0)
+			return rv;
+		return words_add(w, off);
+	case XBPS_TYPE_BOOL:
+		return words_add(w, BINIDX_TAG(BINIDX_T_BOOL, xbps_bool_true(obj)));
+	case XBPS_TYPE_NUMBER:
+		if (xbps_number_unsigned(obj))
+			val = xbps_number_unsigned_integer_value(obj);
+		else
+			val = (uint64_t)xbps_number_integer_value(obj);
+		if ((rv = words_add(w, BINIDX_TAG(BINIDX_T_NUMBER,
+		    xbps_number_unsigned(obj)))) != 0)
+			return rv;
+		if ((rv = words_add(w, (uint32_t)(val & 0xffffffffU))) != 0)
+			return rv;
+		return words_add(w, (uint32_t)(val >> 32));
+	case XBPS_TYPE_DATA:
+		if (xbps_data_size(obj) > BINIDX_MAXARG)
+			return EFBIG;
+		if ((rv = strtab_append(w, xbps_data_data_nocopy(obj),
+		    xbps_data_size(obj), &off)) != 0)
+			return rv;
+		if ((rv = words_add(w, BINIDX_TAG(BINIDX_T_DATA,
+		    xbps_data_size(obj)))) != 0)
+			return rv;
+		return words_add(w, off);
+	case XBPS_TYPE_ARRAY:
+		cnt = xbps_array_count(obj);
+		if (cnt > BINIDX_MAXARG)
+			return EFBIG;
+		if ((rv = words_add(w, BINIDX_TAG(BINIDX_T_ARRAY, cnt))) != 0)
+			return rv;
+		for (unsigned int i = 0; i < cnt; i++) {
+			if ((rv = encode_object(w, xbps_array_get(obj, i))) != 0)
+				return rv;
+		}
+		return 0;
+	case XBPS_TYPE_DICTIONARY:
+		cnt = xbps_dictionary_count(obj);
+		if (cnt > BINIDX_MAXARG)
+			return EFBIG;
+		if ((rv = words_add(w, BINIDX_TAG(BINIDX_T_DICT, cnt))) != 0)
+			return rv;
+		iter = xbps_dictionary_iterator(obj);
+		if (iter == NULL)
+			return ENOMEM;
+		while ((o = xbps_object_iterator_next(iter))) {
+			str = xbps_dictionary_keysym_cstring_nocopy(o);
+			if ((rv = strtab_add(w, str, &off)) != 0)
+				break;
+			if ((rv = words_add(w, off)) != 0)
+				break;
+			if ((rv = encode_object(w,
+			    xbps_dictionary_get_keysym(obj, o))) != 0)
+				break;
+		}
+		xbps_object_iterator_release(iter);
+		return rv;
+	default:
+		return EINVAL;
+	}
+}
+
+static int
+write_buf(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, p, len);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		p += n;
+		len -= (size_t)n;
+	}
+	return 0;
+}
+
+static int
+binidx_encode(struct binidx_writer *w, struct binidx_hdr *hdr,
+		struct binidx_rec **recsp, xbps_dictionary_t idx,
+		xbps_dictionary_t meta)
+{
+	struct binidx_rec *recs;
+	xbps_array_t allkeys;
+	xbps_dictionary_t pkgd;
+	xbps_object_t keysym;
+	const char *pkgver;
+	unsigned int npkgs;
+	int rv;
+
+	/*
+	 * Keys are returned in dictionary order, i.e sorted by pkgname,
+	 * that is what makes the records table binary searchable.
+	 */
+	allkeys = xbps_dictionary_all_keys(idx);
+	npkgs = xbps_array_count(allkeys);
+	recs = calloc(npkgs ? npkgs : 1, sizeof(*recs));
+	if (recs == NULL) {
+		xbps_object_release(allkeys);
+		return ENOMEM;
+	}
+	*recsp = recs;
+	for (unsigned int i = 0; i < npkgs; i++) {
+		keysym = xbps_array_get(allkeys, i);
+		pkgd = xbps_dictionary_get_keysym(idx, keysym);
+		pkgver = NULL;
+		xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &pkgver);
+
+		if ((rv = strtab_add(w,
+		    xbps_dictionary_keysym_cstring_nocopy(keysym),
+		    &recs[i].name)) != 0)
+			goto out;
+		if ((rv = strtab_add(w, pkgver ? pkgver : "",
+		    &recs[i].pkgver)) != 0)
+			goto out;
+		if (xbps_array_count(xbps_dictionary_get(pkgd, "reverts")))
+			recs[i].flags |= BINIDX_REC_REVERTS;
+		recs[i].value = (uint32_t)w->nwords;
+		if ((rv = encode_object(w, pkgd)) != 0)
+			goto out;
+		recs[i].nwords = (uint32_t)(w->nwords - recs[i].value);
+	}
+	hdr->npkgs = npkgs;
+	hdr->meta = BINIDX_NOMETA;
+	if (xbps_object_type(meta) == XBPS_TYPE_DICTIONARY) {
+		hdr->meta = (uint32_t)w->nwords;
+		if ((rv = encode_object(w, meta)) != 0)
+			goto out;
+	}
+	rv = 0;
+out:
+	xbps_object_release(allkeys);
+	return rv;
+}
+
+int
+xbps_repo_binidx_write(struct xbps_handle *xhp, const char *repofile,
+		xbps_dictionary_t idx, xbps_dictionary_t meta)
+{
+	struct binidx_writer w;
+	struct binidx_hdr hdr;
+	struct binidx_rec *recs = NULL;
+	struct binidx_str *s, *stmp;
+	struct stat st;
+	static const char pad[8];
+	char *idxfile = NULL, *tname = NULL;
+	size_t padlen;
+	int fd = -1, rv;
+
+	assert(xhp);
+	assert(repofile);
+
+	if (stat(repofile, &st) == -1)
+		return errno;
+
+	memset(&w, 0, sizeof(w));
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BINIDX_MAGIC, sizeof(BINIDX_MAGIC));
+	hdr.version = BINIDX_VERSION;
+	hdr.byteorder = BINIDX_BYTEORDER;
+	hdr.repo_size = (uint64_t)st.st_size;
+	hdr.repo_mtime = (int64_t)st.st_mtim.tv_sec;
+	hdr.repo_mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+	hdr.repo_ino = (uint64_t)st.st_ino;
+	hdr.repo_ctime = (int64_t)st.st_ctim.tv_sec;
+	hdr.repo_ctime_nsec = (int64_t)st.st_ctim.tv_nsec;
+	if (!xbps_file_sha256_raw(hdr.repo_sha256,
+	    sizeof(hdr.repo_sha256), repofile))
+		return errno;
+	/*
+	 * Create the tempfile before encoding, so that the work is
+	 * not wasted if the directory is not writable. mkstemp(3)
+	 * creates it with 0600, don't touch the umask because
+	 * repositories may be opened concurrently.
+	 */
+	idxfile = xbps_xasprintf("%s.idx", repofile);
+	tname = xbps_xasprintf("%s.XXXXXXXXXX", idxfile);
+	if ((fd = mkstemp(tname)) == -1) {
+		rv = errno;
+		goto out;
+	}
+	if ((rv = binidx_encode(&w, &hdr, &recs, idx, meta)) != 0) {
+		unlink(tname);
+		goto out;
+	}
+	padlen = (8 - (w.strtab_len % 8)) % 8;
+	hdr.strtab_off = sizeof(hdr);
+	hdr.strtab_len = w.strtab_len;
+	hdr.recs_off = hdr.strtab_off + w.strtab_len + padlen;
+	hdr.words_off = hdr.recs_off + hdr.npkgs * sizeof(*recs);
+	hdr.nwords = w.nwords;
+
+	if ((rv = write_buf(fd, &hdr, sizeof(hdr))) != 0 ||
+	    (rv = write_buf(fd, w.strtab, w.strtab_len)) != 0 ||
+	    (rv = write_buf(fd, pad, padlen)) != 0 ||
+	    (rv = write_buf(fd, recs, hdr.npkgs * sizeof(*recs))) != 0 ||
+	    (rv = write_buf(fd, w.words, w.nwords * sizeof(*w.words))) != 0) {
+		unlink(tname);
+		goto out;
+	}
+#ifdef HAVE_FDATASYNC
+	fdatasync(fd);
+#else
+	fsync(fd);
+#endif
+	if (fchmod(fd, st.st_mode & 0666) == -1 ||
+	    rename(tname, idxfile) == -1) {
+		rv = errno;
+		unlink(tname);
+		goto out;
+	}
+	xbps_dbg_printf(xhp, "[repo] `%s' binary index written "
+	    "(%u packages)\n", idxfile, hdr.npkgs);
+out:
+	if (fd != -1)
+		close(fd);
+	HASH_ITER(hh, w.strs, s, stmp) {
+		HASH_DEL(w.strs, s);
+		free(s);
+	}
+	free(w.strtab);
+	free(w.words);
+	free(recs);
+	free(idxfile);
+	free(tname);
+	return rv;
+}
+
+/*
+ * Reader.
+ */
+struct binidx_map {
+	const char *strtab;
+	size_t strtab_len;
+	const uint32_t *words;
+	size_t nwords;
+};
+
+static const char *
+map_string(const struct binidx_map *m, uint32_t off)
+{
+	if (off >= m->strtab_len)
+		return NULL;
+	return m->strtab + off;
+}
+
+static xbps_object_t
+decode_object(const struct binidx_map *m, size_t *pos, unsigned int depth)
+{
+	xbps_object_t obj, o;
+	const char *str;
+	uint64_t val;
+	uint32_t tag, arg, off;
+
+	if (depth > BINIDX_MAXDEPTH || *pos >= m->nwords)
+		return NULL;
+
+	tag = m->words[(*pos)++];
+	arg = BINIDX_TAG_ARG(tag);
+
+	switch (BINIDX_TAG_TYPE(tag)) {
+	case BINIDX_T_STRING:
+		if (*pos >= m->nwords)
+			return NULL;
+		if ((str = map_string(m, m->words[(*pos)++])) == NULL)
+			return NULL;
+		return xbps_string_create_cstring(str);
+	case BINIDX_T_BOOL:
+		return xbps_bool_create(arg != 0);
+	case BINIDX_T_NUMBER:
+		if (*pos + 2 > m->nwords)
+			return NULL;
+		val = (uint64_t)m->words[*pos] |
+		    ((uint64_t)m->words[*pos + 1] << 32);
+		*pos += 2;
+		if (arg)
+			return xbps_number_create_unsigned_integer(val);
+		return xbps_number_create_integer((int64_t)val);
+	case BINIDX_T_DATA:
+		if (*pos >= m->nwords)
+			return NULL;
+		off = m->words[(*pos)++];
+		if (off > m->strtab_len || arg > m->strtab_len - off)
+			return NULL;
+		return xbps_data_create_data(m->strtab + off, arg);
+	case BINIDX_T_ARRAY:
+		if (arg > m->nwords - *pos)
+			return NULL;
+		if ((obj = xbps_array_create_with_capacity(arg)) == NULL)
+			return NULL;
+		for (uint32_t i = 0; i < arg; i++) {
+			if ((o = decode_object(m, pos, depth + 1)) == NULL) {
+				xbps_object_release(obj);
+				return NULL;
+			}
+			if (!xbps_array_add(obj, o)) {
+				xbps_object_release(o);
+				xbps_object_release(obj);
+				return NULL;
+			}
+			xbps_object_release(o);
+		}
+		return obj;
+	case BINIDX_T_DICT:
+		if (arg > m->nwords - *pos)
+			return NULL;
+		if ((obj = xbps_dictionary_create_with_capacity(arg)) == NULL)
+			return NULL;
+		for (uint32_t i = 0; i < arg; i++) {
+			if (*pos >= m->nwords ||
+			    (str = map_string(m, m->words[(*pos)++])) == NULL ||
+			    (o = decode_object(m, pos, depth + 1)) == NULL) {
+				xbps_object_release(obj);
+				return NULL;
+			}
+			if (!xbps_dictionary_set(obj, str, o)) {
+				xbps_object_release(o);
+				xbps_object_release(obj);
+				return NULL;
+			}
+			xbps_object_release(o);
+		}
+		return obj;
+	default:
+		return NULL;
+	}
+}
+
+struct xbps_repo_binidx {
+	void *addr;
+	size_t len;
+	const struct binidx_hdr *hdr;
+	const struct binidx_rec *recs;
+	struct binidx_map m;
+};
+
+static bool
+binidx_validate(struct xbps_handle *xhp, const char *repofile,
+		const char *idxfile, struct xbps_repo_binidx *bi,
+		const struct stat *st)
+{
+	const struct binidx_hdr *hdr = bi->addr;
+	size_t len = bi->len;
+	unsigned char digest[XBPS_SHA256_DIGEST_SIZE];
+
+	if (len < sizeof(*hdr) ||
+	    memcmp(hdr->magic, BINIDX_MAGIC, sizeof(BINIDX_MAGIC)) != 0 ||
+	    hdr->version != BINIDX_VERSION ||
+	    hdr->byteorder != BINIDX_BYTEORDER) {
+		xbps_dbg_printf(xhp, "[repo] `%s' unsupported "
+		    "binary index\n", idxfile);
+		return false;
+	}
+	if (hdr->repo_size != (uint64_t)st->st_size ||
+	    hdr->repo_mtime != (int64_t)st->st_mtim.tv_sec ||
+	    hdr->repo_mtime_nsec != (int64_t)st->st_mtim.tv_nsec) {
+		xbps_dbg_printf(xhp, "[repo] `%s' stale binary index, "
+		    "ignoring.\n", idxfile);
+		return false;
+	}
+	if ((hdr->repo_ino != (uint64_t)st->st_ino ||
+	    hdr->repo_ctime != (int64_t)st->st_ctim.tv_sec ||
+	    hdr->repo_ctime_nsec != (int64_t)st->st_ctim.tv_nsec) &&
+	    (!xbps_file_sha256_raw(digest, sizeof(digest), repofile) ||
+	    memcmp(hdr->repo_sha256, digest, sizeof(digest)) != 0)) {
+		xbps_dbg_printf(xhp, "[repo] `%s' binary index digest "
+		    "mismatch, ignoring.\n", idxfile);
+		return false;
+	}
+	if (hdr->strtab_off != sizeof(*hdr) ||
+	    hdr->strtab_len > len - hdr->strtab_off ||
+	    (hdr->strtab_len && ((const char *)bi->addr)[hdr->strtab_off +
+	    hdr->strtab_len - 1] != '\0') ||
+	    hdr->recs_off < hdr->strtab_off + hdr->strtab_len ||
+	    hdr->recs_off % sizeof(uint32_t) || hdr->recs_off > len ||
+	    hdr->npkgs > (len - hdr->recs_off) / sizeof(*bi->recs) ||
+	    hdr->words_off != hdr->recs_off + hdr->npkgs * sizeof(*bi->recs) ||
+	    hdr->nwords > (len - hdr->words_off) / sizeof(uint32_t)) {
+		xbps_dbg_printf(xhp, "[repo] `%s' corrupt "
+		    "binary index\n", idxfile);
+		return false;
+	}
+	bi->hdr = hdr;
+	bi->m.strtab = (const char *)bi->addr + hdr->strtab_off;
+	bi->m.strtab_len = hdr->strtab_len;
+	bi->m.words = (const uint32_t *)(const void *)
+	    ((const char *)bi->addr + hdr->words_off);
+	bi->m.nwords = hdr->nwords;
+	bi->recs = (const void *)((const char *)bi->addr + hdr->recs_off);
+	return true;
+}
+
+/*
+ * Maps the binary index of repofile into bi, if it's up-to-date.
+ */
+static bool
+binidx_map(struct xbps_handle *xhp, const char *repofile,
+		const struct stat *st, struct xbps_repo_binidx *bi)
+{
+	struct stat ist;
+	char *idxfile;
+	void *addr;
+	int fd;
+
+	idxfile = xbps_xasprintf("%s.idx", repofile);
+	if ((fd = open(idxfile, O_RDONLY|O_CLOEXEC)) == -1) {
+		if (errno != ENOENT)
+			xbps_dbg_printf(xhp, "[repo] `%s' open binary "
+			    "index %s\n", idxfile, strerror(errno));
+		free(idxfile);
+		return false;
+	}
+	if (fstat(fd, &ist) == -1 || ist.st_size <= 0) {
+		close(fd);
+		free(idxfile);
+		return false;
+	}
+	addr = mmap(NULL, (size_t)ist.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		xbps_dbg_printf(xhp, "[repo] `%s' mmap binary "
+		    "index %s\n", idxfile, strerror(errno));
+		free(idxfile);
+		return false;
+	}
+	memset(bi, 0, sizeof(*bi));
+	bi->addr = addr;
+	bi->len = (size_t)ist.st_size;
+	if (!binidx_validate(xhp, repofile, idxfile, bi, st)) {
+		munmap(addr, bi->len);
+		free(idxfile);
+		return false;
+	}
+	free(idxfile);
+	return true;
+}
+
+/*
+ * Decodes the package dictionary of a record, called by proplib the
+ * first time it's looked up in the index dictionary.
+ */
+static xbps_object_t
+binidx_decode_pkg(void *arg, const void *recp)
+{
+	const struct xbps_repo_binidx *bi = arg;
+	const struct binidx_rec *rec = recp;
+	xbps_object_t pkgd;
+	size_t pos = rec->value;
+
+	if ((pkgd = decode_object(&bi->m, &pos, 0)) == NULL)
+		return NULL;
+	if (xbps_object_type(pkgd) != XBPS_TYPE_DICTIONARY ||
+	    pos - rec->value != rec->nwords) {
+		xbps_object_release(pkgd);
+		return NULL;
+	}
+	return pkgd;
+}
+
+static void
+binidx_unmap_cb(void *arg)
+{
+	xbps_repo_binidx_unmap(arg);
+}
+
+static bool
+binidx_decode(struct xbps_repo *repo, struct xbps_repo_binidx *bi)
+{
+	const struct binidx_rec *recs = bi->recs;
+	xbps_dictionary_t idx, meta = NULL;
+	const char *name;
+	size_t pos;
+
+	if (bi->hdr->meta != BINIDX_NOMETA) {
+		pos = bi->hdr->meta;
+		meta = decode_object(&bi->m, &pos, 0);
+		if (xbps_object_type(meta) != XBPS_TYPE_DICTIONARY) {
+			if (meta != NULL)
+				xbps_object_release(meta);
+			xbps_repo_binidx_unmap(bi);
+			return false;
+		}
+	}
+	/* from now on the index owns the mapping */
+	idx = xbps_dictionary_create_lazy(bi->hdr->npkgs, binidx_decode_pkg,
+	    binidx_unmap_cb, bi);
+	if (idx == NULL) {
+		if (meta != NULL)
+			xbps_object_release(meta);
+		xbps_repo_binidx_unmap(bi);
+		return false;
+	}
+	for (uint32_t i = 0; i < bi->hdr->npkgs; i++) {
+		if ((name = map_string(&bi->m, recs[i].name)) == NULL ||
+		    recs[i].value >= bi->m.nwords ||
+		    recs[i].nwords > bi->m.nwords - recs[i].value ||
+		    !xbps_dictionary_append_lazy(idx, name, &recs[i]))
+			goto fail;
+	}
+	xbps_dictionary_seal(idx);
+	xbps_dictionary_make_immutable(idx);
+	repo->idx = idx;
+	if (meta != NULL) {
+		xbps_dictionary_make_immutable(meta);
+		repo->idxmeta = meta;
+		repo->is_signed = true;
+	}
+	return true;
+fail:
+	if (meta != NULL)
+		xbps_object_release(meta);
+	xbps_object_release(idx);
+	return false;
+}
+
+bool HIDDEN
+xbps_repo_binidx_open(struct xbps_repo *repo, const char *repofile,
+		const struct stat *st)
+{
+	struct xbps_repo_binidx *bi;
+
+	assert(repo);
+	assert(repofile);
+	assert(st);
+
+	if ((bi = malloc(sizeof(*bi))) == NULL)
+		return false;
+	if (!binidx_map(repo->xhp, repofile, st, bi)) {
+		free(bi);
+		return false;
+	}
+	if (!binidx_decode(repo, bi)) {
+		xbps_dbg_printf(repo->xhp, "[repo] `%s.idx' corrupt binary "
+		    "index\n", repofile);
+		return false;
+	}
+	xbps_dbg_printf(repo->xhp, "[repo] `%s.idx' using binary "
+	    "index\n", repofile);
+	return true;
+}
+
+struct xbps_repo_binidx HIDDEN *
+xbps_repo_binidx_map(struct xbps_handle *xhp, const char *repofile)
+{
+	struct xbps_repo_binidx *bi;
+	struct stat st;
+
+	assert(xhp);
+	assert(repofile);
+
+	if (stat(repofile, &st) == -1)
+		return NULL;
+	if ((bi = malloc(sizeof(*bi))) == NULL)
+		return NULL;
+	if (!binidx_map(xhp, repofile, &st, bi)) {
+		free(bi);
+		return NULL;
+	}
+	return bi;
+}
+
+const char HIDDEN *
+xbps_repo_binidx_get_pkgver(struct xbps_repo_binidx *bi, const char *pkgname,
+		bool *reverts)
+{
+	const struct binidx_rec *rec;
+	const char *name;
+	uint32_t lo = 0, hi = bi->hdr->npkgs;
+	int cmp;
+
+	assert(pkgname);
+
+	/* records are sorted by pkgname */
+	while (lo < hi) {
+		rec = &bi->recs[lo + (hi - lo) / 2];
+		if ((name = map_string(&bi->m, rec->name)) == NULL)
+			return NULL;
+		if ((cmp = strcmp(pkgname, name)) == 0) {
+			if (reverts != NULL)
+				*reverts = (rec->flags & BINIDX_REC_REVERTS) != 0;
+			return map_string(&bi->m, rec->pkgver);
+		} else if (cmp < 0) {
+			hi = lo + (hi - lo) / 2;
+		} else {
+			lo = lo + (hi - lo) / 2 + 1;
+		}
+	}
+	return NULL;
+}
+
+void HIDDEN
+xbps_repo_binidx_unmap(struct xbps_repo_binidx *bi)
+{
+	if (bi == NULL)
+		return;
+
+	munmap(bi->addr, bi->len);
+	free(bi);
+}
@@ -0,0 +1,827 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <openssl/sha.h>
+
+#include "xbps_api_impl.h"
+#include "fetch.h"
+
+/*
+ * Repository index deltas.
+ *
+ * Every time xbps-rindex(1) replaces a repository index it also writes
+ * a delta (<repofile>.<from>.delta) next to it, a plist dictionary
+ * with the following objects:
+ *
+ *	from		digest of the previous index
+ *	to		digest of the new index
+ *	removed		array of package names removed from the index
+ *	packages	dictionary of packages added or updated
+ *	index-meta	the new index-meta dictionary (only if it changed)
+ *	shlib-providers	sonames whose providers changed, mapped to their
+ *			new providers (an empty array if none is left);
+ *			used instead of index-meta when nothing else in it
+ *			changed
+ *
+ * The digest of an index is the SHA256 of its externalized index plist
+ * followed by its externalized index-meta plist, if any. The digest of
+ * the current index is published separately in <repofile>.delta, a
+ * plist dictionary with a single "digest" object.
+ *
+ * xbps_repo_sync() fetches <repofile>.delta first and doesn't look at
+ * its local copy if the repository has none. Otherwise the local copy
+ * is up to date if it has the published digest, if not it follows the
+ * chain of deltas starting at the digest of its local copy until the
+ * published digest is reached, verifies that the patched index has it
+ * and writes the patched index locally. If anything fails the whole
+ * repository archive is downloaded as usual.
+ *
+ * The digest of the local copy is kept in <repofile>.digest, so that
+ * the local index is hashed at most once per archive. It also records
+ * that the repository doesn't publish deltas, <repofile>.delta isn't
+ * requested again until the local archive is replaced.
+ */
+#define DELTA_SUFFIX	".delta"
+#define DELTA_STATE	".digest"
+#define DELTA_KEEP	16
+#define DELTA_MAX	DELTA_KEEP
+
+static void
+digest2hex(const unsigned char *digest, char *dst)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	for (unsigned int i = 0; i < XBPS_SHA256_DIGEST_SIZE; i++) {
+		*dst++ = hex[digest[i] >> 4];
+		*dst++ = hex[digest[i] & 0x0f];
+	}
+	*dst = '\0';
+}
+
+/*
+ * Computes the digest of an index into hexdigest.
+ */
+static bool
+index_digest(xbps_dictionary_t idx, xbps_dictionary_t meta, char *hexdigest)
+{
+	unsigned char digest[XBPS_SHA256_DIGEST_SIZE];
+	SHA256_CTX sha256;
+	char *buf;
+
+	if ((buf = xbps_dictionary_externalize(idx)) == NULL)
+		return false;
+
+	SHA256_Init(&sha256);
+	SHA256_Update(&sha256, buf, strlen(buf));
+	free(buf);
+
+	if (meta != NULL) {
+		if ((buf = xbps_dictionary_externalize(meta)) == NULL)
+			return false;
+		SHA256_Update(&sha256, buf, strlen(buf));
+		free(buf);
+	}
+	SHA256_Final(digest, &sha256);
+	digest2hex(digest, hexdigest);
+	return true;
+}
+
+/*
+ * Returns the sonames whose providers differ between the shlib-providers
+ * dictionaries of oldmeta and meta, or NULL if anything else in
+ * index-meta changed.
+ */
+static xbps_dictionary_t
+shlibs_delta(xbps_dictionary_t oldmeta, xbps_dictionary_t meta)
+{
+	xbps_dictionary_t d, oldshlibs, shlibs;
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym, obj, oldobj;
+	xbps_array_t none;
+	const char *key;
+	bool rv = true;
+
+	if (oldmeta == NULL ||
+	    xbps_dictionary_count(oldmeta) != xbps_dictionary_count(meta))
+		return NULL;
+
+	iter = xbps_dictionary_iterator(meta);
+	assert(iter);
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		key = xbps_dictionary_keysym_cstring_nocopy(keysym);
+		if (strcmp(key, "shlib-providers") == 0)
+			continue;
+		obj = xbps_dictionary_get(oldmeta, key);
+		if (obj == NULL || !xbps_object_equals(obj,
+		    xbps_dictionary_get_keysym(meta, keysym))) {
+			rv = false;
+			break;
+		}
+	}
+	xbps_object_iterator_release(iter);
+
+	oldshlibs = xbps_dictionary_get(oldmeta, "shlib-providers");
+	shlibs = xbps_dictionary_get(meta, "shlib-providers");
+	if (!rv || xbps_object_type(oldshlibs) != XBPS_TYPE_DICTIONARY ||
+	    xbps_object_type(shlibs) != XBPS_TYPE_DICTIONARY)
+		return NULL;
+
+	d = xbps_dictionary_create();
+	none = xbps_array_create();
+	assert(d);
+	assert(none);
+
+	iter = xbps_dictionary_iterator(oldshlibs);
+	assert(iter);
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		key = xbps_dictionary_keysym_cstring_nocopy(keysym);
+		if (xbps_dictionary_get(shlibs, key) == NULL)
+			xbps_dictionary_set(d, key, none);
+	}
+	xbps_object_iterator_release(iter);
+
+	iter = xbps_dictionary_iterator(shlibs);
+	assert(iter);
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		obj = xbps_dictionary_get_keysym(shlibs, keysym);
+		oldobj = xbps_dictionary_get_keysym(oldshlibs, keysym);
+		if (oldobj == NULL || !xbps_object_equals(oldobj, obj))
+			xbps_dictionary_set_keysym(d, keysym, obj);
+	}
+	xbps_object_iterator_release(iter);
+	xbps_object_release(none);
+
+	return d;
+}
+
+/*
+ * Returns a mutable copy of meta whose shlib-providers dictionary is
+ * mutable too, as required by shlibs_apply().
+ */
+static xbps_dictionary_t
+meta_copy_mutable(xbps_dictionary_t meta)
+{
+	xbps_dictionary_t newmeta, shlibs;
+	bool rv;
+
+	if ((newmeta = xbps_dictionary_copy_mutable(meta)) == NULL)
+		return NULL;
+	shlibs = xbps_dictionary_get(newmeta, "shlib-providers");
+	if (xbps_object_type(shlibs) != XBPS_TYPE_DICTIONARY)
+		return newmeta;
+	if ((shlibs = xbps_dictionary_copy_mutable(shlibs)) == NULL) {
+		xbps_object_release(newmeta);
+		return NULL;
+	}
+	rv = xbps_dictionary_set(newmeta, "shlib-providers", shlibs);
+	xbps_object_release(shlibs);
+	if (!rv) {
+		xbps_object_release(newmeta);
+		return NULL;
+	}
+	return newmeta;
+}
+
+/*
+ * Applies the shlib-providers changes of a delta to meta, a copy
+ * returned by meta_copy_mutable().
+ */
+static bool
+shlibs_apply(xbps_dictionary_t meta, xbps_dictionary_t changes)
+{
+	xbps_dictionary_t shlibs;
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym, obj;
+	bool rv = true;
+
+	shlibs = xbps_dictionary_get(meta, "shlib-providers");
+	if (xbps_object_type(shlibs) != XBPS_TYPE_DICTIONARY)
+		return false;
+	iter = xbps_dictionary_iterator(changes);
+	assert(iter);
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		obj = xbps_dictionary_get_keysym(changes, keysym);
+		if (xbps_object_type(obj) != XBPS_TYPE_ARRAY) {
+			rv = false;
+			break;
+		}
+		if (xbps_array_count(obj) == 0)
+			xbps_dictionary_remove_keysym(shlibs, keysym);
+		else if (!xbps_dictionary_set_keysym(shlibs, keysym, obj)) {
+			rv = false;
+			break;
+		}
+	}
+	xbps_object_iterator_release(iter);
+	return rv;
+}
+
+struct delta_file {
+	char *path;
+	struct timespec mtime;
+};
+
+static int
+delta_file_cmp(const void *a, const void *b)
+{
+	const struct delta_file *da = a, *db = b;
+
+	if (da->mtime.tv_sec != db->mtime.tv_sec)
+		return da->mtime.tv_sec < db->mtime.tv_sec ? -1 : 1;
+	if (da->mtime.tv_nsec != db->mtime.tv_nsec)
+		return da->mtime.tv_nsec < db->mtime.tv_nsec ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Removes all but the DELTA_KEEP most recent deltas of repofile.
+ */
+static void
+delta_prune(struct xbps_handle *xhp, const char *repofile)
+{
+	struct delta_file *files = NULL, *tmp;
+	struct dirent *dp;
+	struct stat st;
+	DIR *dirp;
+	const char *base;
+	char *dir;
+	size_t baselen, len, nfiles = 0;
+
+	if ((base = strrchr(repofile, '/')) != NULL) {
+		dir = strndup(repofile, (size_t)(base - repofile));
+		base++;
+	} else {
+		dir = strdup(".");
+		base = repofile;
+	}
+	if (dir == NULL)
+		return;
+	if ((dirp = opendir(dir[0] ? dir : "/")) == NULL) {
+		free(dir);
+		return;
+	}
+	baselen = strlen(base);
+	while ((dp = readdir(dirp)) != NULL) {
+		len = strlen(dp->d_name);
+		if (len != baselen + XBPS_SHA256_SIZE + strlen(DELTA_SUFFIX) ||
+		    strncmp(dp->d_name, base, baselen) != 0 ||
+		    dp->d_name[baselen] != '.' ||
+		    strcmp(dp->d_name + len - strlen(DELTA_SUFFIX),
+		    DELTA_SUFFIX) != 0)
+			continue;
+		if ((tmp = realloc(files, (nfiles + 1) * sizeof(*files))) == NULL)
+			break;
+		files = tmp;
+		files[nfiles].path = xbps_xasprintf("%s/%s", dir, dp->d_name);
+		if (stat(files[nfiles].path, &st) == -1) {
+			free(files[nfiles].path);
+			continue;
+		}
+		files[nfiles++].mtime = st.st_mtim;
+	}
+	closedir(dirp);
+
+	if (nfiles > DELTA_KEEP) {
+		qsort(files, nfiles, sizeof(*files), delta_file_cmp);
+		for (size_t i = 0; i < nfiles - DELTA_KEEP; i++) {
+			xbps_dbg_printf(xhp, "[repo] removing old delta %s\n",
+			    files[i].path);
+			(void)unlink(files[i].path);
+		}
+	}
+	for (size_t i = 0; i < nfiles; i++)
+		free(files[i].path);
+	free(files);
+	free(dir);
+}
+
+/*
+ * Publishes digest as the digest of the current index of repofile.
+ */
+static int
+delta_digest_write(struct xbps_handle *xhp, const char *repofile,
+		const char *digest)
+{
+	xbps_dictionary_t d;
+	char *digestfile;
+	int rv = 0;
+
+	if ((d = xbps_dictionary_create()) == NULL)
+		return ENOMEM;
+	if (!xbps_dictionary_set_cstring(d, "digest", digest)) {
+		xbps_object_release(d);
+		return ENOMEM;
+	}
+	digestfile = xbps_xasprintf("%s%s", repofile, DELTA_SUFFIX);
+	if (!xbps_dictionary_externalize_to_file(d, digestfile))
+		rv = errno;
+	else
+		xbps_dbg_printf(xhp, "[repo] `%s' digest is %s\n",
+		    repofile, digest);
+	free(digestfile);
+	xbps_object_release(d);
+	return rv;
+}
+
+int
+xbps_repo_delta_write(struct xbps_handle *xhp, const char *repofile,
+		xbps_dictionary_t oldidx, xbps_dictionary_t oldmeta,
+		xbps_dictionary_t idx, xbps_dictionary_t meta)
+{
+	xbps_dictionary_t delta, pkgs, oldpkgd, pkgd, shlibs;
+	xbps_array_t removed;
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym;
+	const char *pkgname;
+	char from[XBPS_SHA256_SIZE], to[XBPS_SHA256_SIZE];
+	char *deltafile;
+	int rv = 0;
+	bool ok;
+
+	assert(xhp);
+	assert(repofile);
+	assert(oldidx);
+	assert(idx);
+
+	if (xbps_object_type(oldmeta) != XBPS_TYPE_DICTIONARY)
+		oldmeta = NULL;
+	if (xbps_object_type(meta) != XBPS_TYPE_DICTIONARY)
+		meta = NULL;
+
+	if (!index_digest(oldidx, oldmeta, from) ||
+	    !index_digest(idx, meta, to))
+		return EINVAL;
+	/*
+	 * Removing index-meta can't be expressed in a delta, clients
+	 * will simply download the whole archive.
+	 */
+	if (strcmp(from, to) == 0 || (oldmeta != NULL && meta == NULL))
+		return delta_digest_write(xhp, repofile, to);
+
+	delta = xbps_dictionary_create();
+	removed = xbps_array_create();
+	pkgs = xbps_dictionary_create();
+	if (delta == NULL || removed == NULL || pkgs == NULL) {
+		rv = ENOMEM;
+		goto out;
+	}
+	iter = xbps_dictionary_iterator(oldidx);
+	assert(iter);
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		pkgname = xbps_dictionary_keysym_cstring_nocopy(keysym);
+		if (xbps_dictionary_get(idx, pkgname) == NULL &&
+		    !xbps_array_add_cstring_nocopy(removed, pkgname)) {
+			rv = ENOMEM;
+			break;
+		}
+	}
+	xbps_object_iterator_release(iter);
+	if (rv != 0)
+		goto out;
+
+	iter = xbps_dictionary_iterator(idx);
+	assert(iter);
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		pkgname = xbps_dictionary_keysym_cstring_nocopy(keysym);
+		pkgd = xbps_dictionary_get_keysym(idx, keysym);
+		oldpkgd = xbps_dictionary_get(oldidx, pkgname);
+		if (oldpkgd != NULL && xbps_dictionary_equals(oldpkgd, pkgd))
+			continue;
+		if (!xbps_dictionary_set(pkgs, pkgname, pkgd)) {
+			rv = ENOMEM;
+			break;
+		}
+	}
+	xbps_object_iterator_release(iter);
+	if (rv != 0)
+		goto out;
+
+	if (!xbps_dictionary_set_cstring(delta, "from", from) ||
+	    !xbps_dictionary_set_cstring(delta, "to", to) ||
+	    !xbps_dictionary_set(delta, "removed", removed) ||
+	    !xbps_dictionary_set(delta, "packages", pkgs)) {
+		rv = ENOMEM;
+		goto out;
+	}
+	if (meta != NULL && !xbps_dictionary_equals(oldmeta, meta)) {
+		/*
+		 * Usually only the shlib providers index changes, don't
+		 * send all of it again.
+		 */
+		if ((shlibs = shlibs_delta(oldmeta, meta)) != NULL) {
+			ok = xbps_dictionary_set(delta, "shlib-providers",
+			    shlibs);
+			xbps_object_release(shlibs);
+		} else {
+			ok = xbps_dictionary_set(delta, "index-meta", meta);
+		}
+		if (!ok) {
+			rv = ENOMEM;
+			goto out;
+		}
+	}
+	deltafile = xbps_xasprintf("%s.%s%s", repofile, from, DELTA_SUFFIX);
+	if (!xbps_dictionary_externalize_to_file(delta, deltafile)) {
+		rv = errno;
+		free(deltafile);
+		goto out;
+	}
+	xbps_dbg_printf(xhp, "[repo] `%s' delta written (%u removed, "
+	    "%u updated)\n", deltafile, xbps_array_count(removed),
+	    xbps_dictionary_count(pkgs));
+	free(deltafile);
+	delta_prune(xhp, repofile);
+	/* only now clients can reach the new digest */
+	rv = delta_digest_write(xhp, repofile, to);
+out:
+	if (delta != NULL)
+		xbps_object_release(delta);
+	if (removed != NULL)
+		xbps_object_release(removed);
+	if (pkgs != NULL)
+		xbps_object_release(pkgs);
+	return rv;
+}
+
+/*
+ * Applies delta to idx and meta, copies made by
+ * xbps_dictionary_copy_mutable() and meta_copy_mutable(), and updates
+ * digest with the digest announced by the delta.
+ */
+static bool
+delta_apply(struct xbps_handle *xhp, xbps_dictionary_t delta,
+		xbps_dictionary_t idx, xbps_dictionary_t *meta, char *digest)
+{
+	xbps_dictionary_t pkgs, pkgd, newmeta, shlibs;
+	xbps_array_t removed;
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym;
+	const char *dfrom = NULL, *dto = NULL, *pkgname;
+	bool rv = true;
+
+	xbps_dictionary_get_cstring_nocopy(delta, "from", &dfrom);
+	xbps_dictionary_get_cstring_nocopy(delta, "to", &dto);
+	removed = xbps_dictionary_get(delta, "removed");
+	pkgs = xbps_dictionary_get(delta, "packages");
+	newmeta = xbps_dictionary_get(delta, "index-meta");
+	shlibs = xbps_dictionary_get(delta, "shlib-providers");
+	if (dfrom == NULL || dto == NULL || strcmp(dfrom, digest) != 0 ||
+	    strlen(dto) != XBPS_SHA256_SIZE - 1 ||
+	    xbps_object_type(removed) != XBPS_TYPE_ARRAY ||
+	    xbps_object_type(pkgs) != XBPS_TYPE_DICTIONARY ||
+	    (newmeta != NULL &&
+	    xbps_object_type(newmeta) != XBPS_TYPE_DICTIONARY) ||
+	    (shlibs != NULL &&
+	    (xbps_object_type(shlibs) != XBPS_TYPE_DICTIONARY ||
+	    (newmeta == NULL && *meta == NULL)))) {
+		xbps_dbg_printf(xhp, "[repo] invalid delta\n");
+		return false;
+	}
+	for (unsigned int i = 0; i < xbps_array_count(removed); i++) {
+		if (!xbps_array_get_cstring_nocopy(removed, i, &pkgname))
+			return false;
+		xbps_dictionary_remove(idx, pkgname);
+	}
+	iter = xbps_dictionary_iterator(pkgs);
+	assert(iter);
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		pkgd = xbps_dictionary_get_keysym(pkgs, keysym);
+		if (xbps_object_type(pkgd) != XBPS_TYPE_DICTIONARY ||
+		    !xbps_dictionary_set_keysym(idx, keysym, pkgd)) {
+			rv = false;
+			break;
+		}
+	}
+	xbps_object_iterator_release(iter);
+	if (!rv)
+		return false;
+
+	if (newmeta != NULL) {
+		if ((newmeta = meta_copy_mutable(newmeta)) == NULL)
+			return false;
+		if (*meta != NULL)
+			xbps_object_release(*meta);
+		*meta = newmeta;
+	} else if (shlibs != NULL && !shlibs_apply(*meta, shlibs)) {
+		return false;
+	}
+	xbps_strlcpy(digest, dto, XBPS_SHA256_SIZE);
+	return true;
+}
+
+/*
+ * Writes a repository archive with idx and meta into repofile, with
+ * its modification time set to mtime.
+ */
+static bool
+delta_write_repodata(struct xbps_handle *xhp, const char *repofile,
+		xbps_dictionary_t idx, xbps_dictionary_t meta,
+		const struct timespec *mtime)
+{
+	struct archive *ar;
+	struct timespec ts[2];
+	char *tname, *buf;
+	int fd, rv = -1;
+
+	tname = xbps_xasprintf("%s.XXXXXXXXXX", repofile);
+	if ((fd = mkstemp(tname)) == -1) {
+		free(tname);
+		return false;
+	}
+	if ((ar = archive_write_new()) == NULL)
+		goto out;
+	archive_write_add_filter_zstd(ar);
+	archive_write_set_format_pax_restricted(ar);
+	if (archive_write_open_fd(ar, fd) != ARCHIVE_OK) {
+		archive_write_free(ar);
+		goto out;
+	}
+	if ((buf = xbps_dictionary_externalize(idx)) == NULL) {
+		archive_write_free(ar);
+		goto out;
+	}
+	rv = xbps_archive_append_buf(ar, buf, strlen(buf),
+	    XBPS_REPOIDX, 0644, "root", "root");
+	free(buf);
+	if (rv == 0) {
+		/* same as xbps-rindex(1) for unsigned repositories */
+		buf = meta ? xbps_dictionary_externalize(meta) : strdup("DEADBEEF");
+		rv = buf ? xbps_archive_append_buf(ar, buf, strlen(buf),
+		    XBPS_REPOIDX_META, 0644, "root", "root") : ENOMEM;
+		free(buf);
+	}
+	if (archive_write_close(ar) != ARCHIVE_OK)
+		rv = -1;
+	archive_write_free(ar);
+	if (rv != 0)
+		goto out;
+
+	ts[0] = ts[1] = *mtime;
+	rv = -1;
+#ifdef HAVE_FDATASYNC
+	fdatasync(fd);
+#else
+	fsync(fd);
+#endif
+	if (fchmod(fd, 0644) == -1 || futimens(fd, ts) == -1)
+		goto out;
+	if (rename(tname, repofile) == -1)
+		goto out;
+	rv = 0;
+out:
+	if (rv != 0) {
+		xbps_dbg_printf(xhp, "[repo] failed to write %s: %s\n",
+		    repofile, strerror(errno));
+		(void)unlink(tname);
+	}
+	close(fd);
+	free(tname);
+	return rv == 0;
+}
+
+/*
+ * Fetches the digest of the current remote index into digest.
+ */
+static bool
+delta_digest_fetch(struct xbps_handle *xhp, const char *repodata,
+		const char *deltafile, char *digest)
+{
+	xbps_dictionary_t d;
+	const char *str = NULL;
+	char *url;
+	bool rv = false;
+
+	(void)unlink(deltafile);
+	url = xbps_xasprintf("%s%s", repodata, DELTA_SUFFIX);
+	if (xbps_fetch_file_dest_basename(xhp, url, deltafile, NULL) == -1) {
+		xbps_dbg_printf(xhp, "[repo] no deltas %s: %s\n", url,
+		    xbps_fetch_error_string());
+		free(url);
+		return false;
+	}
+	free(url);
+	if ((d = xbps_plist_dictionary_from_file(xhp, deltafile)) == NULL)
+		return false;
+	if (xbps_dictionary_get_cstring_nocopy(d, "digest", &str) &&
+	    strlen(str) == XBPS_SHA256_SIZE - 1) {
+		xbps_strlcpy(digest, str, XBPS_SHA256_SIZE);
+		rv = true;
+	}
+	xbps_object_release(d);
+	return rv;
+}
+
+/*
+ * Reads the digest of the local copy of a repository from statefile,
+ * st is the local archive.  Returns 1 if it's known, 0 if the
+ * repository doesn't publish deltas and -1 if statefile doesn't belong
+ * to the local archive.
+ */
+static int
+delta_state_read(struct xbps_handle *xhp, const char *statefile,
+		const struct stat *st, char *digest)
+{
+	xbps_dictionary_t d;
+	const char *str = NULL;
+	uint64_t ino = 0;
+	int64_t ctim = 0, ctim_nsec = 0;
+	int rv = -1;
+
+	if (access(statefile, R_OK) == -1)
+		return -1;
+	if ((d = xbps_plist_dictionary_from_file(xhp, statefile)) == NULL)
+		return -1;
+	/* replacing the archive always changes its inode or ctime */
+	if (xbps_dictionary_get_uint64(d, "repodata-ino", &ino) &&
+	    xbps_dictionary_get_int64(d, "repodata-ctime", &ctim) &&
+	    xbps_dictionary_get_int64(d, "repodata-ctime-nsec", &ctim_nsec) &&
+	    ino == (uint64_t)st->st_ino && ctim == st->st_ctim.tv_sec &&
+	    ctim_nsec == st->st_ctim.tv_nsec) {
+		if (!xbps_dictionary_get_cstring_nocopy(d, "digest", &str)) {
+			rv = 0;
+		} else if (strlen(str) == XBPS_SHA256_SIZE - 1) {
+			xbps_strlcpy(digest, str, XBPS_SHA256_SIZE);
+			rv = 1;
+		}
+	}
+	xbps_object_release(d);
+	return rv;
+}
+
+/*
+ * Records digest as the digest of the local copy of a repository, or
+ * that the repository doesn't publish deltas if it's NULL.
+ */
+static void
+delta_state_write(struct xbps_handle *xhp, const char *repofile,
+		const char *statefile, const char *digest)
+{
+	xbps_dictionary_t d;
+	struct stat st;
+
+	if (stat(repofile, &st) == -1)
+		return;
+	if ((d = xbps_dictionary_create()) == NULL)
+		return;
+	if (!xbps_dictionary_set_uint64(d, "repodata-ino", st.st_ino) ||
+	    !xbps_dictionary_set_int64(d, "repodata-ctime", st.st_ctim.tv_sec) ||
+	    !xbps_dictionary_set_int64(d, "repodata-ctime-nsec",
+	    st.st_ctim.tv_nsec) ||
+	    (digest != NULL &&
+	    !xbps_dictionary_set_cstring(d, "digest", digest)) ||
+	    !xbps_dictionary_externalize_to_file(d, statefile)) {
+		xbps_dbg_printf(xhp, "[repo] failed to write %s: %s\n",
+		    statefile, strerror(errno));
+		(void)unlink(statefile);
+	}
+	xbps_object_release(d);
+}
+
+bool HIDDEN
+xbps_repo_sync_delta(struct xbps_handle *xhp, const char *uri,
+		const char *repodata, const char *repofile)
+{
+	struct xbps_repo *repo;
+	struct stat st;
+	struct timespec mtime = { 0, 0 };
+	xbps_dictionary_t idx = NULL, meta = NULL, delta;
+	char digest[XBPS_SHA256_SIZE], rdigest[XBPS_SHA256_SIZE];
+	char *url, *deltafile, *statefile;
+	unsigned int applied = 0;
+	int state;
+	bool uptodate = false;
+
+	if (stat(repofile, &st) == -1)
+		return false;
+	/*
+	 * Most repositories don't have deltas, don't do anything
+	 * else if they don't.
+	 */
+	statefile = xbps_xasprintf("%s%s", repofile, DELTA_STATE);
+	if ((state = delta_state_read(xhp, statefile, &st, digest)) == 0) {
+		xbps_dbg_printf(xhp, "[repo] `%s' has no deltas\n", repodata);
+		free(statefile);
+		return false;
+	}
+	deltafile = xbps_xasprintf("%s%s", repofile, DELTA_SUFFIX);
+	if (!delta_digest_fetch(xhp, repodata, deltafile, rdigest)) {
+		if (fetchLastErrCode == FETCH_UNAVAIL)
+			delta_state_write(xhp, repofile, statefile, NULL);
+		goto out;
+	}
+	if (state == 1 && strcmp(digest, rdigest) == 0) {
+		uptodate = true;
+		goto out;
+	}
+	if ((repo = xbps_repo_public_open(xhp, uri)) == NULL)
+		goto out;
+	if (state == -1) {
+		if (!index_digest(repo->idx, repo->idxmeta, digest)) {
+			xbps_repo_release(repo);
+			goto out;
+		}
+		delta_state_write(xhp, repofile, statefile, digest);
+		if (strcmp(digest, rdigest) == 0) {
+			xbps_repo_release(repo);
+			uptodate = true;
+			goto out;
+		}
+	}
+	/*
+	 * All deltas are applied to the same copy, only the result
+	 * is hashed.
+	 */
+	idx = xbps_dictionary_copy_mutable(repo->idx);
+	if (repo->idxmeta != NULL)
+		meta = meta_copy_mutable(repo->idxmeta);
+	if (idx == NULL || (repo->idxmeta != NULL && meta == NULL)) {
+		xbps_repo_release(repo);
+		goto out;
+	}
+	xbps_repo_release(repo);
+
+	while (strcmp(digest, rdigest) != 0 && applied < DELTA_MAX) {
+		(void)unlink(deltafile);
+		url = xbps_xasprintf("%s.%s%s", repodata, digest, DELTA_SUFFIX);
+		if (xbps_fetch_file_dest_basename(xhp, url, deltafile, NULL) == -1) {
+			xbps_dbg_printf(xhp, "[repo] no delta %s: %s\n", url,
+			    xbps_fetch_error_string());
+			free(url);
+			goto out;
+		}
+		free(url);
+		if (stat(deltafile, &st) == -1 ||
+		    (delta = xbps_plist_dictionary_from_file(xhp, deltafile)) == NULL)
+			goto out;
+		if (!delta_apply(xhp, delta, idx, &meta, digest)) {
+			xbps_object_release(delta);
+			goto out;
+		}
+		xbps_object_release(delta);
+		mtime = st.st_mtim;
+		applied++;
+		xbps_dbg_printf(xhp, "[repo] `%s' applied delta to %s\n",
+		    repofile, digest);
+	}
+	/*
+	 * The chain must end in the digest published by the repository,
+	 * and the patched index must really have it.
+	 */
+	if (strcmp(digest, rdigest) != 0 || !index_digest(idx, meta, digest) ||
+	    strcmp(digest, rdigest) != 0) {
+		xbps_dbg_printf(xhp, "[repo] `%s' deltas don't result in %s\n",
+		    repofile, rdigest);
+		goto out;
+	}
+	xbps_dictionary_make_immutable(idx);
+	if (meta != NULL)
+		xbps_dictionary_make_immutable(meta);
+	if (delta_write_repodata(xhp, repofile, idx, meta, &mtime)) {
+		(void)xbps_repo_binidx_write(xhp, repofile, idx, meta);
+		delta_state_write(xhp, repofile, statefile, rdigest);
+		uptodate = true;
+	}
+out:
+	if (uptodate && !applied)
+		xbps_dbg_printf(xhp, "[repo] `%s' is up to date\n", repofile);
+	(void)unlink(deltafile);
+	free(deltafile);
+	free(statefile);
+	if (idx != NULL)
+		xbps_object_release(idx);
+	if (meta != NULL)
+		xbps_object_release(meta);
+	return uptodate;
+}
@@ -0,0 +1,856 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <zstd.h>
+#include <zdict.h>
+
+#include "xbps_api_impl.h"
+
+/*
+ * Multi-frame zstd repository archives.
+ *
+ * xbps-rindex compresses the tar stream of a repository archive as a
+ * sequence of zstd frames of FRAME_SIZE uncompressed bytes each, which
+ * can be decompressed independently of each other. The frames are
+ * followed by a seek table in the zstd seekable format, stored in a
+ * skippable frame:
+ *
+ *	uint32_t	SKIPPABLE_MAGIC
+ *	uint32_t	size of the seek table
+ *	{ uint32_t, uint32_t }[]
+ *			compressed and decompressed size of every frame
+ *	uint32_t	number of frames
+ *	uint8_t		descriptor (bit 7 set if entries have a checksum)
+ *	uint32_t	SEEKABLE_MAGIC
+ *
+ * All integers are little endian. Concatenated frames and skippable
+ * frames are part of the zstd format, so the archive is still a valid
+ * zstd stream for readers that ignore the seek table.
+ *
+ * If the repository has a zstd dictionary (<arch>-repodata.dict), trained
+ * from its package dictionaries by xbps-rindex --train-dict, frames are
+ * compressed with it and their header carries its ID. Such archives can
+ * only be read by clients that fetch the dictionary as well.
+ *
+ * The dictionary is replaced when it's trained again, so every archive
+ * written with it publishes a copy named after its ID as well
+ * (<arch>-repodata.dict.<ID>) before the archive itself is renamed into
+ * place. That is the one clients fetch, as named by the archive they
+ * got, which can't be paired with a dictionary it wasn't compressed with.
+ * Copies no current archive refers to are removed by xbps-rindex -c.
+ */
+#define FRAME_SIZE		(1024 * 1024)
+#define SKIPPABLE_MAGIC		0x184D2A5EU
+#define SEEKABLE_MAGIC		0x8F92EAB1U
+#define SEEKABLE_CHECKSUM	0x80
+#define SEEKABLE_RESERVED	0x7C
+#define SKIPPABLE_HDR_SIZE	8
+#define SEEKABLE_FOOTER_SIZE	9
+#define FRAME_HEADER_MAX	18	/* ZSTD_FRAMEHEADERSIZE_MAX */
+#define FRAMES_MAX_SIZE		(1024UL * 1024 * 1024)
+#define DICT_SIZE		(110 * 1024)
+
+struct repo_frame {
+	const uint8_t *src;
+	size_t csize;
+	uint8_t *dst;
+	size_t dsize;
+};
+
+struct repo_frames_reader {
+	struct repo_frame *frames;
+	unsigned int nframes;
+	unsigned int next;
+};
+
+struct repo_frames_thread {
+	pthread_t thread;
+	struct repo_frame *frames;
+	unsigned int nframes;
+	unsigned int start;
+	unsigned int step;
+	const ZSTD_DDict *ddict;
+	bool ok;
+};
+
+static uint32_t
+le32dec(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+	    (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void
+le32enc(uint8_t *p, uint32_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = (v >> 24) & 0xff;
+}
+
+static int
+write_all(int fd, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		if ((n = write(fd, p, len)) == -1) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		p += n;
+		len -= (size_t)n;
+	}
+	return 0;
+}
+
+static char *
+dict_path(struct xbps_handle *xhp, const char *url)
+{
+	char *repofile, *path;
+
+	if ((repofile = xbps_repo_file(xhp, url, "repodata")) == NULL)
+		return NULL;
+	path = xbps_xasprintf("%s.dict", repofile);
+	free(repofile);
+	return path;
+}
+
+static char *
+dict_path_id(struct xbps_handle *xhp, const char *url, uint32_t dictid)
+{
+	char *dictfile, *path;
+
+	if ((dictfile = dict_path(xhp, url)) == NULL)
+		return NULL;
+	path = xbps_xasprintf("%s.%u", dictfile, dictid);
+	free(dictfile);
+	return path;
+}
+
+/*
+ * Returns the contents of the dictionary file, NULL and errno set
+ * to ENOENT if there's none.
+ */
+static void *
+dict_load(const char *path, size_t *lenp)
+{
+	struct stat st;
+	uint8_t *buf;
+	size_t off = 0;
+	ssize_t n;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY|O_CLOEXEC)) == -1)
+		return NULL;
+	if (fstat(fd, &st) == -1 || st.st_size <= 0) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+	if ((buf = malloc((size_t)st.st_size)) == NULL) {
+		close(fd);
+		return NULL;
+	}
+	while (off < (size_t)st.st_size) {
+		n = read(fd, buf + off, (size_t)st.st_size - off);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			free(buf);
+			close(fd);
+			errno = EIO;
+			return NULL;
+		}
+		off += (size_t)n;
+	}
+	close(fd);
+	*lenp = off;
+	return buf;
+}
+
+/*
+ * Atomically replaces the dictionary file at path.
+ */
+static int
+dict_write(const char *path, const void *dict, size_t dictlen)
+{
+	char *tname;
+	int fd, rv = 0;
+
+	tname = xbps_xasprintf("%s.XXXXXXXXXX", path);
+	if ((fd = mkstemp(tname)) == -1) {
+		rv = errno;
+		free(tname);
+		return rv;
+	}
+	if ((rv = write_all(fd, dict, dictlen)) != 0)
+		goto out;
+#ifdef HAVE_FDATASYNC
+	fdatasync(fd);
+#else
+	fsync(fd);
+#endif
+	if (fchmod(fd, 0644) == -1 || rename(tname, path) == -1)
+		rv = errno;
+out:
+	close(fd);
+	if (rv != 0)
+		unlink(tname);
+	free(tname);
+	return rv;
+}
+
+/*
+ * Returns the ID of the dictionary stored in dictfile, 0 if it
+ * doesn't exist or isn't a zstd dictionary.
+ */
+uint32_t HIDDEN
+xbps_repo_frames_dictfile_id(const char *dictfile)
+{
+	uint8_t hdr[8];
+	ssize_t n;
+	int fd;
+
+	if ((fd = open(dictfile, O_RDONLY|O_CLOEXEC)) == -1)
+		return 0;
+	n = read(fd, hdr, sizeof(hdr));
+	close(fd);
+	if (n != (ssize_t)sizeof(hdr))
+		return 0;
+	return ZSTD_getDictID_fromDict(hdr, sizeof(hdr));
+}
+
+int
+xbps_repo_dict_train(struct xbps_handle *xhp, const char *repodir,
+		xbps_dictionary_t idx)
+{
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym;
+	xbps_dictionary_t pkgd;
+	char *samples = NULL, *buf, *dictfile = NULL;
+	size_t *sizes = NULL, total = 0, len, dictlen, capacity;
+	unsigned int nsamples = 0, count;
+	void *dict = NULL;
+	int rv = 0;
+
+	assert(xhp);
+	assert(repodir);
+
+	count = xbps_dictionary_count(idx);
+	if (count == 0)
+		return EINVAL;
+	if ((sizes = calloc(count, sizeof(*sizes))) == NULL)
+		return ENOMEM;
+	/*
+	 * Every package dictionary is a sample; they are the same
+	 * objects that package archives carry in their props.plist.
+	 */
+	iter = xbps_dictionary_iterator(idx);
+	assert(iter);
+	while ((keysym = xbps_object_iterator_next(iter)) && nsamples < count) {
+		pkgd = xbps_dictionary_get_keysym(idx, keysym);
+		if ((buf = xbps_dictionary_externalize(pkgd)) == NULL) {
+			rv = EINVAL;
+			break;
+		}
+		len = strlen(buf);
+		if ((samples = realloc(samples, total + len)) == NULL) {
+			free(buf);
+			rv = ENOMEM;
+			break;
+		}
+		memcpy(samples + total, buf, len);
+		free(buf);
+		sizes[nsamples++] = len;
+		total += len;
+	}
+	xbps_object_iterator_release(iter);
+	if (rv != 0)
+		goto out;
+
+	/* dictionaries about 1/10 of the samples work best */
+	capacity = total / 10;
+	if (capacity > DICT_SIZE)
+		capacity = DICT_SIZE;
+	if (capacity < 1024) {
+		rv = EINVAL;
+		goto out;
+	}
+	if ((dict = malloc(capacity)) == NULL) {
+		rv = ENOMEM;
+		goto out;
+	}
+	dictlen = ZDICT_trainFromBuffer(dict, capacity, samples, sizes, nsamples);
+	if (ZDICT_isError(dictlen)) {
+		xbps_dbg_printf(xhp, "[repo] `%s' failed to train dictionary: "
+		    "%s\n", repodir, ZDICT_getErrorName(dictlen));
+		rv = EINVAL;
+		goto out;
+	}
+
+	if ((dictfile = dict_path(xhp, repodir)) == NULL) {
+		rv = EINVAL;
+		goto out;
+	}
+	if ((rv = dict_write(dictfile, dict, dictlen)) != 0)
+		goto out;
+	xbps_dbg_printf(xhp, "[repo] `%s' dictionary written (%zu bytes, "
+	    "%u samples)\n", dictfile, dictlen, nsamples);
+out:
+	free(dictfile);
+	free(dict);
+	free(samples);
+	free(sizes);
+	return rv;
+}
+
+int
+xbps_repo_dict_prune(struct xbps_handle *xhp, const char *repodir)
+{
+	DIR *dirp;
+	struct dirent *dp;
+	uint32_t keep[2];
+	char *repofile, *prefix, *path, *endp;
+	size_t plen;
+	unsigned long id;
+	int rv = 0;
+
+	assert(xhp);
+	assert(repodir);
+
+	/*
+	 * Only the copies named by the current archives are fetched
+	 * by clients, every other one was replaced by a later training.
+	 */
+	repofile = xbps_repo_path_with_name(xhp, repodir, "repodata");
+	keep[0] = xbps_repo_frames_dictid(repofile);
+	prefix = xbps_xasprintf("%s.dict.", strrchr(repofile, '/') + 1);
+	free(repofile);
+	repofile = xbps_repo_path_with_name(xhp, repodir, "stagedata");
+	keep[1] = xbps_repo_frames_dictid(repofile);
+	free(repofile);
+
+	if ((dirp = opendir(repodir)) == NULL) {
+		rv = errno;
+		free(prefix);
+		return rv;
+	}
+	plen = strlen(prefix);
+	while ((dp = readdir(dirp))) {
+		if (strncmp(dp->d_name, prefix, plen) ||
+		    dp->d_name[plen] < '0' || dp->d_name[plen] > '9')
+			continue;
+		errno = 0;
+		id = strtoul(dp->d_name + plen, &endp, 10);
+		if (errno || *endp != '\0' || id > UINT32_MAX)
+			continue;
+		if (id == keep[0] || id == keep[1])
+			continue;
+		path = xbps_xasprintf("%s/%s", repodir, dp->d_name);
+		if (unlink(path) == -1 && errno != ENOENT) {
+			rv = errno;
+			xbps_dbg_printf(xhp, "[repo] failed to remove `%s': "
+			    "%s\n", path, strerror(rv));
+		} else {
+			xbps_dbg_printf(xhp, "[repo] removed obsolete "
+			    "dictionary `%s'\n", path);
+		}
+		free(path);
+	}
+	(void)closedir(dirp);
+	free(prefix);
+	return rv;
+}
+
+int
+xbps_repo_frames_write(struct xbps_handle *xhp, const char *repodir,
+		int fd, const void *buf, size_t len, int level)
+{
+	ZSTD_CCtx *cctx;
+	ZSTD_CDict *cdict = NULL;
+	const uint8_t *src = buf;
+	uint8_t *dst = NULL, *table = NULL, *p;
+	size_t off = 0, n, csize, tablesize, dictlen = 0;
+	unsigned int nframes, i = 0;
+	uint32_t dictid;
+	char *dictfile;
+	void *dict;
+	int rv = 0;
+
+	assert(xhp);
+	assert(repodir);
+	assert(buf);
+
+	nframes = len == 0 ? 1 : (unsigned int)((len + FRAME_SIZE - 1) / FRAME_SIZE);
+	tablesize = (size_t)nframes * 8 + SEEKABLE_FOOTER_SIZE;
+	if (tablesize > UINT32_MAX)
+		return EFBIG;
+
+	/*
+	 * Use the repository dictionary, if there's one.
+	 */
+	if ((dictfile = dict_path(xhp, repodir)) == NULL)
+		return EINVAL;
+	dict = dict_load(dictfile, &dictlen);
+	if (dict == NULL && errno != ENOENT) {
+		rv = errno;
+		free(dictfile);
+		return rv;
+	}
+	free(dictfile);
+	if (dict != NULL) {
+		/* publish the copy clients fetch for this archive */
+		dictid = ZSTD_getDictID_fromDict(dict, dictlen);
+		if (dictid == 0) {
+			free(dict);
+			return EINVAL;
+		}
+		dictfile = dict_path_id(xhp, repodir, dictid);
+		if (dictfile == NULL) {
+			free(dict);
+			return EINVAL;
+		}
+		if (access(dictfile, F_OK) == -1 &&
+		    (rv = dict_write(dictfile, dict, dictlen)) != 0) {
+			free(dictfile);
+			free(dict);
+			return rv;
+		}
+		free(dictfile);
+		cdict = ZSTD_createCDict(dict, dictlen, level);
+		free(dict);
+		if (cdict == NULL)
+			return EINVAL;
+	}
+
+	if ((cctx = ZSTD_createCCtx()) == NULL) {
+		ZSTD_freeCDict(cdict);
+		return ENOMEM;
+	}
+	dst = malloc(ZSTD_compressBound(FRAME_SIZE));
+	table = malloc(SKIPPABLE_HDR_SIZE + tablesize);
+	if (dst == NULL || table == NULL) {
+		rv = ENOMEM;
+		goto out;
+	}
+	le32enc(table, SKIPPABLE_MAGIC);
+	le32enc(table + 4, (uint32_t)tablesize);
+	p = table + SKIPPABLE_HDR_SIZE;
+
+	do {
+		n = len - off;
+		if (n > FRAME_SIZE)
+			n = FRAME_SIZE;
+		if (cdict != NULL)
+			csize = ZSTD_compress_usingCDict(cctx, dst,
+			    ZSTD_compressBound(FRAME_SIZE), src + off, n, cdict);
+		else
+			csize = ZSTD_compressCCtx(cctx, dst,
+			    ZSTD_compressBound(FRAME_SIZE), src + off, n, level);
+		if (ZSTD_isError(csize)) {
+			rv = EINVAL;
+			goto out;
+		}
+		if ((rv = write_all(fd, dst, csize)) != 0)
+			goto out;
+		le32enc(p, (uint32_t)csize);
+		le32enc(p + 4, (uint32_t)n);
+		p += 8;
+		off += n;
+		i++;
+	} while (off < len);
+	assert(i == nframes);
+
+	le32enc(p, nframes);
+	p[4] = 0;
+	le32enc(p + 5, SEEKABLE_MAGIC);
+	rv = write_all(fd, table, SKIPPABLE_HDR_SIZE + tablesize);
+out:
+	ZSTD_freeCCtx(cctx);
+	ZSTD_freeCDict(cdict);
+	free(dst);
+	free(table);
+	return rv;
+}
+
+static bool
+repo_frames_decompress(struct repo_frame *frames, unsigned int nframes,
+		unsigned int start, unsigned int step, const ZSTD_DDict *ddict)
+{
+	ZSTD_DCtx *dctx;
+	size_t rv;
+	bool ok = true;
+
+	if ((dctx = ZSTD_createDCtx()) == NULL)
+		return false;
+	for (unsigned int i = start; ok && i < nframes; i += step) {
+		rv = ZSTD_decompress_usingDDict(dctx, frames[i].dst,
+		    frames[i].dsize, frames[i].src, frames[i].csize, ddict);
+		ok = !ZSTD_isError(rv) && rv == frames[i].dsize;
+	}
+	ZSTD_freeDCtx(dctx);
+	return ok;
+}
+
+#ifndef SINGLE_THREADED
+/*
+ * Repositories are opened in parallel too, the number of decompression
+ * threads of the whole process is limited to the number of online CPUs
+ * (besides the threads opening them).
+ */
+static pthread_mutex_t frames_threads_mtx = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int frames_threads;
+
+static unsigned int
+repo_frames_threads_get(unsigned int n)
+{
+	unsigned int max;
+	long ncpus;
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	max = ncpus > 1 ? (unsigned int)ncpus - 1 : 0;
+	pthread_mutex_lock(&frames_threads_mtx);
+	if (frames_threads >= max)
+		n = 0;
+	else if (n > max - frames_threads)
+		n = max - frames_threads;
+	frames_threads += n;
+	pthread_mutex_unlock(&frames_threads_mtx);
+	return n;
+}
+
+static void
+repo_frames_threads_put(unsigned int n)
+{
+	pthread_mutex_lock(&frames_threads_mtx);
+	frames_threads -= n;
+	pthread_mutex_unlock(&frames_threads_mtx);
+}
+
+static void *
+repo_frames_thread(void *arg)
+{
+	struct repo_frames_thread *thd = arg;
+
+	thd->ok = repo_frames_decompress(thd->frames, thd->nframes,
+	    thd->start, thd->step, thd->ddict);
+	return NULL;
+}
+#endif
+
+/*
+ * Decompresses all frames, spreading them over the calling thread and
+ * as many other threads as repo_frames_threads_get() allows.
+ */
+static bool
+repo_frames_decompress_all(struct xbps_handle *xhp,
+		struct repo_frame *frames, unsigned int nframes,
+		const ZSTD_DDict *ddict)
+{
+#ifdef SINGLE_THREADED
+	(void)xhp;
+	return repo_frames_decompress(frames, nframes, 0, 1, ddict);
+#else
+	struct repo_frames_thread *thd;
+	unsigned int i, nthreads, extra;
+	int rv;
+	bool ok;
+
+	if ((extra = repo_frames_threads_get(nframes - 1)) == 0)
+		return repo_frames_decompress(frames, nframes, 0, 1, ddict);
+	if ((thd = calloc(extra, sizeof(*thd))) == NULL) {
+		repo_frames_threads_put(extra);
+		return repo_frames_decompress(frames, nframes, 0, 1, ddict);
+	}
+	nthreads = extra + 1;
+	xbps_dbg_printf(xhp, "[repo] decompressing %u frames with %u "
+	    "threads\n", nframes, nthreads);
+	for (i = 0; i < extra; i++) {
+		thd[i].frames = frames;
+		thd[i].nframes = nframes;
+		thd[i].start = i + 1;
+		thd[i].step = nthreads;
+		thd[i].ddict = ddict;
+		rv = pthread_create(&thd[i].thread, NULL,
+		    repo_frames_thread, &thd[i]);
+		if (rv != 0) {
+			xbps_dbg_printf(xhp, "[repo] failed to create "
+			    "thread: %s\n", strerror(rv));
+			break;
+		}
+	}
+	/*
+	 * The calling thread decompresses the first slice and those of
+	 * the threads that couldn't be created.
+	 */
+	ok = repo_frames_decompress(frames, nframes, 0, nthreads, ddict);
+	for (unsigned int j = i; ok && j < extra; j++)
+		ok = repo_frames_decompress(frames, nframes, j + 1, nthreads,
+		    ddict);
+	for (unsigned int j = 0; j < i; j++) {
+		pthread_join(thd[j].thread, NULL);
+		ok = ok && thd[j].ok;
+	}
+	repo_frames_threads_put(extra);
+	free(thd);
+	return ok;
+#endif
+}
+
+/*
+ * Parses the seek table at the end of the mapped archive and fills
+ * in the frames. Returns the number of frames, or 0 if the archive
+ * doesn't have a seek table or it doesn't match the file.
+ *
+ * The decompressed sizes in the seek table must match the content
+ * size in the header of every frame, which xbps-rindex always writes,
+ * and can't be more than FRAME_SIZE each and FRAMES_MAX_SIZE in total.
+ */
+static unsigned int
+repo_frames_parse(const uint8_t *map, size_t len, struct repo_frame **framesp)
+{
+	struct repo_frame *frames;
+	const uint8_t *footer, *p;
+	size_t tablesize, entsize, csize = 0, dsize = 0;
+	unsigned int nframes;
+	uint8_t desc;
+
+	if (len < SKIPPABLE_HDR_SIZE + SEEKABLE_FOOTER_SIZE)
+		return 0;
+	footer = map + len - SEEKABLE_FOOTER_SIZE;
+	if (le32dec(footer + 5) != SEEKABLE_MAGIC)
+		return 0;
+	nframes = le32dec(footer);
+	desc = footer[4];
+	if (nframes == 0 || (desc & SEEKABLE_RESERVED))
+		return 0;
+	entsize = (desc & SEEKABLE_CHECKSUM) ? 12 : 8;
+	tablesize = (size_t)nframes * entsize + SEEKABLE_FOOTER_SIZE;
+	if (tablesize > len - SKIPPABLE_HDR_SIZE)
+		return 0;
+	p = map + len - tablesize - SKIPPABLE_HDR_SIZE;
+	if (le32dec(p) != SKIPPABLE_MAGIC || le32dec(p + 4) != tablesize)
+		return 0;
+	p += SKIPPABLE_HDR_SIZE;
+
+	if ((frames = calloc(nframes, sizeof(*frames))) == NULL)
+		return 0;
+	for (unsigned int i = 0; i < nframes; i++, p += entsize) {
+		frames[i].src = map + csize;
+		frames[i].csize = le32dec(p);
+		frames[i].dsize = le32dec(p + 4);
+		csize += frames[i].csize;
+		dsize += frames[i].dsize;
+		if (csize > len || frames[i].dsize > FRAME_SIZE ||
+		    dsize > FRAMES_MAX_SIZE ||
+		    ZSTD_getFrameContentSize(frames[i].src, frames[i].csize) !=
+		    frames[i].dsize) {
+			free(frames);
+			return 0;
+		}
+	}
+	/* frames must be followed by the seek table */
+	if (csize != len - tablesize - SKIPPABLE_HDR_SIZE) {
+		free(frames);
+		return 0;
+	}
+	*framesp = frames;
+	return nframes;
+}
+
+/*
+ * Returns the ID of the dictionary the first frame of the archive
+ * was compressed with, 0 if none.
+ */
+uint32_t HIDDEN
+xbps_repo_frames_dictid(const char *repofile)
+{
+	uint8_t hdr[FRAME_HEADER_MAX];
+	ssize_t n;
+	int fd;
+
+	if ((fd = open(repofile, O_RDONLY|O_CLOEXEC)) == -1)
+		return 0;
+	n = read(fd, hdr, sizeof(hdr));
+	close(fd);
+	if (n <= 0)
+		return 0;
+	return ZSTD_getDictID_fromFrame(hdr, (size_t)n);
+}
+
+/*
+ * The decompressed frames are handed to libarchive one at a time, every
+ * frame is freed as soon as it has been read.
+ */
+static ssize_t
+repo_frames_read(struct archive *ar UNUSED, void *arg, const void **buf)
+{
+	struct repo_frames_reader *rd = arg;
+
+	if (rd->next > 0) {
+		free(rd->frames[rd->next - 1].dst);
+		rd->frames[rd->next - 1].dst = NULL;
+	}
+	if (rd->next == rd->nframes)
+		return 0;
+	*buf = rd->frames[rd->next].dst;
+	return (ssize_t)rd->frames[rd->next++].dsize;
+}
+
+static void
+repo_frames_free(struct repo_frame *frames, unsigned int nframes)
+{
+	for (unsigned int i = 0; i < nframes; i++)
+		free(frames[i].dst);
+	free(frames);
+}
+
+static int
+repo_frames_close(struct archive *ar UNUSED, void *arg)
+{
+	struct repo_frames_reader *rd = arg;
+
+	repo_frames_free(rd->frames, rd->nframes);
+	free(rd);
+	return ARCHIVE_OK;
+}
+
+/*
+ * Opens the tar stream of a multi-frame repository archive after
+ * decompressing it in memory, frames are decompressed in parallel.
+ * Returns ENOTSUP if the archive doesn't have a seek table, so that
+ * it's read sequentially by libarchive instead, and ENOENT if the
+ * repository dictionary it needs is missing or doesn't match.
+ */
+int HIDDEN
+xbps_repo_frames_open(struct xbps_repo *repo, const char *repofile,
+		const struct stat *st)
+{
+	struct repo_frames_reader *rd;
+	struct repo_frame *frames = NULL;
+	ZSTD_DDict *ddict = NULL;
+	uint8_t *map;
+	size_t dictlen;
+	unsigned int nframes = 0;
+	uint32_t dictid;
+	char *dictfile;
+	void *dict;
+	int rv = EINVAL;
+
+	if (st->st_size <= 0)
+		return ENOTSUP;
+	map = mmap(NULL, (size_t)st->st_size, PROT_READ, MAP_PRIVATE,
+	    repo->fd, 0);
+	if (map == MAP_FAILED)
+		return ENOTSUP;
+
+	nframes = repo_frames_parse(map, (size_t)st->st_size, &frames);
+	if (nframes == 0) {
+		rv = ENOTSUP;
+		goto out;
+	}
+	dictid = ZSTD_getDictID_fromFrame(frames[0].src, frames[0].csize);
+	if (dictid != 0) {
+		rv = ENOENT;
+		/*
+		 * Local repositories may have trained a new dictionary
+		 * already, the copy named after its ID is still there.
+		 */
+		if ((dictfile = dict_path(repo->xhp, repo->uri)) == NULL)
+			goto out;
+		if (xbps_repo_frames_dictfile_id(dictfile) != dictid) {
+			free(dictfile);
+			dictfile = dict_path_id(repo->xhp, repo->uri, dictid);
+			if (dictfile == NULL)
+				goto out;
+		}
+		dict = dict_load(dictfile, &dictlen);
+		if (dict != NULL) {
+			ddict = ZSTD_createDDict(dict, dictlen);
+			free(dict);
+		}
+		if (ddict == NULL || ZSTD_getDictID_fromDDict(ddict) != dictid) {
+			xbps_dbg_printf(repo->xhp, "[repo] `%s' missing "
+			    "dictionary %u\n", dictfile, dictid);
+			free(dictfile);
+			goto out;
+		}
+		free(dictfile);
+		rv = EINVAL;
+	}
+	for (unsigned int i = 0; i < nframes; i++) {
+		frames[i].dst = malloc(frames[i].dsize > 0 ? frames[i].dsize : 1);
+		if (frames[i].dst == NULL)
+			goto out;
+	}
+	if (!repo_frames_decompress_all(repo->xhp, frames, nframes, ddict)) {
+		xbps_dbg_printf(repo->xhp, "[repo] `%s' failed to "
+		    "decompress frames\n", repofile);
+		goto out;
+	}
+	if ((rd = calloc(1, sizeof(*rd))) == NULL)
+		goto out;
+	rd->frames = frames;
+	rd->nframes = nframes;
+	frames = NULL;
+
+	repo->ar = archive_read_new();
+	assert(repo->ar);
+	archive_read_support_format_tar(repo->ar);
+	/* the frames are released with the archive by xbps_repo_close() */
+	if (archive_read_open(repo->ar, rd, NULL, repo_frames_read,
+	    repo_frames_close) == ARCHIVE_FATAL) {
+		xbps_dbg_printf(repo->xhp,
+		    "[repo] `%s' failed to open repodata archive %s\n",
+		    repofile, archive_error_string(repo->ar));
+		archive_read_finish(repo->ar);
+		repo->ar = NULL;
+		goto out;
+	}
+	rv = 0;
+out:
+	ZSTD_freeDDict(ddict);
+	if (frames != NULL)
+		repo_frames_free(frames, nframes);
+	munmap(map, (size_t)st->st_size);
+	return rv;
+}
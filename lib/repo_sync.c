@@ -67,6 +67,39 @@ xbps_get_remote_repo_string(const char *uri)
 	return p;
 }
 
+/*
+ * Fetches the repository dictionary if the archive was compressed
+ * with one and the local copy is missing or is a different one,
+ * failures are reported when the repository is opened.
+ */
+static void
+repo_sync_dict(struct xbps_handle *xhp, const char *repodata,
+		const char *repofile)
+{
+	const char *fetchstr;
+	char *dicturl, *dictfile;
+	uint32_t dictid;
+
+	if ((dictid = xbps_repo_frames_dictid(repofile)) == 0)
+		return;
+
+	dictfile = xbps_xasprintf("%s.dict", repofile);
+	if (xbps_repo_frames_dictfile_id(dictfile) == dictid) {
+		free(dictfile);
+		return;
+	}
+	/* the copy named after its ID always matches the archive */
+	(void)remove(dictfile);
+	dicturl = xbps_xasprintf("%s.dict.%u", repodata, dictid);
+	if (xbps_fetch_file_dest_basename(xhp, dicturl, dictfile, NULL) == -1) {
+		fetchstr = xbps_fetch_error_string();
+		xbps_dbg_printf(xhp, "[reposync] failed to fetch `%s': %s\n",
+		    dicturl, fetchstr ? fetchstr : strerror(errno));
+	}
+	free(dicturl);
+	free(dictfile);
+}
+
 /*
  * Returns -1 on error, 0 if transfer was not necessary (local/remote
  * size and/or mtime match) and 1 if downloaded successfully.
@@ -74,9 +107,10 @@ xbps_get_remote_repo_string(const char *uri)
 int HIDDEN
 xbps_repo_sync(struct xbps_handle *xhp, const char *uri)
 {
+	struct xbps_repo *repo;
 	mode_t prev_umask;
 	const char *arch, *fetchstr = NULL;
-	char *repodata, *lrepodir, *uri_fixedp;
+	char *repodata, *repofile, *lrepodir, *uri_fixedp, *idxfile;
 	int rv = 0;
 
 	assert(uri != NULL);
@@ -115,37 +149,56 @@ xbps_repo_sync(struct xbps_handle *xhp, const char *uri)
 			return rv;
 		}
 	}
-	if (chdir(lrepodir) == -1) {
-		xbps_set_cb_state(xhp, XBPS_STATE_REPOSYNC_FAIL, errno, NULL,
-		    "[reposync] failed to change dir to repodir `%s': %s",
-		    lrepodir, strerror(errno));
-		umask(prev_umask);
-		free(lrepodir);
-		return -1;
-	}
-	free(lrepodir);
 	/*
-	 * Remote repository plist index full URL.
+	 * Remote repository plist index full URL, and where it's stored;
+	 * don't change the working directory, other repositories may
+	 * be synchronized concurrently.
 	 */
 	repodata = xbps_xasprintf("%s/%s-repodata", uri, arch);
+	repofile = xbps_xasprintf("%s/%s-repodata", lrepodir, arch);
+	free(lrepodir);
 
 	/* reposync start cb */
 	xbps_set_cb_state(xhp, XBPS_STATE_REPOSYNC, 0, repodata, NULL);
 	/*
-	 * Download plist index file from repository.
+	 * Try to update the local copy with deltas first, otherwise
+	 * download plist index file from repository.
 	 */
-	if ((rv = xbps_fetch_file(xhp, repodata, NULL)) == -1) {
+	if ((xhp->flags & XBPS_FLAG_REPOS_MEMSYNC) == 0 &&
+	    xbps_repo_sync_delta(xhp, uri, repodata, repofile)) {
+		repo_sync_dict(xhp, repodata, repofile);
+		rv = 0;
+	} else if ((rv = xbps_fetch_file_dest_basename(xhp, repodata, repofile, NULL)) == -1) {
 		/* reposync error cb */
 		fetchstr = xbps_fetch_error_string();
 		xbps_set_cb_state(xhp, XBPS_STATE_REPOSYNC_FAIL,
 		    fetchLastErrCode != 0 ? fetchLastErrCode : errno, NULL,
 		    "[reposync] failed to fetch file `%s': %s",
 		    repodata, fetchstr ? fetchstr : strerror(errno));
-	} else if (rv == 1)
+	} else {
+		if ((xhp->flags & XBPS_FLAG_REPOS_MEMSYNC) == 0) {
+			repo_sync_dict(xhp, repodata, repofile);
+			/*
+			 * Opening the repository regenerates its binary
+			 * index, so that later users don't need to decode
+			 * the archive.  The archive may have the same size
+			 * and mtime (1s resolution) of the previous one,
+			 * so don't trust the old binary index.
+			 */
+			if (rv == 1) {
+				idxfile = xbps_xasprintf("%s.idx", repofile);
+				(void)remove(idxfile);
+				free(idxfile);
+				if ((repo = xbps_repo_open(xhp, uri)) != NULL)
+					xbps_repo_release(repo);
+			}
+		}
 		rv = 0;
+	}
 	umask(prev_umask);
 
 	free(repodata);
+	free(repofile);
 
 	return rv;
 }
@@ -23,6 +23,7 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/stat.h>
 #include <sys/utsname.h>
 #include <stdio.h>
 #include <stdbool.h>
@@ -30,17 +31,42 @@
 #include <libgen.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "xbps_api_impl.h"
+#include "uthash.h"
 
 struct rpool_fpkg {
 	xbps_array_t revdeps;
 	xbps_dictionary_t pkgd;
+	struct xbps_repo_pkg bestpkg;
 	const char *pattern;
 	const char *bestpkgver;
 	bool best;
 };
 
+#ifndef SINGLE_THREADED
+struct rpool_open_thread {
+	pthread_t thread;
+	struct xbps_handle *xhp;
+	const char *uri;
+	struct xbps_repo *repo;
+	bool started;
+};
+#endif
+
+struct rpool_sync {
+	struct xbps_handle *xhp;
+	const char *uri;
+	pthread_mutex_t lock;
+	pthread_mutex_t cb_lock;
+	unsigned int next;
+	void (*fetch_cb)(const struct xbps_fetch_cb_data *, void *);
+	void *fetch_cb_data;
+	int (*state_cb)(const struct xbps_state_cb_data *, void *);
+	void *state_cb_data;
+};
+
 typedef enum {
 	BEST_PKG = 1,
 	VIRTUAL_PKG,
@@ -48,34 +74,190 @@ typedef enum {
 	REVDEPS_PKG
 } pkg_repo_type_t;
 
+/*
+ * Index of all package names in the pool: one entry per name and
+ * repository, entries for the same name are linked in configuration
+ * order so that the first one is what a lookup without best matching
+ * picks.  It's read-only once built, except for the best and key
+ * caches which are protected by rpool_index_mtx.
+ */
+struct rpool_pkg {
+	struct rpool_pkg *rnext;
+	struct xbps_repo *repo;
+	/* best version of this name, set on first use (head only) */
+	struct rpool_pkg *best;
+	char *pkgname;		/* hash key, owned by the repo index */
+	/* version, parsed on first comparison (1: parsed, -1: too long) */
+	struct xbps_pkgver_key key;
+	int keystate;
+	UT_hash_handle hh;
+};
+
+struct rpool_index {
+	struct rpool_pkg *hashtab;
+	struct rpool_pkg *pkgs;
+	unsigned int npkgs;
+	unsigned int nrepos;
+};
+
 static SIMPLEQ_HEAD(rpool_head, xbps_repo) rpool_queue =
     SIMPLEQ_HEAD_INITIALIZER(rpool_queue);
 
+static struct rpool_index *rpool_index;
+/*
+ * Packages may be looked up from several threads, e.g. by the
+ * callbacks of xbps_array_foreach_cb_multi().
+ */
+static pthread_mutex_t rpool_index_mtx = PTHREAD_MUTEX_INITIALIZER;
+
 /**
  * @file lib/rpool.c
  * @brief Repository pool routines
  * @defgroup repopool Repository pool functions
  */
 
+static void
+rpool_sync_repo(struct xbps_handle *xhp, const char *repouri)
+{
+	if (xbps_repo_sync(xhp, repouri) == -1) {
+		xbps_dbg_printf(xhp,
+		    "[rpool] `%s' failed to fetch repository data: %s\n",
+		    repouri, fetchLastErrCode == 0 ? strerror(errno) :
+		    xbps_fetch_error_string());
+	}
+}
+
+#ifndef SINGLE_THREADED
+/*
+ * Callbacks of the frontends are not reentrant, serialize them
+ * while repositories are synchronized concurrently.
+ */
+static void
+rpool_sync_fetch_cb(const struct xbps_fetch_cb_data *xfcd, void *arg)
+{
+	struct rpool_sync *rs = arg;
+
+	pthread_mutex_lock(&rs->cb_lock);
+	(*rs->fetch_cb)(xfcd, rs->fetch_cb_data);
+	pthread_mutex_unlock(&rs->cb_lock);
+}
+
+static int
+rpool_sync_state_cb(const struct xbps_state_cb_data *xscd, void *arg)
+{
+	struct rpool_sync *rs = arg;
+	int rv;
+
+	pthread_mutex_lock(&rs->cb_lock);
+	rv = (*rs->state_cb)(xscd, rs->state_cb_data);
+	pthread_mutex_unlock(&rs->cb_lock);
+	return rv;
+}
+
+static void *
+rpool_sync_thread(void *arg)
+{
+	struct rpool_sync *rs = arg;
+	const char *repouri = NULL;
+	unsigned int i;
+
+	for (;;) {
+		pthread_mutex_lock(&rs->lock);
+		i = rs->next++;
+		pthread_mutex_unlock(&rs->lock);
+		if (!xbps_array_get_cstring_nocopy(rs->xhp->repositories, i, &repouri))
+			break;
+		if (xbps_repository_is_remote(repouri))
+			rpool_sync_repo(rs->xhp, repouri);
+	}
+	return NULL;
+}
+#endif
+
 int
 xbps_rpool_sync(struct xbps_handle *xhp, const char *uri)
 {
 	const char *repouri = NULL;
+	unsigned int njobs, nremote = 0;
 
 	for (unsigned int i = 0; i < xbps_array_count(xhp->repositories); i++) {
 		xbps_array_get_cstring_nocopy(xhp->repositories, i, &repouri);
-		/* If argument was set just process that repository */
-		if (uri && strcmp(repouri, uri))
-			continue;
-
-		if (xbps_repo_sync(xhp, repouri) == -1) {
-			xbps_dbg_printf(xhp,
-			    "[rpool] `%s' failed to fetch repository data: %s\n",
-			    repouri, fetchLastErrCode == 0 ? strerror(errno) :
-			    xbps_fetch_error_string());
-			continue;
+		if (xbps_repository_is_remote(repouri))
+			nremote++;
+	}
+	njobs = xhp->sync_jobs ? xhp->sync_jobs : XBPS_SYNC_JOBS;
+	if (njobs > nremote)
+		njobs = nremote;
+#ifdef SINGLE_THREADED
+	/* proplib was built without locking */
+	njobs = 1;
+#endif
+	if (uri || njobs <= 1) {
+		for (unsigned int i = 0; i < xbps_array_count(xhp->repositories); i++) {
+			xbps_array_get_cstring_nocopy(xhp->repositories, i, &repouri);
+			/* If argument was set just process that repository */
+			if (uri && strcmp(repouri, uri))
+				continue;
+			rpool_sync_repo(xhp, repouri);
+		}
+		return 0;
+	}
+#ifndef SINGLE_THREADED
+	{
+		struct rpool_sync rs;
+		pthread_t *thds;
+		unsigned int nthreads = 0;
+		mode_t prev_umask;
+
+		thds = calloc(njobs, sizeof(*thds));
+		if (thds == NULL)
+			return ENOMEM;
+
+		memset(&rs, 0, sizeof(rs));
+		rs.xhp = xhp;
+		pthread_mutex_init(&rs.lock, NULL);
+		pthread_mutex_init(&rs.cb_lock, NULL);
+		rs.fetch_cb = xhp->fetch_cb;
+		rs.fetch_cb_data = xhp->fetch_cb_data;
+		rs.state_cb = xhp->state_cb;
+		rs.state_cb_data = xhp->state_cb_data;
+		if (xhp->fetch_cb) {
+			xhp->fetch_cb = rpool_sync_fetch_cb;
+			xhp->fetch_cb_data = &rs;
+		}
+		if (xhp->state_cb) {
+			xhp->state_cb = rpool_sync_state_cb;
+			xhp->state_cb_data = &rs;
 		}
+		/*
+		 * The umask is per process, set it once for all
+		 * threads rather than in each xbps_repo_sync() call.
+		 */
+		prev_umask = umask(022);
+
+		xbps_dbg_printf(xhp, "[rpool] syncing %u remote repositories, "
+		    "%u at a time\n", nremote, njobs);
+		for (unsigned int i = 0; i < njobs; i++) {
+			if (pthread_create(&thds[i], NULL, rpool_sync_thread, &rs) != 0)
+				break;
+			nthreads++;
+		}
+		/* couldn't create any thread, do it ourselves */
+		if (nthreads == 0)
+			rpool_sync_thread(&rs);
+		for (unsigned int i = 0; i < nthreads; i++)
+			pthread_join(thds[i], NULL);
+
+		umask(prev_umask);
+		xhp->fetch_cb = rs.fetch_cb;
+		xhp->fetch_cb_data = rs.fetch_cb_data;
+		xhp->state_cb = rs.state_cb;
+		xhp->state_cb_data = rs.state_cb_data;
+		pthread_mutex_destroy(&rs.lock);
+		pthread_mutex_destroy(&rs.cb_lock);
+		free(thds);
 	}
+#endif
 	return 0;
 }
 
@@ -119,11 +301,27 @@ xbps_rpool_get_repo(const char *url)
 	return NULL;
 }
 
+static void
+rpool_index_release(void)
+{
+	if (rpool_index == NULL)
+		return;
+
+	HASH_CLEAR(hh, rpool_index->hashtab);
+	free(rpool_index->pkgs);
+	free(rpool_index);
+	rpool_index = NULL;
+}
+
 void
 xbps_rpool_release(struct xbps_handle *xhp)
 {
 	struct xbps_repo *repo;
 
+	pthread_mutex_lock(&rpool_index_mtx);
+	rpool_index_release();
+	pthread_mutex_unlock(&rpool_index_mtx);
+
 	while ((repo = SIMPLEQ_FIRST(&rpool_queue))) {
 	       SIMPLEQ_REMOVE(&rpool_queue, repo, xbps_repo, entries);
 	       xbps_repo_release(repo);
@@ -134,6 +332,94 @@ xbps_rpool_release(struct xbps_handle *xhp)
 	}
 }
 
+#ifndef SINGLE_THREADED
+static void *
+rpool_open_thread(void *arg)
+{
+	struct rpool_open_thread *rot = arg;
+
+	rot->repo = xbps_repo_open(rot->xhp, rot->uri);
+	return NULL;
+}
+#endif
+
+/*
+ * Opens all registered repositories that are not in the pool yet,
+ * one thread per repository, so that decompressing and internalizing
+ * the indexes of N repositories takes about as long as the largest one.
+ * Repositories are added to the pool in configuration order, those that
+ * cannot be opened are removed like xbps_rpool_foreach() does.
+ */
+static void
+rpool_open_parallel(struct xbps_handle *xhp)
+{
+#ifdef SINGLE_THREADED
+	/* proplib was built without locking */
+	(void)xhp;
+#else
+	struct rpool_open_thread *thd;
+	const char *repouri = NULL;
+	unsigned int count, nthreads = 0;
+	int rv;
+
+	count = xbps_array_count(xhp->repositories);
+	if (count < 2)
+		return;
+
+	thd = calloc(count, sizeof(*thd));
+	if (thd == NULL)
+		return;
+
+	for (unsigned int i = 0; i < count; i++) {
+		xbps_array_get_cstring_nocopy(xhp->repositories, i, &repouri);
+		if (xbps_rpool_get_repo(repouri) != NULL)
+			continue;
+		/*
+		 * In memory repos are fetched and may need to import
+		 * their public key, leave them to xbps_rpool_foreach().
+		 */
+		if ((xhp->flags & XBPS_FLAG_REPOS_MEMSYNC) &&
+		    xbps_repository_is_remote(repouri))
+			continue;
+		thd[i].xhp = xhp;
+		thd[i].uri = repouri;
+		rv = pthread_create(&thd[i].thread, NULL, rpool_open_thread, &thd[i]);
+		if (rv != 0) {
+			xbps_dbg_printf(xhp, "[rpool] `%s' failed to create "
+			    "thread: %s\n", repouri, strerror(rv));
+			continue;
+		}
+		thd[i].started = true;
+		nthreads++;
+	}
+	if (nthreads == 0) {
+		free(thd);
+		return;
+	}
+	xbps_dbg_printf(xhp, "[rpool] opening %u repositories in parallel\n",
+	    nthreads);
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (!thd[i].started)
+			continue;
+		pthread_join(thd[i].thread, NULL);
+		if (thd[i].repo == NULL)
+			continue;
+		SIMPLEQ_INSERT_TAIL(&rpool_queue, thd[i].repo, entries);
+		xbps_dbg_printf(xhp, "[rpool] `%s' registered.\n", thd[i].uri);
+	}
+	/*
+	 * Removing a repository frees its uri, do it once all
+	 * threads are done with them.
+	 */
+	for (unsigned int i = 0; i < count; i++) {
+		if (thd[i].started && thd[i].repo == NULL)
+			xbps_repo_remove(xhp, thd[i].uri);
+	}
+	free(thd);
+#endif
+}
+
 int
 xbps_rpool_foreach(struct xbps_handle *xhp,
 	int (*fn)(struct xbps_repo *, void *, bool *),
@@ -147,6 +433,7 @@ xbps_rpool_foreach(struct xbps_handle *xhp,
 
 	assert(fn != NULL);
 
+	rpool_open_parallel(xhp);
 again:
 	for (unsigned int i = n; i < xbps_array_count(xhp->repositories); i++, n++) {
 		xbps_array_get_cstring_nocopy(xhp->repositories, i, &repouri);
@@ -226,11 +513,10 @@ static int
 find_best_pkg_cb(struct xbps_repo *repo, void *arg, bool *done UNUSED)
 {
 	struct rpool_fpkg *rpf = arg;
-	xbps_dictionary_t pkgd;
-	const char *repopkgver = NULL;
+	struct xbps_repo_pkg rpkg;
 
-	pkgd = xbps_repo_get_pkg(repo, rpf->pattern);
-	if (pkgd == NULL) {
+	/* candidates are only looked at, the best one is returned */
+	if (!xbps_repo_lookup_pkg(repo, rpf->pattern, &rpkg)) {
 		if (errno && errno != ENOENT)
 			return errno;
 
@@ -239,30 +525,210 @@ find_best_pkg_cb(struct xbps_repo *repo, void *arg, bool *done UNUSED)
 		    "'%s'.\n", rpf->pattern, repo->uri);
 		return 0;
 	}
-	xbps_dictionary_get_cstring_nocopy(pkgd,
-	    "pkgver", &repopkgver);
 	if (rpf->bestpkgver == NULL) {
 		xbps_dbg_printf(repo->xhp,
 		    "[rpool] Found match '%s' (%s).\n",
-		    repopkgver, repo->uri);
-		rpf->pkgd = pkgd;
-		rpf->bestpkgver = repopkgver;
+		    rpkg.pkgver, repo->uri);
+		rpf->bestpkg = rpkg;
+		rpf->bestpkgver = rpkg.pkgver;
 		return 0;
 	}
 	/*
 	 * Compare current stored version against new
 	 * version from current package in repository.
 	 */
-	if (xbps_cmpver(repopkgver, rpf->bestpkgver) == 1) {
+	if (xbps_cmpver(rpkg.pkgver, rpf->bestpkgver) == 1) {
 		xbps_dbg_printf(repo->xhp,
 		    "[rpool] Found best match '%s' (%s).\n",
-		    repopkgver, repo->uri);
-		rpf->pkgd = pkgd;
-		rpf->bestpkgver = repopkgver;
+		    rpkg.pkgver, repo->uri);
+		rpf->bestpkg = rpkg;
+		rpf->bestpkgver = rpkg.pkgver;
 	}
 	return 0;
 }
 
+static int
+rpool_index_add_cb(struct xbps_repo *repo, void *arg, bool *done UNUSED)
+{
+	struct rpool_index *ri = arg;
+	struct rpool_pkg *rp, *head;
+	xbps_object_iterator_t iter;
+	xbps_object_t keysym;
+
+	ri->nrepos++;
+	if (repo->idx == NULL)
+		return 0;
+
+	iter = xbps_dictionary_iterator(repo->idx);
+	if (iter == NULL)
+		return ENOMEM;
+
+	while ((keysym = xbps_object_iterator_next(iter))) {
+		rp = &ri->pkgs[ri->npkgs++];
+		rp->repo = repo;
+		rp->pkgname = __UNCONST(xbps_dictionary_keysym_cstring_nocopy(keysym));
+		HASH_FIND_STR(ri->hashtab, rp->pkgname, head);
+		if (head != NULL) {
+			while (head->rnext)
+				head = head->rnext;
+			head->rnext = rp;
+			continue;
+		}
+		HASH_ADD_KEYPTR(hh, ri->hashtab, rp->pkgname,
+		    strlen(rp->pkgname), rp);
+	}
+	xbps_object_iterator_release(iter);
+	return 0;
+}
+
+static int
+rpool_count_cb(struct xbps_repo *repo, void *arg, bool *done UNUSED)
+{
+	unsigned int *count = arg;
+
+	*count += xbps_dictionary_count(repo->idx);
+	return 0;
+}
+
+/*
+ * Builds the index of package names in the pool after opening all
+ * repositories. Only keys are walked, package dictionaries of lazily
+ * internalized indexes stay untouched.
+ */
+static struct rpool_index *
+rpool_index_build(struct xbps_handle *xhp)
+{
+	struct rpool_index *ri;
+	unsigned int count = 0;
+	int rv;
+
+	if ((rv = xbps_rpool_foreach(xhp, rpool_count_cb, &count)) != 0) {
+		errno = rv;
+		return NULL;
+	}
+	ri = calloc(1, sizeof(*ri));
+	if (ri == NULL)
+		return NULL;
+	ri->pkgs = calloc(count ? count : 1, sizeof(*ri->pkgs));
+	if (ri->pkgs == NULL ||
+	    xbps_rpool_foreach(xhp, rpool_index_add_cb, ri) != 0 ||
+	    ri->nrepos != xbps_array_count(xhp->repositories)) {
+		HASH_CLEAR(hh, ri->hashtab);
+		free(ri->pkgs);
+		free(ri);
+		return NULL;
+	}
+	xbps_dbg_printf(xhp, "[rpool] indexed %u packages from %u "
+	    "repositories\n", ri->npkgs, ri->nrepos);
+	return ri;
+}
+
+/*
+ * Returns the index of package names in the pool, building it the
+ * first time. Concurrent callers wait for it to be built.
+ */
+static struct rpool_index *
+rpool_index_get_or_build(struct xbps_handle *xhp)
+{
+	struct rpool_index *ri;
+
+	pthread_mutex_lock(&rpool_index_mtx);
+	/* repositories were added or removed since it was built */
+	if (rpool_index != NULL &&
+	    rpool_index->nrepos != xbps_array_count(xhp->repositories))
+		rpool_index_release();
+	if (rpool_index == NULL)
+		rpool_index = rpool_index_build(xhp);
+	ri = rpool_index;
+	pthread_mutex_unlock(&rpool_index_mtx);
+	return ri;
+}
+
+static bool
+rpool_pkg_key(struct rpool_pkg *rp, const char *pkgver)
+{
+	bool rv;
+
+	/* the key is never modified once parsed */
+	pthread_mutex_lock(&rpool_index_mtx);
+	if (rp->keystate == 0)
+		rp->keystate = xbps_pkgver_key(&rp->key, pkgver) ? 1 : -1;
+	rv = rp->keystate == 1;
+	pthread_mutex_unlock(&rpool_index_mtx);
+	return rv;
+}
+
+/*
+ * Compares package versions of two entries, their keys are cached
+ * because the package of a name in a repository is always the same.
+ */
+static int
+rpool_pkg_cmpver(struct rpool_pkg *rp1, const char *pkgver1,
+		struct rpool_pkg *rp2, const char *pkgver2)
+{
+	if (rpool_pkg_key(rp1, pkgver1) && rpool_pkg_key(rp2, pkgver2))
+		return xbps_pkgver_key_cmp(&rp1->key, &rp2->key);
+	return xbps_cmpver(pkgver1, pkgver2);
+}
+
+static xbps_dictionary_t
+rpool_index_find_pkg(struct xbps_handle *xhp, struct rpool_index *ri,
+		const char *pkg, bool bestmatch)
+{
+	struct rpool_pkg *head, *rp, *bestrp = NULL, *best;
+	struct xbps_repo_pkg rpkg, bestpkg;
+	const char *bestpkgver = NULL;
+	char pkgname[XBPS_NAME_SIZE];
+	bool byname = false;
+
+	if (!xbps_pkgpattern_name(pkgname, sizeof(pkgname), pkg) &&
+	    !xbps_pkg_name(pkgname, sizeof(pkgname), pkg)) {
+		if (xbps_strlcpy(pkgname, pkg, sizeof(pkgname)) >= sizeof(pkgname)) {
+			errno = ENOENT;
+			return NULL;
+		}
+		byname = true;
+	}
+	HASH_FIND_STR(ri->hashtab, pkgname, head);
+	if (head == NULL) {
+		errno = ENOENT;
+		return NULL;
+	}
+	if (bestmatch && byname) {
+		pthread_mutex_lock(&rpool_index_mtx);
+		best = head->best;
+		pthread_mutex_unlock(&rpool_index_mtx);
+		if (best != NULL)
+			return xbps_repo_get_pkg(best->repo, pkg);
+	}
+
+	for (rp = head; rp; rp = rp->rnext) {
+		if (!xbps_repo_lookup_pkg(rp->repo, pkg, &rpkg))
+			continue;
+		if (!bestmatch)
+			return xbps_repo_pkg_dictionary(&rpkg);
+
+		if (bestpkgver == NULL ||
+		    rpool_pkg_cmpver(rp, rpkg.pkgver, bestrp, bestpkgver) == 1) {
+			xbps_dbg_printf(xhp, "[rpool] Found best match '%s' "
+			    "(%s).\n", rpkg.pkgver, rp->repo->uri);
+			bestpkg = rpkg;
+			bestpkgver = rpkg.pkgver;
+			bestrp = rp;
+		}
+	}
+	if (bestpkgver == NULL) {
+		errno = ENOENT;
+		return NULL;
+	}
+	if (byname) {
+		pthread_mutex_lock(&rpool_index_mtx);
+		head->best = bestrp;
+		pthread_mutex_unlock(&rpool_index_mtx);
+	}
+	return xbps_repo_pkg_dictionary(&bestpkg);
+}
+
 static xbps_object_t
 repo_find_pkg(struct xbps_handle *xhp,
 	      const char *pkg,
@@ -279,6 +745,20 @@ repo_find_pkg(struct xbps_handle *xhp,
 	rpf.revdeps = NULL;
 	rpf.bestpkgver = NULL;
 
+	/*
+	 * Real packages are looked up in the pool index, unless a
+	 * virtual package from configuration files may replace it.
+	 */
+	if ((type == BEST_PKG || type == REAL_PKG) &&
+	    vpkg_user_conf(xhp, pkg, true) == NULL) {
+		struct rpool_index *ri;
+
+		if ((ri = rpool_index_get_or_build(xhp)) != NULL)
+			return rpool_index_find_pkg(xhp, ri, pkg, type == BEST_PKG);
+		if (errno == ENOTSUP)
+			return NULL;
+	}
+
 	switch (type) {
 	case BEST_PKG:
 		/*
@@ -314,6 +794,8 @@ repo_find_pkg(struct xbps_handle *xhp,
 			errno = ENOENT;
 
 		return rpf.revdeps;
+	} else if (type == BEST_PKG && rpf.bestpkgver != NULL) {
+		rpf.pkgd = xbps_repo_pkg_dictionary(&rpf.bestpkg);
 	} else {
 		if (rpf.pkgd == NULL)
 			errno = ENOENT;
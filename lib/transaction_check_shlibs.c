@@ -60,25 +60,56 @@ shlib_register(xbps_dictionary_t d, const char *shlib, const char *pkgver)
 		xbps_object_release(array);
 }
 
+static void
+collect_pkg_shlibs(struct xbps_handle *xhp, xbps_dictionary_t d,
+		xbps_dictionary_t pkgd, bool req)
+{
+	xbps_array_t shobjs;
+	const char *pkgver = NULL;
+
+	if (xbps_transaction_pkg_type(pkgd) == XBPS_TRANS_REMOVE)
+		return;
+	/*
+	 * If pkg does not have the required obj, pass to next one.
+	 */
+	xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &pkgver);
+	shobjs = xbps_dictionary_get(pkgd,
+			req ? "shlib-requires" : "shlib-provides");
+	if (shobjs == NULL)
+		return;
+
+	for (unsigned int i = 0; i < xbps_array_count(shobjs); i++) {
+		const char *shlib = NULL;
+
+		xbps_array_get_cstring_nocopy(shobjs, i, &shlib);
+		xbps_dbg_printf(xhp, "%s: registering %s for %s\n",
+		    pkgver, shlib, req ? "shlib-requires" : "shlib-provides");
+		if (req)
+			shlib_register(d, shlib, pkgver);
+		else
+			xbps_dictionary_set_cstring_nocopy(d, shlib, pkgver);
+	}
+}
+
 static xbps_dictionary_t
 collect_shlibs(struct xbps_handle *xhp, xbps_array_t pkgs, bool req)
 {
-	xbps_object_t obj;
-	xbps_object_iterator_t iter;
-	xbps_dictionary_t d, pd;
-	const char *pkgname, *pkgver;
+	xbps_object_t obj, k1, k2;
+	xbps_object_iterator_t iter, titer;
+	xbps_dictionary_t d, tpkgs;
+	const char *pkgname;
+	int cmp;
 
 	d = xbps_dictionary_create();
 	assert(d);
 
-	/* copy pkgdb to out temporary dictionary */
-	pd = xbps_dictionary_copy(xhp->pkgdb);
-	assert(pd);
-
 	/*
-	 * copy pkgs from transaction to our dictionary, overriding them
-	 * if they were there from pkgdb.
+	 * Packages from transaction override the ones in pkgdb; collect
+	 * them by name instead of copying and modifying the whole pkgdb.
 	 */
+	tpkgs = xbps_dictionary_create();
+	assert(tpkgs);
+
 	iter = xbps_array_iterator(pkgs);
 	assert(iter);
 	while ((obj = xbps_object_iterator_next(iter))) {
@@ -90,95 +121,234 @@ collect_shlibs(struct xbps_handle *xhp, xbps_array_t pkgs, bool req)
 			continue;
 		}
 
-		xbps_dictionary_set(pd, pkgname, obj);
+		xbps_dictionary_set(tpkgs, pkgname, obj);
 	}
 	xbps_object_iterator_release(iter);
 
 	/*
-	 * iterate over our dictionary to collect shlib-{requires,provides}.
+	 * Walk pkgdb and transaction packages at once, both sorted by
+	 * name, to collect shlib-{requires,provides} in the same order
+	 * as if they had been merged.
 	 */
-	iter = xbps_dictionary_iterator(pd);
+	iter = xbps_dictionary_iterator(xhp->pkgdb);
 	assert(iter);
+	titer = xbps_dictionary_iterator(tpkgs);
+	assert(titer);
 
-	while ((obj = xbps_object_iterator_next(iter))) {
-		xbps_array_t shobjs;
-		xbps_dictionary_t pkgd;
-
-		pkgd = xbps_dictionary_get_keysym(pd, obj);
-		if (xbps_transaction_pkg_type(pkgd) == XBPS_TRANS_REMOVE) {
+	k1 = xbps_object_iterator_next(iter);
+	k2 = xbps_object_iterator_next(titer);
+	while (k1 != NULL || k2 != NULL) {
+		if (k1 == NULL)
+			cmp = 1;
+		else if (k2 == NULL)
+			cmp = -1;
+		else
+			cmp = strcmp(xbps_dictionary_keysym_cstring_nocopy(k1),
+			    xbps_dictionary_keysym_cstring_nocopy(k2));
+		if (cmp < 0) {
+			collect_pkg_shlibs(xhp, d,
+			    xbps_dictionary_get_keysym(xhp->pkgdb, k1), req);
+			k1 = xbps_object_iterator_next(iter);
 			continue;
 		}
-		/*
-		 * If pkg does not have the required obj, pass to next one.
-		 */
-		xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &pkgver);
-		shobjs = xbps_dictionary_get(pkgd,
-				req ? "shlib-requires" : "shlib-provides");
-		if (shobjs == NULL)
-			continue;
+		if (cmp == 0)
+			k1 = xbps_object_iterator_next(iter);
+		collect_pkg_shlibs(xhp, d,
+		    xbps_dictionary_get_keysym(tpkgs, k2), req);
+		k2 = xbps_object_iterator_next(titer);
+	}
+	xbps_object_iterator_release(iter);
+	xbps_object_iterator_release(titer);
+	xbps_object_release(tpkgs);
+	return d;
+}
+
+/*
+ * Only shlibs required by packages in the transaction and shlibs no
+ * longer provided by packages in the transaction are checked.
+ * Their providers are looked up first in the shlib providers index of
+ * the registered repositories, then in the transaction; pkgdb is only
+ * walked if they are not found there.
+ */
+struct shlib_check {
+	struct xbps_handle *xhp;
+	xbps_array_t pkgs;
+	xbps_dictionary_t tpkgs;
+	xbps_dictionary_t tprovides;
+	xbps_dictionary_t provides;
+	xbps_dictionary_t requires;
+	xbps_dictionary_t checked;
+};
 
-		for (unsigned int i = 0; i < xbps_array_count(shobjs); i++) {
-			const char *shlib = NULL;
+static xbps_dictionary_t
+shlib_pkg_get(struct shlib_check *sc, const char *pkgname)
+{
+	xbps_dictionary_t pkgd;
+
+	if ((pkgd = xbps_dictionary_get(sc->tpkgs, pkgname)) != NULL) {
+		if (xbps_transaction_pkg_type(pkgd) == XBPS_TRANS_REMOVE)
+			return NULL;
+		return pkgd;
+	}
+	return xbps_dictionary_get(sc->xhp->pkgdb, pkgname);
+}
 
-			xbps_array_get_cstring_nocopy(shobjs, i, &shlib);
-			xbps_dbg_printf(xhp, "%s: registering %s for %s\n",
-			    pkgver, shlib, req ? "shlib-requires" : "shlib-provides");
-			if (req)
-				shlib_register(d, shlib, pkgver);
-			else
-				xbps_dictionary_set_cstring_nocopy(d, shlib, pkgver);
+static bool
+shlib_provided_by_repos(struct shlib_check *sc, const char *shlib)
+{
+	struct xbps_repo *repo;
+	xbps_array_t providers, provides;
+	xbps_dictionary_t pkgd;
+	const char *repouri = NULL, *pkgname = NULL;
+
+	for (unsigned int i = 0; i < xbps_array_count(sc->xhp->repositories); i++) {
+		xbps_array_get_cstring_nocopy(sc->xhp->repositories, i, &repouri);
+		if ((repo = xbps_rpool_get_repo(repouri)) == NULL)
+			continue;
+		providers = xbps_repo_get_shlib_providers(repo, shlib);
+		for (unsigned int j = 0; j < xbps_array_count(providers); j++) {
+			xbps_array_get_cstring_nocopy(providers, j, &pkgname);
+			pkgd = shlib_pkg_get(sc, pkgname);
+			provides = xbps_dictionary_get(pkgd, "shlib-provides");
+			if (provides != NULL &&
+			    xbps_match_string_in_array(provides, shlib))
+				return true;
 		}
 	}
-	xbps_object_iterator_release(iter);
-	xbps_object_release(pd);
-	return d;
+	return false;
+}
+
+static bool
+shlib_provided(struct shlib_check *sc, const char *shlib)
+{
+	xbps_object_t obj;
+	bool found;
+
+	if ((obj = xbps_dictionary_get(sc->checked, shlib)) != NULL)
+		return xbps_bool_true(obj);
+
+	found = shlib_provided_by_repos(sc, shlib) ||
+		xbps_dictionary_get(sc->tprovides, shlib) != NULL;
+	if (!found) {
+		if (sc->provides == NULL)
+			sc->provides = collect_shlibs(sc->xhp, sc->pkgs, false);
+		found = xbps_dictionary_get(sc->provides, shlib) != NULL;
+	}
+	xbps_dictionary_set_bool(sc->checked, shlib, found);
+	return found;
+}
+
+static void
+shlib_broken(struct shlib_check *sc, const char *pkgver, const char *shlib)
+{
+	xbps_array_t mshlibs;
+	char *buf;
+
+	mshlibs = xbps_dictionary_get(sc->xhp->transd, "missing_shlibs");
+	buf = xbps_xasprintf("%s: broken, unresolvable shlib `%s'",
+	    pkgver, shlib);
+	if (!xbps_match_string_in_array(mshlibs, buf))
+		xbps_array_add_cstring(mshlibs, buf);
+	free(buf);
 }
 
 bool HIDDEN
 xbps_transaction_check_shlibs(struct xbps_handle *xhp, xbps_array_t pkgs)
 {
-	xbps_array_t array, mshlibs;
-	xbps_object_t obj, obj2;
+	struct shlib_check sc = { .xhp = xhp, .pkgs = pkgs };
+	xbps_array_t array, provides;
+	xbps_object_t obj;
 	xbps_object_iterator_t iter;
-	xbps_dictionary_t shrequires, shprovides;
-	const char *pkgver = NULL, *shlib = NULL;
-	char *buf;
-	bool broken = false;
+	xbps_dictionary_t pkgd, opkgd;
+	const char *pkgname = NULL, *pkgver = NULL, *shlib = NULL;
+	bool broken = false, removed;
 
-	shrequires = collect_shlibs(xhp, pkgs, true);
-	shprovides = collect_shlibs(xhp, pkgs, false);
+	sc.tpkgs = xbps_dictionary_create();
+	sc.tprovides = xbps_dictionary_create();
+	sc.checked = xbps_dictionary_create();
+	assert(sc.tpkgs);
+	assert(sc.tprovides);
+	assert(sc.checked);
 
-	mshlibs = xbps_dictionary_get(xhp->transd, "missing_shlibs");
-	/* iterate over shlib-requires to find unmatched shlibs */
-	iter = xbps_dictionary_iterator(shrequires);
+	iter = xbps_array_iterator(pkgs);
 	assert(iter);
-
 	while ((obj = xbps_object_iterator_next(iter))) {
-		shlib = xbps_dictionary_keysym_cstring_nocopy(obj);
-		xbps_dbg_printf(xhp, "%s: checking for `%s': ", __func__, shlib);
-		if ((obj2 = xbps_dictionary_get(shprovides, shlib))) {
-			xbps_dbg_printf_append(xhp, "provided by `%s'\n",
-			    xbps_string_cstring_nocopy(obj2));
+		if (!xbps_dictionary_get_cstring_nocopy(obj, "pkgname", &pkgname))
 			continue;
-		}
-		xbps_dbg_printf_append(xhp, "not found\n");
+		/* ignore shlibs if pkg is on hold mode */
+		if (xbps_transaction_pkg_type(obj) == XBPS_TRANS_HOLD)
+			continue;
+		xbps_dictionary_set(sc.tpkgs, pkgname, obj);
+		collect_pkg_shlibs(xhp, sc.tprovides, obj, false);
+	}
+	xbps_object_iterator_release(iter);
 
-		broken = true;
-		array = xbps_dictionary_get_keysym(shrequires, obj);
+	iter = xbps_dictionary_iterator(sc.tpkgs);
+	assert(iter);
+	while ((obj = xbps_object_iterator_next(iter))) {
+		pkgd = xbps_dictionary_get_keysym(sc.tpkgs, obj);
+		pkgname = xbps_dictionary_keysym_cstring_nocopy(obj);
+		removed = xbps_transaction_pkg_type(pkgd) == XBPS_TRANS_REMOVE;
+		/*
+		 * shlibs required by the package.
+		 */
+		array = removed ? NULL :
+		    xbps_dictionary_get(pkgd, "shlib-requires");
+		xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &pkgver);
 		for (unsigned int i = 0; i < xbps_array_count(array); i++) {
-			xbps_array_get_cstring_nocopy(array, i, &pkgver);
-			buf = xbps_xasprintf("%s: broken, unresolvable "
-			    "shlib `%s'", pkgver, shlib);
-			xbps_array_add_cstring(mshlibs, buf);
-			free(buf);
+			xbps_array_get_cstring_nocopy(array, i, &shlib);
+			xbps_dbg_printf(xhp, "%s: checking for `%s': ",
+			    __func__, shlib);
+			if (shlib_provided(&sc, shlib)) {
+				xbps_dbg_printf_append(xhp, "found\n");
+				continue;
+			}
+			xbps_dbg_printf_append(xhp, "not found\n");
+			broken = true;
+			shlib_broken(&sc, pkgver, shlib);
+		}
+		/*
+		 * shlibs provided by the installed package but not by the
+		 * package in the transaction are now required from others.
+		 */
+		if ((opkgd = xbps_dictionary_get(xhp->pkgdb, pkgname)) == NULL)
+			continue;
+		array = xbps_dictionary_get(opkgd, "shlib-provides");
+		provides = removed ? NULL :
+		    xbps_dictionary_get(pkgd, "shlib-provides");
+		for (unsigned int i = 0; i < xbps_array_count(array); i++) {
+			xbps_array_t users;
+
+			xbps_array_get_cstring_nocopy(array, i, &shlib);
+			if (provides != NULL &&
+			    xbps_match_string_in_array(provides, shlib))
+				continue;
+			if (shlib_provided(&sc, shlib))
+				continue;
+			xbps_dbg_printf(xhp, "%s: `%s' is no longer provided\n",
+			    __func__, shlib);
+			if (sc.requires == NULL)
+				sc.requires = collect_shlibs(xhp, pkgs, true);
+			users = xbps_dictionary_get(sc.requires, shlib);
+			for (unsigned int j = 0; j < xbps_array_count(users); j++) {
+				xbps_array_get_cstring_nocopy(users, j, &pkgver);
+				broken = true;
+				shlib_broken(&sc, pkgver, shlib);
+			}
 		}
 	}
 	xbps_object_iterator_release(iter);
+
 	if (!broken) {
 		xbps_dictionary_remove(xhp->transd, "missing_shlibs");
 	}
-	xbps_object_release(shprovides);
-	xbps_object_release(shrequires);
+	if (sc.provides != NULL)
+		xbps_object_release(sc.provides);
+	if (sc.requires != NULL)
+		xbps_object_release(sc.requires);
+	xbps_object_release(sc.checked);
+	xbps_object_release(sc.tprovides);
+	xbps_object_release(sc.tpkgs);
 
 	return true;
 }
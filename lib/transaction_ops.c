@@ -29,6 +29,7 @@
 #include <string.h>
 #include <errno.h>
 #include <fnmatch.h>
+#include <unistd.h>
 
 #include "xbps_api_impl.h"
 
@@ -291,6 +292,80 @@ xbps_autoupdate(struct xbps_handle *xhp)
 	return 0;
 }
 
+/*
+ * Returns true if the binary indexes of all repositories show that no
+ * installed package can be updated, without opening the repositories.
+ * Anything that can't be decided by comparing versions returns false,
+ * so that the slow path decides.
+ */
+static bool
+trans_uptodate(struct xbps_handle *xhp)
+{
+	struct xbps_repo_binidx **bis;
+	xbps_object_iterator_t iter;
+	xbps_object_t obj;
+	xbps_dictionary_t pkgd;
+	const char *url = NULL, *pkgver, *repopkgver;
+	char *repofile, pkgname[XBPS_NAME_SIZE];
+	unsigned int i, nrepos;
+	bool reverts, rv = false;
+
+	if (xhp->flags & (XBPS_FLAG_DOWNLOAD_ONLY|XBPS_FLAG_REPOS_MEMSYNC))
+		return false;
+	if ((nrepos = xbps_array_count(xhp->repositories)) == 0)
+		return false;
+	if (xbps_pkgdb_init(xhp) != 0)
+		return false;
+	if ((bis = calloc(nrepos, sizeof(*bis))) == NULL)
+		return false;
+
+	for (i = 0; i < nrepos; i++) {
+		xbps_array_get_cstring_nocopy(xhp->repositories, i, &url);
+		/* staged packages are merged into the index */
+		if ((repofile = xbps_repo_file(xhp, url, "stagedata")) == NULL)
+			goto out;
+		if (access(repofile, F_OK) == 0) {
+			free(repofile);
+			goto out;
+		}
+		free(repofile);
+		if ((repofile = xbps_repo_file(xhp, url, "repodata")) == NULL)
+			goto out;
+		bis[i] = xbps_repo_binidx_map(xhp, repofile);
+		free(repofile);
+		if (bis[i] == NULL)
+			goto out;
+	}
+
+	iter = xbps_dictionary_iterator(xhp->pkgdb);
+	assert(iter);
+	while ((obj = xbps_object_iterator_next(iter))) {
+		pkgd = xbps_dictionary_get_keysym(xhp->pkgdb, obj);
+		if (!xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &pkgver))
+			continue;
+		if (!xbps_pkg_name(pkgname, sizeof(pkgname), pkgver) ||
+		    vpkg_user_conf(xhp, pkgname, true) != NULL)
+			break;
+		for (i = 0; i < nrepos; i++) {
+			repopkgver = xbps_repo_binidx_get_pkgver(bis[i],
+			    pkgname, &reverts);
+			if (repopkgver == NULL)
+				continue;
+			if (reverts || xbps_cmpver(repopkgver, pkgver) > 0)
+				break;
+		}
+		if (i < nrepos)
+			break;
+	}
+	xbps_object_iterator_release(iter);
+	rv = obj == NULL;
+out:
+	for (i = 0; i < nrepos; i++)
+		xbps_repo_binidx_unmap(bis[i]);
+	free(bis);
+	return rv;
+}
+
 int
 xbps_transaction_update_packages(struct xbps_handle *xhp)
 {
@@ -300,6 +375,11 @@ xbps_transaction_update_packages(struct xbps_handle *xhp)
 	bool newpkg_found = false;
 	int rv = 0;
 
+	if (trans_uptodate(xhp)) {
+		xbps_dbg_printf(xhp, "%s: all packages are up to date\n",
+		    __func__);
+		return EEXIST;
+	}
 	rv = xbps_autoupdate(xhp);
 	switch (rv) {
 	case 1:
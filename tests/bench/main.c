@@ -0,0 +1,488 @@
+/*-
+ * Copyright (c) 2026 agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-
+ */
+
+/*
+ * proplib microbenchmarks over synthetic repodata and pkgdb plists.
+ *
+ * Every benchmark runs in its own child process so that the peak RSS
+ * reported for it is not polluted by the previous ones. Results are
+ * printed to stdout as one JSON object per line; an op of the lookup
+ * and iterate benchmarks is a full pass over all packages.
+ */
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+
+#include <xbps.h>
+
+#define MAX_SIZES	16
+
+enum kind {
+	KIND_REPODATA,
+	KIND_PKGDB
+};
+
+struct bench_ctx {
+	enum kind kind;
+	unsigned int npkgs;
+	xbps_dictionary_t dict;
+	char *plist;
+	size_t plistlen;
+	char **keys;
+};
+
+struct bench {
+	const char *name;
+	/* bytes processed per op are reported if set */
+	bool throughput;
+	void (*run)(struct bench_ctx *);
+};
+
+static const char *kindnames[] = { "repodata", "pkgdb" };
+static double mintime = 1.0;
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long
+maxrss(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+}
+
+static void
+set_cstring(xbps_dictionary_t d, const char *key, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+static void
+set_cstring(xbps_dictionary_t d, const char *key, const char *fmt, ...)
+{
+	va_list ap;
+	char buf[256];
+
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (!xbps_dictionary_set_cstring(d, key, buf))
+		abort();
+}
+
+static xbps_array_t
+make_deps(unsigned int i, unsigned int n, const char *pfx, const char *sfx)
+{
+	xbps_array_t a;
+	char buf[64];
+
+	a = xbps_array_create();
+	assert(a);
+	for (unsigned int j = 1; j <= n; j++) {
+		snprintf(buf, sizeof(buf), "%s%05u%s", pfx,
+		    (i * 7 + j * 13) % (i + 1), sfx);
+		xbps_array_add_cstring(a, buf);
+	}
+	return a;
+}
+
+/*
+ * Builds a dictionary resembling a repository index or a pkgdb,
+ * keyed by pkgname with one package dictionary per entry.
+ */
+static xbps_dictionary_t
+generate(enum kind kind, unsigned int npkgs)
+{
+	xbps_dictionary_t d, pkgd;
+	xbps_array_t a;
+	char pkgname[32];
+
+	d = xbps_dictionary_create_with_capacity(npkgs);
+	assert(d);
+	for (unsigned int i = 0; i < npkgs; i++) {
+		snprintf(pkgname, sizeof(pkgname), "pkg-%05u", i);
+		pkgd = xbps_dictionary_create();
+		assert(pkgd);
+		set_cstring(pkgd, "architecture", "x86_64");
+		set_cstring(pkgd, "pkgver", "%s-%u.%u.%u_%u", pkgname,
+		    i % 7, i % 13, i % 31, 1 + i % 3);
+		set_cstring(pkgd, "short_desc",
+		    "Synthetic package number %u used for benchmarks", i);
+		set_cstring(pkgd, "homepage", "https://example.org/%s", pkgname);
+		set_cstring(pkgd, "license", i % 2 ? "GPL-2.0-or-later" : "MIT");
+		set_cstring(pkgd, "maintainer",
+		    "Maintainer %u <maint%u@example.org>", i % 97, i % 97);
+		xbps_dictionary_set_uint64(pkgd, "installed_size",
+		    (uint64_t)i * 4096 + 123);
+		a = make_deps(i, i % 6, "pkg-", ">=0");
+		xbps_dictionary_set(pkgd, "run_depends", a);
+		xbps_object_release(a);
+		if (i % 4 == 0) {
+			a = make_deps(i, 1, "libpkg", ".so.1");
+			xbps_dictionary_set(pkgd, "shlib-provides", a);
+			xbps_object_release(a);
+		}
+		if (i % 3 == 0) {
+			a = make_deps(i, 3, "libpkg", ".so.1");
+			xbps_dictionary_set(pkgd, "shlib-requires", a);
+			xbps_object_release(a);
+		}
+		if (kind == KIND_REPODATA) {
+			set_cstring(pkgd, "build-date",
+			    "2020-%02u-%02u 12:%02u UTC",
+			    1 + i % 12, 1 + i % 28, i % 60);
+			set_cstring(pkgd, "filename-sha256",
+			    "%064x", i * 2654435761u);
+			xbps_dictionary_set_uint64(pkgd, "filename-size",
+			    (uint64_t)i * 1024 + 77);
+		} else {
+			set_cstring(pkgd, "state", "installed");
+			set_cstring(pkgd, "install-date",
+			    "2020-%02u-%02u 12:%02u UTC",
+			    1 + i % 12, 1 + i % 28, i % 60);
+			set_cstring(pkgd, "metafile-sha256",
+			    "%064x", i * 40503u);
+			xbps_dictionary_set_bool(pkgd, "automatic-install",
+			    i % 3 != 0);
+		}
+		xbps_dictionary_set(d, pkgname, pkgd);
+		xbps_object_release(pkgd);
+	}
+	return d;
+}
+
+static void
+bench_internalize(struct bench_ctx *ctx)
+{
+	xbps_dictionary_t d;
+
+	d = xbps_dictionary_internalize(ctx->plist);
+	assert(d);
+	xbps_object_release(d);
+}
+
+static void
+bench_internalize_arena(struct bench_ctx *ctx)
+{
+	xbps_dictionary_t d;
+
+	d = xbps_dictionary_internalize_arena(ctx->plist);
+	assert(d);
+	xbps_object_release(d);
+}
+
+struct stream_ctx {
+	const char *p;
+	size_t left;
+};
+
+static ssize_t
+stream_read(void *arg, void *buf, size_t len)
+{
+	struct stream_ctx *sc = arg;
+
+	/* blocks of the size libarchive and read(2) usually return */
+	if (len > 64 * 1024)
+		len = 64 * 1024;
+	if (len > sc->left)
+		len = sc->left;
+	memcpy(buf, sc->p, len);
+	sc->p += len;
+	sc->left -= len;
+	return (ssize_t)len;
+}
+
+static void
+bench_internalize_stream(struct bench_ctx *ctx)
+{
+	struct stream_ctx sc = { ctx->plist, ctx->plistlen };
+	xbps_dictionary_t d;
+
+	d = xbps_dictionary_internalize_stream(stream_read, &sc);
+	assert(d);
+	xbps_object_release(d);
+}
+
+static void
+bench_internalize_lazy(struct bench_ctx *ctx)
+{
+	xbps_dictionary_t d;
+	char *buf;
+
+	/* the lazy internalizer takes ownership of the buffer */
+	buf = malloc(ctx->plistlen + 1);
+	assert(buf);
+	memcpy(buf, ctx->plist, ctx->plistlen + 1);
+	d = xbps_dictionary_internalize_lazy(buf);
+	assert(d);
+	xbps_object_release(d);
+}
+
+static void
+bench_externalize(struct bench_ctx *ctx)
+{
+	char *buf;
+
+	buf = xbps_dictionary_externalize(ctx->dict);
+	assert(buf);
+	free(buf);
+}
+
+static void
+bench_lookup(struct bench_ctx *ctx)
+{
+	xbps_dictionary_t pkgd;
+	const char *pkgver;
+
+	for (unsigned int i = 0; i < ctx->npkgs; i++) {
+		pkgd = xbps_dictionary_get(ctx->dict, ctx->keys[i]);
+		if (pkgd == NULL ||
+		    !xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &pkgver))
+			abort();
+	}
+}
+
+static void
+bench_iterate(struct bench_ctx *ctx)
+{
+	xbps_object_iterator_t iter;
+	xbps_object_t obj;
+	xbps_dictionary_t pkgd;
+	const char *pkgver;
+	unsigned int n = 0;
+
+	iter = xbps_dictionary_iterator(ctx->dict);
+	assert(iter);
+	while ((obj = xbps_object_iterator_next(iter))) {
+		pkgd = xbps_dictionary_get_keysym(ctx->dict, obj);
+		if (!xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &pkgver))
+			abort();
+		n++;
+	}
+	xbps_object_iterator_release(iter);
+	if (n != ctx->npkgs)
+		abort();
+}
+
+static void
+bench_copy(struct bench_ctx *ctx)
+{
+	xbps_dictionary_t d;
+
+	d = xbps_dictionary_copy_mutable(ctx->dict);
+	assert(d);
+	xbps_object_release(d);
+}
+
+static void
+bench_copy_modify(struct bench_ctx *ctx)
+{
+	xbps_dictionary_t d;
+
+	/* what the transaction code does: copy and touch a single entry */
+	d = xbps_dictionary_copy_mutable(ctx->dict);
+	assert(d);
+	xbps_dictionary_remove(d, ctx->keys[ctx->npkgs / 2]);
+	xbps_object_release(d);
+}
+
+static void
+bench_equals(struct bench_ctx *ctx)
+{
+	static xbps_dictionary_t other;
+
+	/* a separately built tree, so that nothing is shared with dict */
+	if (other == NULL) {
+		other = xbps_dictionary_internalize(ctx->plist);
+		assert(other);
+	}
+	if (!xbps_dictionary_equals(ctx->dict, other))
+		abort();
+}
+
+static const struct bench benches[] = {
+	{ "internalize",	true,	bench_internalize },
+	{ "internalize_arena",	true,	bench_internalize_arena },
+	{ "internalize_stream",	true,	bench_internalize_stream },
+	{ "internalize_lazy",	true,	bench_internalize_lazy },
+	{ "externalize",	true,	bench_externalize },
+	{ "lookup",		false,	bench_lookup },
+	{ "iterate",		false,	bench_iterate },
+	{ "copy",		false,	bench_copy },
+	{ "copy_modify",	false,	bench_copy_modify },
+	{ "equals",		false,	bench_equals },
+};
+
+static void
+run_bench(const struct bench *b, enum kind kind, unsigned int npkgs)
+{
+	struct bench_ctx ctx;
+	double start, elapsed;
+	unsigned long iters = 0;
+	long baserss;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.kind = kind;
+	ctx.npkgs = npkgs;
+	ctx.dict = generate(kind, npkgs);
+	ctx.plist = xbps_dictionary_externalize(ctx.dict);
+	assert(ctx.plist);
+	ctx.plistlen = strlen(ctx.plist);
+	/* lookups go through the internalized tree like real callers */
+	xbps_object_release(ctx.dict);
+	ctx.dict = xbps_dictionary_internalize(ctx.plist);
+	assert(ctx.dict);
+	ctx.keys = calloc(npkgs, sizeof(char *));
+	assert(ctx.keys);
+	for (unsigned int i = 0; i < npkgs; i++) {
+		/* visit entries in a scattered order */
+		unsigned int k = (unsigned int)(((uint64_t)i * 40503u) % npkgs);
+		ctx.keys[i] = xbps_xasprintf("pkg-%05u", k);
+		assert(ctx.keys[i]);
+	}
+	baserss = maxrss();
+
+	/* warm up */
+	b->run(&ctx);
+	start = now();
+	do {
+		b->run(&ctx);
+		iters++;
+		elapsed = now() - start;
+	} while (elapsed < mintime);
+
+	printf("{\"bench\":\"%s\",\"kind\":\"%s\",\"packages\":%u,"
+	    "\"plist_bytes\":%zu,\"iterations\":%lu,\"seconds\":%.6f,"
+	    "\"ns_per_op\":%.0f,\"ops_per_sec\":%.3f",
+	    b->name, kindnames[kind], npkgs, ctx.plistlen, iters, elapsed,
+	    elapsed * 1e9 / iters, iters / elapsed);
+	if (b->throughput) {
+		printf(",\"mb_per_sec\":%.3f",
+		    (double)ctx.plistlen * iters / elapsed / (1024 * 1024));
+	}
+	printf(",\"baseline_rss_kb\":%ld,\"maxrss_kb\":%ld}\n",
+	    baserss, maxrss());
+	fflush(stdout);
+}
+
+static void __attribute__((noreturn))
+usage(void)
+{
+	fprintf(stderr,
+	    "Usage: proplib_bench [-b bench] [-k repodata|pkgdb] "
+	    "[-s size,...] [-t seconds]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int sizes[MAX_SIZES] = { 1000, 10000, 50000 };
+	unsigned int nsizes = 3;
+	const char *only = NULL, *onlykind = NULL;
+	char *p, *s;
+	int c, status, rv = EXIT_SUCCESS;
+	pid_t pid;
+
+	while ((c = getopt(argc, argv, "b:hk:s:t:")) != -1) {
+		switch (c) {
+		case 'b':
+			only = optarg;
+			break;
+		case 'k':
+			onlykind = optarg;
+			break;
+		case 's':
+			nsizes = 0;
+			for (p = optarg; (s = strsep(&p, ",")) != NULL;) {
+				if (*s == '\0')
+					continue;
+				if (nsizes == MAX_SIZES)
+					usage();
+				sizes[nsizes] = strtoul(s, NULL, 10);
+				if (sizes[nsizes] == 0)
+					usage();
+				nsizes++;
+			}
+			break;
+		case 't':
+			mintime = strtod(optarg, NULL);
+			if (mintime <= 0)
+				usage();
+			break;
+		case 'h':
+		default:
+			usage();
+		}
+	}
+	if (optind != argc || nsizes == 0)
+		usage();
+
+	for (unsigned int k = KIND_REPODATA; k <= KIND_PKGDB; k++) {
+		if (onlykind && strcmp(onlykind, kindnames[k]))
+			continue;
+		for (unsigned int i = 0; i < nsizes; i++) {
+			for (size_t j = 0; j < sizeof(benches) / sizeof(benches[0]); j++) {
+				if (only && strcmp(only, benches[j].name))
+					continue;
+				if ((pid = fork()) == -1) {
+					perror("fork");
+					exit(EXIT_FAILURE);
+				} else if (pid == 0) {
+					run_bench(&benches[j], k, sizes[i]);
+					exit(EXIT_SUCCESS);
+				}
+				if (waitpid(pid, &status, 0) == -1 ||
+				    !WIFEXITED(status) ||
+				    WEXITSTATUS(status) != 0) {
+					fprintf(stderr, "proplib_bench: %s/%s/%u "
+					    "failed\n", benches[j].name,
+					    kindnames[k], sizes[i]);
+					rv = EXIT_FAILURE;
+				}
+			}
+		}
+	}
+	return rv;
+}
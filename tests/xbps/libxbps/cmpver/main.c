@@ -47,8 +47,44 @@ ATF_TC_BODY(cmpver_test, tc)
 	ATF_REQUIRE_EQ(xbps_cmpver("foo-1.0.1", "foo-1.0_1"), 1);
 }
 
+ATF_TC(pkgver_key_test);
+
+ATF_TC_HEAD(pkgver_key_test, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test xbps_pkgver_key_cmp conditions");
+}
+
+static int
+keycmp(const char *pkg1, const char *pkg2)
+{
+	struct xbps_pkgver_key key1, key2;
+
+	ATF_REQUIRE(xbps_pkgver_key(&key1, pkg1));
+	ATF_REQUIRE(xbps_pkgver_key(&key2, pkg2));
+	return xbps_pkgver_key_cmp(&key1, &key2);
+}
+
+ATF_TC_BODY(pkgver_key_test, tc)
+{
+	struct xbps_pkgver_key key;
+
+	ATF_REQUIRE_EQ(keycmp("foo-1.0", "foo-1.0"), 0);
+	ATF_REQUIRE_EQ(keycmp("foo-1.0", "foo-1.0_1"), -1);
+	ATF_REQUIRE_EQ(keycmp("foo-1.0_1", "foo-1.0"), 1);
+	ATF_REQUIRE_EQ(keycmp("foo-2.0rc2", "foo-2.0rc3"), -1);
+	ATF_REQUIRE_EQ(keycmp("foo-2.0rc3", "foo-2.0"), -1);
+	ATF_REQUIRE_EQ(keycmp("foo-129", "foo-129_1"), -1);
+	ATF_REQUIRE_EQ(keycmp("foo-blah-100dpi-21", "foo-blah-100dpi-21_0"), 0);
+	ATF_REQUIRE_EQ(keycmp("foo-blah-100dpi-21", "foo-blah-100dpi-2.1"), 1);
+	ATF_REQUIRE_EQ(keycmp("foo-1.0.1", "foo-1.0_1"), 1);
+	ATF_REQUIRE_EQ(keycmp("foo-1.0a", "foo-1.0b"), -1);
+	ATF_REQUIRE_EQ(keycmp("1.0_2", "foo-1.0_1"), 1);
+	ATF_REQUIRE_EQ(xbps_pkgver_key(&key, "foo-1.2.3.4.5.6.7.8.9"), false);
+}
+
 ATF_TP_ADD_TCS(tp)
 {
 	ATF_TP_ADD_TC(tp, cmpver_test);
+	ATF_TP_ADD_TC(tp, pkgver_key_test);
 	return atf_no_error();
 }
@@ -0,0 +1,620 @@
+/*-
+ * Copyright (c) 2020 Juan Romero Pardines.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <atf-c.h>
+#include <xbps.h>
+
+#define NKEYS	1000
+
+static void
+check_sorted(xbps_dictionary_t d)
+{
+	xbps_object_iterator_t iter;
+	xbps_object_t obj;
+	const char *key, *prev = NULL;
+
+	iter = xbps_dictionary_iterator(d);
+	ATF_REQUIRE(iter != NULL);
+	while ((obj = xbps_object_iterator_next(iter))) {
+		key = xbps_dictionary_keysym_cstring_nocopy(obj);
+		if (prev != NULL)
+			ATF_REQUIRE(strcmp(prev, key) < 0);
+		prev = key;
+	}
+	xbps_object_iterator_release(iter);
+}
+
+static void
+check_keys(xbps_dictionary_t d, unsigned int step)
+{
+	const char *str;
+	char key[32];
+
+	for (unsigned int i = 0; i < NKEYS; i++) {
+		snprintf(key, sizeof(key), "pkg-%u", i);
+		str = NULL;
+		if (i % step) {
+			ATF_REQUIRE_EQ(xbps_dictionary_get(d, key), NULL);
+			continue;
+		}
+		ATF_REQUIRE(xbps_dictionary_get_cstring_nocopy(d, key, &str));
+		ATF_REQUIRE_STREQ(str, key);
+	}
+	ATF_REQUIRE_EQ(xbps_dictionary_get(d, "pkg-"), NULL);
+	ATF_REQUIRE_EQ(xbps_dictionary_get(d, "zzz"), NULL);
+}
+
+ATF_TC(dictionary_large_test);
+ATF_TC_HEAD(dictionary_large_test, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test lookups in large dictionaries");
+}
+
+ATF_TC_BODY(dictionary_large_test, tc)
+{
+	xbps_dictionary_t d, copy;
+	char key[32];
+	unsigned int i;
+
+	d = xbps_dictionary_create();
+	ATF_REQUIRE(d != NULL);
+	/* insert keys in non sorted order */
+	for (i = 0; i < NKEYS; i++) {
+		snprintf(key, sizeof(key), "pkg-%u", (i * 7919) % NKEYS);
+		ATF_REQUIRE(xbps_dictionary_set_cstring(d, key, key));
+	}
+	ATF_REQUIRE_EQ(xbps_dictionary_count(d), NKEYS);
+	check_sorted(d);
+	check_keys(d, 1);
+
+	/* replacing existing keys must not add entries */
+	ATF_REQUIRE(xbps_dictionary_set_cstring(d, "pkg-0", "pkg-0"));
+	ATF_REQUIRE_EQ(xbps_dictionary_count(d), NKEYS);
+
+	/* remove odd keys */
+	for (i = 1; i < NKEYS; i += 2) {
+		snprintf(key, sizeof(key), "pkg-%u", i);
+		xbps_dictionary_remove(d, key);
+	}
+	ATF_REQUIRE_EQ(xbps_dictionary_count(d), NKEYS / 2);
+	check_sorted(d);
+	check_keys(d, 2);
+
+	/* copies and immutable dictionaries */
+	copy = xbps_dictionary_copy_mutable(d);
+	ATF_REQUIRE(copy != NULL);
+	check_keys(copy, 2);
+	xbps_dictionary_make_immutable(d);
+	check_keys(d, 2);
+	ATF_REQUIRE(xbps_dictionary_equals(d, copy));
+
+	xbps_object_release(copy);
+	xbps_object_release(d);
+}
+
+static void
+append_cstring(xbps_dictionary_t d, const char *key, const char *val)
+{
+	xbps_string_t s;
+
+	s = xbps_string_create_cstring(val);
+	ATF_REQUIRE(s != NULL);
+	ATF_REQUIRE(xbps_dictionary_append(d, key, s));
+	xbps_object_release(s);
+}
+
+ATF_TC(dictionary_append_test);
+ATF_TC_HEAD(dictionary_append_test, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test building dictionaries with "
+	    "xbps_dictionary_append");
+}
+
+ATF_TC_BODY(dictionary_append_test, tc)
+{
+	xbps_dictionary_t d, d2;
+	const char *str = NULL;
+	char key[32];
+	unsigned int i;
+
+	/* non sorted order, odd keys twice: the last value wins */
+	d = xbps_dictionary_create();
+	ATF_REQUIRE(d != NULL);
+	for (i = 0; i < NKEYS; i++) {
+		snprintf(key, sizeof(key), "pkg-%u", (i * 7919) % NKEYS);
+		append_cstring(d, key, i % 2 ? "old" : key);
+	}
+	for (i = 1; i < NKEYS; i += 2) {
+		snprintf(key, sizeof(key), "pkg-%u", (i * 7919) % NKEYS);
+		append_cstring(d, key, key);
+	}
+	xbps_dictionary_seal(d);
+	ATF_REQUIRE_EQ(xbps_dictionary_count(d), NKEYS);
+	check_sorted(d);
+	check_keys(d, 1);
+
+	/* sorted order, sealed on first lookup */
+	d2 = xbps_dictionary_create();
+	ATF_REQUIRE(d2 != NULL);
+	for (i = 0; i < NKEYS; i++) {
+		snprintf(key, sizeof(key), "pkg-%u", i);
+		ATF_REQUIRE(xbps_dictionary_append(d2, key,
+		    xbps_dictionary_get(d, key)));
+	}
+	check_keys(d2, 1);
+	ATF_REQUIRE(xbps_dictionary_equals(d, d2));
+
+	/* appends to a sealed dictionary */
+	append_cstring(d2, "pkg-1", "new");
+	append_cstring(d2, "aaa", "aaa");
+	ATF_REQUIRE_EQ(xbps_dictionary_count(d2), NKEYS + 1);
+	ATF_REQUIRE(xbps_dictionary_get_cstring_nocopy(d2, "pkg-1", &str));
+	ATF_REQUIRE_STREQ(str, "new");
+	check_sorted(d2);
+
+	/* not allowed on immutable dictionaries */
+	xbps_dictionary_make_immutable(d2);
+	ATF_REQUIRE(!xbps_dictionary_append(d2, "zzz", d));
+
+	xbps_object_release(d2);
+	xbps_object_release(d);
+}
+
+ATF_TC(dictionary_copy_test);
+ATF_TC_HEAD(dictionary_copy_test, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test copies sharing their entries "
+	    "until modified");
+}
+
+ATF_TC_BODY(dictionary_copy_test, tc)
+{
+	xbps_dictionary_t d, c1, c2, c3;
+	const char *str = NULL;
+	char key[32];
+	unsigned int i;
+
+	d = xbps_dictionary_create();
+	ATF_REQUIRE(d != NULL);
+	for (i = 0; i < NKEYS; i++) {
+		snprintf(key, sizeof(key), "pkg-%u", i);
+		ATF_REQUIRE(xbps_dictionary_set_cstring(d, key, key));
+	}
+	c1 = xbps_dictionary_copy_mutable(d);
+	c2 = xbps_dictionary_copy(c1);
+	c3 = xbps_dictionary_copy_mutable(c2);
+	ATF_REQUIRE(c1 != NULL && c2 != NULL && c3 != NULL);
+	ATF_REQUIRE(xbps_dictionary_equals(d, c1));
+	ATF_REQUIRE(xbps_dictionary_equals(c2, c3));
+
+	/* modifying a copy doesn't change the others */
+	ATF_REQUIRE(xbps_dictionary_set_cstring(c1, "pkg-0", "new"));
+	xbps_dictionary_remove(c1, "pkg-1");
+	ATF_REQUIRE_EQ(xbps_dictionary_count(c1), NKEYS - 1);
+	ATF_REQUIRE(xbps_dictionary_get_cstring_nocopy(c1, "pkg-0", &str));
+	ATF_REQUIRE_STREQ(str, "new");
+	check_keys(d, 1);
+	check_keys(c2, 1);
+	check_keys(c3, 1);
+	ATF_REQUIRE(!xbps_dictionary_equals(d, c1));
+
+	/* nor does modifying the original */
+	xbps_dictionary_remove(d, "pkg-2");
+	check_keys(c2, 1);
+	check_keys(c3, 1);
+
+	/* the last one using the entries takes them over */
+	xbps_object_release(d);
+	xbps_object_release(c2);
+	ATF_REQUIRE(xbps_dictionary_set_cstring(c3, "pkg-0", "new"));
+	ATF_REQUIRE(xbps_dictionary_get_cstring_nocopy(c3, "pkg-0", &str));
+	ATF_REQUIRE_STREQ(str, "new");
+	ATF_REQUIRE_EQ(xbps_dictionary_count(c3), NKEYS);
+
+	xbps_object_release(c3);
+	xbps_object_release(c1);
+}
+
+ATF_TC(dictionary_arena_test);
+ATF_TC_HEAD(dictionary_arena_test, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test dictionaries internalized "
+	    "into an arena");
+}
+
+ATF_TC_BODY(dictionary_arena_test, tc)
+{
+	xbps_dictionary_t d, d2, pkgd;
+	xbps_array_t a;
+	xbps_string_t s, s2;
+	const char *str;
+	char key[32], *xml;
+
+	d = xbps_dictionary_create();
+	ATF_REQUIRE(d != NULL);
+	for (unsigned int i = 0; i < NKEYS; i++) {
+		snprintf(key, sizeof(key), "pkg-%u", i);
+		pkgd = xbps_dictionary_create();
+		a = xbps_array_create();
+		ATF_REQUIRE(xbps_array_add_cstring(a, "foo>=1.0"));
+		ATF_REQUIRE(xbps_dictionary_set(pkgd, "run_depends", a));
+		ATF_REQUIRE(xbps_dictionary_set_cstring(pkgd, "pkgver", key));
+		ATF_REQUIRE(xbps_dictionary_set_uint64(pkgd, "size", i));
+		ATF_REQUIRE(xbps_dictionary_set_bool(pkgd, "automatic", i % 2));
+		ATF_REQUIRE(xbps_dictionary_set(d, key, pkgd));
+		xbps_object_release(a);
+		xbps_object_release(pkgd);
+	}
+	xml = xbps_dictionary_externalize(d);
+	ATF_REQUIRE(xml != NULL);
+	d2 = xbps_dictionary_internalize_arena(xml);
+	free(xml);
+	ATF_REQUIRE(d2 != NULL);
+	ATF_REQUIRE(xbps_dictionary_equals(d, d2));
+	xbps_object_release(d);
+
+	/* repeated values are shared */
+	a = xbps_dictionary_get(xbps_dictionary_get(d2, "pkg-1"), "run_depends");
+	s = xbps_array_get(a, 0);
+	a = xbps_dictionary_get(xbps_dictionary_get(d2, "pkg-2"), "run_depends");
+	ATF_REQUIRE_EQ(xbps_array_get(a, 0), s);
+
+	/* objects must outlive the dictionary they were internalized with */
+	pkgd = xbps_dictionary_get(d2, "pkg-10");
+	s = xbps_dictionary_get(pkgd, "pkgver");
+	xbps_object_retain(pkgd);
+	xbps_object_retain(s);
+	xbps_object_release(d2);
+	ATF_REQUIRE(xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &str));
+	ATF_REQUIRE_STREQ(str, "pkg-10");
+
+	/* containers are still mutable, interned strings are not */
+	ATF_REQUIRE(xbps_dictionary_set_cstring(pkgd, "pkgname", "pkg"));
+	ATF_REQUIRE(!xbps_string_mutable(s));
+	ATF_REQUIRE(!xbps_string_append_cstring(s, "_1"));
+	s2 = xbps_string_copy(s);
+	ATF_REQUIRE(s2 != NULL);
+	ATF_REQUIRE(xbps_string_append_cstring(s2, "_1"));
+	ATF_REQUIRE_STREQ(xbps_string_cstring_nocopy(s2), "pkg-10_1");
+	ATF_REQUIRE_STREQ(xbps_string_cstring_nocopy(s), "pkg-10");
+	xbps_object_release(s2);
+	xbps_object_release(s);
+	xbps_object_release(pkgd);
+}
+
+ATF_TC(dictionary_lazy_test);
+ATF_TC_HEAD(dictionary_lazy_test, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test lazily internalized dictionaries");
+}
+
+ATF_TC_BODY(dictionary_lazy_test, tc)
+{
+	xbps_dictionary_t d, d2, copy, pkgd, empty;
+	xbps_array_t a;
+	const char *str;
+	char key[32], *xml, *xml2;
+
+	d = xbps_dictionary_create();
+	ATF_REQUIRE(d != NULL);
+	for (unsigned int i = 0; i < NKEYS; i++) {
+		snprintf(key, sizeof(key), "pkg-%u", i);
+		pkgd = xbps_dictionary_create();
+		a = xbps_array_create();
+		ATF_REQUIRE(xbps_array_add_cstring(a, "foo>=1.0"));
+		ATF_REQUIRE(xbps_dictionary_set(pkgd, "run_depends", a));
+		ATF_REQUIRE(xbps_dictionary_set_cstring(pkgd, "pkgver", key));
+		empty = xbps_dictionary_create();
+		ATF_REQUIRE(xbps_dictionary_set(pkgd, "empty", empty));
+		xbps_object_release(empty);
+		ATF_REQUIRE(xbps_dictionary_set(d, key, pkgd));
+		xbps_object_release(a);
+		xbps_object_release(pkgd);
+	}
+	ATF_REQUIRE(xbps_dictionary_set_cstring(d, "zzz", "<&>"));
+	ATF_REQUIRE(xbps_dictionary_set_bool(d, "empty", true));
+	xml = xbps_dictionary_externalize(d);
+	ATF_REQUIRE(xml != NULL);
+
+	/* malformed input is rejected and left to the caller */
+	xml2 = strdup(xml);
+	ATF_REQUIRE(xml2 != NULL);
+	xml2[strlen(xml2) / 2] = '\0';
+	ATF_REQUIRE_EQ(xbps_dictionary_internalize_lazy(xml2), NULL);
+	free(xml2);
+
+	d2 = xbps_dictionary_internalize_lazy(xml);
+	ATF_REQUIRE(d2 != NULL);
+	ATF_REQUIRE_EQ(xbps_dictionary_count(d2), NKEYS + 2);
+	check_sorted(d2);
+
+	/* copies share the unparsed values */
+	copy = xbps_dictionary_copy(d2);
+	ATF_REQUIRE(copy != NULL);
+	pkgd = xbps_dictionary_get(d2, "pkg-10");
+	ATF_REQUIRE_EQ(xbps_object_type(pkgd), XBPS_TYPE_DICTIONARY);
+	ATF_REQUIRE_EQ(xbps_dictionary_get(d2, "pkg-10"), pkgd);
+	ATF_REQUIRE(xbps_dictionary_get_cstring_nocopy(pkgd, "pkgver", &str));
+	ATF_REQUIRE_STREQ(str, "pkg-10");
+	ATF_REQUIRE(xbps_dictionary_get_cstring_nocopy(d2, "zzz", &str));
+	ATF_REQUIRE_STREQ(str, "<&>");
+	ATF_REQUIRE(xbps_dictionary_equals(d, d2));
+	xbps_object_release(d2);
+
+	xml2 = xbps_dictionary_externalize(copy);
+	ATF_REQUIRE(xml2 != NULL);
+	xml = xbps_dictionary_externalize(d);
+	ATF_REQUIRE_STREQ(xml, xml2);
+	free(xml);
+	free(xml2);
+	ATF_REQUIRE(xbps_dictionary_equals(copy, d));
+
+	xbps_object_release(copy);
+	xbps_object_release(d);
+}
+
+ATF_TC(dictionary_externalize_test);
+ATF_TC_HEAD(dictionary_externalize_test, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test externalizing dictionaries "
+	    "to files");
+}
+
+ATF_TC_BODY(dictionary_externalize_test, tc)
+{
+	xbps_dictionary_t d, d2, pkgd;
+	char key[32], *xml, *xml2;
+	FILE *fp;
+	long len;
+
+	d = xbps_dictionary_create();
+	ATF_REQUIRE(d != NULL);
+	for (unsigned int i = 0; i < NKEYS; i++) {
+		snprintf(key, sizeof(key), "pkg-%u", i);
+		pkgd = xbps_dictionary_create();
+		ATF_REQUIRE(xbps_dictionary_set_cstring(pkgd, "pkgver", key));
+		ATF_REQUIRE(xbps_dictionary_set_cstring(pkgd, "short_desc",
+		    "foo <bar> & baz >&<"));
+		ATF_REQUIRE(xbps_dictionary_set_uint64(pkgd, "size", i));
+		ATF_REQUIRE(xbps_dictionary_set_bool(pkgd, "automatic", i % 2));
+		ATF_REQUIRE(xbps_dictionary_set(d, key, pkgd));
+		xbps_object_release(pkgd);
+	}
+	xml = xbps_dictionary_externalize(d);
+	ATF_REQUIRE(xml != NULL);
+	ATF_REQUIRE(strstr(xml, "foo &lt;bar&gt; &amp; baz &gt;&amp;&lt;"));
+
+	/* the file must have the same contents as the string */
+	ATF_REQUIRE(xbps_dictionary_externalize_to_file(d, "dict.plist"));
+	fp = fopen("dict.plist", "r");
+	ATF_REQUIRE(fp != NULL);
+	ATF_REQUIRE_EQ(fseek(fp, 0, SEEK_END), 0);
+	len = ftell(fp);
+	ATF_REQUIRE_EQ((size_t)len, strlen(xml));
+	rewind(fp);
+	xml2 = malloc(len + 1);
+	ATF_REQUIRE(xml2 != NULL);
+	ATF_REQUIRE_EQ(fread(xml2, 1, len, fp), (size_t)len);
+	xml2[len] = '\0';
+	fclose(fp);
+	ATF_REQUIRE_STREQ(xml, xml2);
+	free(xml2);
+	free(xml);
+
+	d2 = xbps_dictionary_internalize_from_file("dict.plist");
+	ATF_REQUIRE(d2 != NULL);
+	ATF_REQUIRE(xbps_dictionary_equals(d, d2));
+	xbps_object_release(d2);
+	xbps_object_release(d);
+}
+
+struct stream {
+	const char *buf;
+	size_t len, blksize;
+};
+
+static ssize_t
+stream_read(void *arg, void *buf, size_t len)
+{
+	struct stream *st = arg;
+
+	if (len > st->blksize)
+		len = st->blksize;
+	if (len > st->len)
+		len = st->len;
+	memcpy(buf, st->buf, len);
+	st->buf += len;
+	st->len -= len;
+	return len;
+}
+
+ATF_TC(dictionary_stream_test);
+ATF_TC_HEAD(dictionary_stream_test, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test dictionaries internalized "
+	    "from a stream");
+}
+
+ATF_TC_BODY(dictionary_stream_test, tc)
+{
+	xbps_dictionary_t d, d2, pkgd;
+	struct stream st;
+	char key[32], *xml, *big;
+	const size_t blksizes[] = { 1, 7, 4096, 1024 * 1024 };
+
+	d = xbps_dictionary_create();
+	ATF_REQUIRE(d != NULL);
+	for (unsigned int i = 0; i < NKEYS; i++) {
+		snprintf(key, sizeof(key), "pkg-%u", i);
+		pkgd = xbps_dictionary_create();
+		ATF_REQUIRE(xbps_dictionary_set_cstring(pkgd, "pkgver", key));
+		ATF_REQUIRE(xbps_dictionary_set_uint64(pkgd, "size", i));
+		ATF_REQUIRE(xbps_dictionary_set(d, key, pkgd));
+		xbps_object_release(pkgd);
+	}
+	/* a value larger than the stream buffer */
+	big = malloc(256 * 1024);
+	ATF_REQUIRE(big != NULL);
+	memset(big, 'x', 256 * 1024 - 1);
+	big[256 * 1024 - 1] = '\0';
+	ATF_REQUIRE(xbps_dictionary_set_cstring(d, "big", big));
+	free(big);
+	ATF_REQUIRE(xbps_dictionary_set_cstring(d, "escaped", "<&>"));
+	xml = xbps_dictionary_externalize(d);
+	ATF_REQUIRE(xml != NULL);
+
+	for (unsigned int i = 0; i < 4; i++) {
+		st.buf = xml;
+		st.len = strlen(xml);
+		st.blksize = blksizes[i];
+		if (i % 2)
+			d2 = xbps_dictionary_internalize_stream(stream_read, &st);
+		else
+			d2 = xbps_dictionary_internalize_stream_arena(stream_read, &st);
+		ATF_REQUIRE(d2 != NULL);
+		ATF_REQUIRE(xbps_dictionary_equals(d, d2));
+		xbps_object_release(d2);
+	}
+
+	/* truncated input */
+	st.buf = xml;
+	st.len = strlen(xml) - 10;
+	st.blksize = 4096;
+	ATF_REQUIRE_EQ(xbps_dictionary_internalize_stream(stream_read, &st), NULL);
+
+	/* empty dictionary */
+	free(xml);
+	xbps_object_release(d);
+	d = xbps_dictionary_create();
+	xml = xbps_dictionary_externalize(d);
+	ATF_REQUIRE(xml != NULL);
+	st.buf = xml;
+	st.len = strlen(xml);
+	d2 = xbps_dictionary_internalize_stream(stream_read, &st);
+	ATF_REQUIRE(d2 != NULL);
+	ATF_REQUIRE_EQ(xbps_dictionary_count(d2), 0);
+	xbps_object_release(d2);
+	xbps_object_release(d);
+	free(xml);
+}
+
+#define NTHREADS	8
+#define NROUNDS		500
+
+static xbps_dictionary_t
+create_numbers_dict(void)
+{
+	xbps_dictionary_t d;
+	char key[32];
+	unsigned int i;
+
+	d = xbps_dictionary_create();
+	if (d == NULL)
+		return NULL;
+	for (i = 0; i < 100; i++) {
+		snprintf(key, sizeof(key), "thread-key-%u", i);
+		if (!xbps_dictionary_set_uint64(d, key, i) ||
+		    !xbps_dictionary_set_int64(d, key + 7, -(int64_t)i)) {
+			xbps_object_release(d);
+			return NULL;
+		}
+	}
+	return d;
+}
+
+static void *
+numbers_thread(void *arg)
+{
+	xbps_dictionary_t d1, d2;
+	unsigned int i;
+	bool eq;
+
+	for (i = 0; i < NROUNDS; i++) {
+		/*
+		 * Every thread keeps creating and releasing the same keys
+		 * and numbers.  Numbers of the same sign are only equal when
+		 * they're the same object, so this fails if uniquing ever
+		 * made a copy.
+		 */
+		if ((d1 = create_numbers_dict()) == NULL)
+			return arg;
+		if ((d2 = create_numbers_dict()) == NULL) {
+			xbps_object_release(d1);
+			return arg;
+		}
+		eq = xbps_dictionary_equals(d1, d2) &&
+		    xbps_dictionary_count(d1) == 200;
+		xbps_object_release(d1);
+		xbps_object_release(d2);
+		if (!eq)
+			return arg;
+	}
+	return NULL;
+}
+
+ATF_TC(dictionary_threads_test);
+
+ATF_TC_HEAD(dictionary_threads_test, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test creating and releasing keysyms "
+	    "and numbers from many threads");
+}
+
+ATF_TC_BODY(dictionary_threads_test, tc)
+{
+	pthread_t thds[NTHREADS];
+	void *rv;
+	unsigned int i;
+
+#ifdef SINGLE_THREADED
+	atf_tc_skip("built with --enable-single-threaded");
+#endif
+	for (i = 0; i < NTHREADS; i++) {
+		ATF_REQUIRE_EQ(pthread_create(&thds[i], NULL,
+		    numbers_thread, &thds[i]), 0);
+	}
+	for (i = 0; i < NTHREADS; i++) {
+		ATF_REQUIRE_EQ(pthread_join(thds[i], &rv), 0);
+		ATF_CHECK(rv == NULL);
+	}
+}
+
+ATF_TP_ADD_TCS(tp)
+{
+	ATF_TP_ADD_TC(tp, dictionary_large_test);
+	ATF_TP_ADD_TC(tp, dictionary_append_test);
+	ATF_TP_ADD_TC(tp, dictionary_copy_test);
+	ATF_TP_ADD_TC(tp, dictionary_arena_test);
+	ATF_TP_ADD_TC(tp, dictionary_lazy_test);
+	ATF_TP_ADD_TC(tp, dictionary_stream_test);
+	ATF_TP_ADD_TC(tp, dictionary_externalize_test);
+	ATF_TP_ADD_TC(tp, dictionary_threads_test);
+
+	return atf_no_error();
+}
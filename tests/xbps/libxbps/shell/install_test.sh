@@ -725,6 +725,55 @@ update_issue_218_body() {
 	atf_check_equal $? 0
 }
 
+atf_test_case update_uptodate
+
+update_uptodate_head() {
+	atf_set "descr" "Tests for pkg updates: nothing to update fast path"
+}
+
+update_uptodate_body() {
+	mkdir -p repo pkg_A
+	cd repo
+	xbps-create -A noarch -n A-1.1_1 -s "A pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ..
+
+	xbps-install -r root --repo=repo -yd A
+	atf_check_equal $? 0
+	# nothing to update: an empty transaction that doesn't touch pkgdb
+	out=$(xbps-install -r root --repo=repo -un)
+	atf_check_equal $? 0
+	atf_check_equal "$out" ""
+	cp root/var/db/xbps/pkgdb-0.38.plist pkgdb.plist
+	xbps-install -r root --repo=repo -yu
+	atf_check_equal $? 0
+	cmp -s pkgdb.plist root/var/db/xbps/pkgdb-0.38.plist
+	atf_check_equal $? 0
+
+	# an older version reverting the installed one is an update
+	cd repo
+	rm -f *.xbps
+	xbps-create -A noarch -n A-1.0_2 -s "A pkg" --reverts "1.1_1" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -f -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ..
+	out=$(xbps-install -r root --repo=repo -un | awk '{print $1 " " $2}')
+	atf_check_equal "$out" "A-1.0_2 update"
+
+	cd repo
+	rm -f *.xbps
+	xbps-create -A noarch -n A-1.2_1 -s "A pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ..
+	out=$(xbps-install -r root --repo=repo -un | awk '{print $1 " " $2}')
+	atf_check_equal "$out" "A-1.2_1 update"
+}
+
 atf_init_test_cases() {
 	atf_add_test_case install_empty
 	atf_add_test_case install_with_deps
@@ -745,4 +794,5 @@ atf_init_test_cases() {
 	atf_add_test_case update_xbps_virtual
 	atf_add_test_case update_with_revdeps
 	atf_add_test_case update_issue_218
+	atf_add_test_case update_uptodate
 }
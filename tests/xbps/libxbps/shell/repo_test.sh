@@ -22,6 +22,391 @@ repo_close_body() {
 	atf_check_equal $? 2
 }
 
+atf_test_case repo_order
+
+repo_order_head() {
+	atf_set "descr" "Tests for pkg repos: repos are used in configuration order"
+}
+
+repo_order_body() {
+	mkdir -p repo1 repo2 repo3 pkg_A
+	cd repo1
+	xbps-create -A noarch -n A-1.0_1 -s "A pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ../repo2
+	xbps-create -A noarch -n A-1.1_1 -s "A pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ../repo3
+	xbps-create -A noarch -n A-2.0_1 -s "A pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-create -A noarch -n B-1.0_1 -s "B pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ..
+	out=$(xbps-query -C empty.conf -r root --repository=repo3 --repository=repo2 --repository=repo1 -R --property=pkgver A)
+	atf_check_equal "$out" A-2.0_1
+	out=$(xbps-query -C empty.conf -r root --repository=repo1 --repository=repo2 --repository=repo3 -R --property=pkgver A)
+	atf_check_equal "$out" A-1.0_1
+	# a broken repo in between is skipped
+	truncate --size 0 repo2/*-repodata
+	out=$(xbps-query -C empty.conf -r root --repository=repo2 --repository=repo3 --repository=repo1 -R --property=pkgver A)
+	atf_check_equal "$out" A-2.0_1
+	out=$(xbps-query -C empty.conf -r root --repository=repo1 --repository=repo2 --repository=repo3 -R --property=pkgver B)
+	atf_check_equal "$out" B-1.0_1
+}
+
+atf_test_case repo_bestmatch
+
+repo_bestmatch_head() {
+	atf_set "descr" "Tests for pkg repos: best matching across repos"
+}
+
+repo_bestmatch_body() {
+	mkdir -p repo1 repo2 repo3 pkg_A root/xbps.d
+	cd repo1
+	xbps-create -A noarch -n A-1.0_1 -s "A pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ../repo2
+	xbps-create -A noarch -n A-2.0_1 -s "A pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ../repo3
+	xbps-create -A noarch -n A-1.1_1 -s "A pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-create -A noarch -n B-1.0_1 -s "B pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ..
+	echo "bestmatching=true" > root/xbps.d/bestmatch.conf
+	repos="--repository=repo1 --repository=repo2 --repository=repo3"
+	out=$(xbps-query -C xbps.d -r root $repos -R --property=pkgver A)
+	atf_check_equal "$out" A-2.0_1
+	out=$(xbps-query -C xbps.d -r root $repos -R --property=pkgver 'A<2.0')
+	atf_check_equal "$out" A-1.1_1
+	out=$(xbps-query -C xbps.d -r root $repos -R --property=pkgver A-1.0_1)
+	atf_check_equal "$out" A-1.0_1
+	out=$(xbps-query -C xbps.d -r root $repos -R --property=pkgver B)
+	atf_check_equal "$out" B-1.0_1
+	xbps-query -C xbps.d -r root $repos -R --property=pkgver C
+	atf_check_equal $? 2
+}
+
+atf_test_case repo_sync_delta cleanup
+
+repo_sync_delta_head() {
+	atf_set "descr" "Tests for repository sync: incremental updates with deltas"
+	atf_set "require.progs" "python3"
+}
+
+repo_sync_delta_body() {
+	mkdir -p repo pkg
+	cd repo
+	xbps-create -A noarch -n foo-1.0_1 -s "foo pkg" ../pkg
+	atf_check_equal $? 0
+	xbps-create -A noarch -n bar-1.0_1 -s "bar pkg" ../pkg
+	atf_check_equal $? 0
+	# the second index publishes its digest
+	xbps-rindex -a $PWD/foo-1.0_1.noarch.xbps
+	atf_check_equal $? 0
+	xbps-rindex -a $PWD/bar-1.0_1.noarch.xbps
+	atf_check_equal $? 0
+	cd ..
+
+	python3 -u -m http.server 0 --bind 127.0.0.1 --directory repo >server.log 2>&1 &
+	echo $! > server.pid
+	for i in $(seq 50); do
+		port=$(sed -n 's/.* port \([0-9]*\).*/\1/p' server.log)
+		[ -n "$port" ] && break
+		sleep 0.1
+	done
+	[ -n "$port" ]
+	atf_check_equal $? 0
+	url=http://127.0.0.1:$port
+
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	# up to date, the archive isn't requested again
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	atf_check_equal "$(grep -c 'GET /[^ ]*-repodata ' server.log)" 1
+	# HTTP modification times have a resolution of 1s
+	sleep 1
+	cd repo
+	xbps-create -A noarch -n foo-1.1_1 -s "foo pkg" ../pkg
+	atf_check_equal $? 0
+	xbps-rindex -a $PWD/foo-1.1_1.noarch.xbps
+	atf_check_equal $? 0
+	rm bar-1.0_1.noarch.xbps
+	xbps-rindex -c $PWD
+	atf_check_equal $? 0
+	atf_check_equal "$(ls *-repodata.*.delta | wc -l)" 3
+	[ -f *-repodata.delta ]
+	atf_check_equal $? 0
+	cd ..
+
+	# the local copy is patched, not downloaded
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	cmp -s repo/*-repodata root/var/db/xbps/http*/*-repodata
+	atf_check_equal $? 1
+	out=$(xbps-query -r root -C empty.conf --repository=$url -Rs '')
+	atf_check_equal "$out" "[-] foo-1.1_1 foo pkg"
+
+	# deltas not ending in the published digest fall back to a full download
+	sleep 1
+	cd repo
+	xbps-create -A noarch -n foo-1.2_1 -s "foo pkg" ../pkg
+	atf_check_equal $? 0
+	xbps-rindex -a $PWD/foo-1.2_1.noarch.xbps
+	atf_check_equal $? 0
+	sed -i 's/<string>[0-9a-f]*</<string>0000000000000000000000000000000000000000000000000000000000000000</' *-repodata.delta
+	cd ..
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	cmp -s repo/*-repodata root/var/db/xbps/http*/*-repodata
+	atf_check_equal $? 0
+	out=$(xbps-query -r root -C empty.conf --repository=$url -Rs '')
+	atf_check_equal "$out" "[-] foo-1.2_1 foo pkg"
+
+	# a broken delta falls back to a full download
+	sleep 1
+	cd repo
+	xbps-create -A noarch -n foo-1.3_1 -s "foo pkg" ../pkg
+	atf_check_equal $? 0
+	xbps-rindex -a $PWD/foo-1.3_1.noarch.xbps
+	atf_check_equal $? 0
+	echo garbage > $(ls -t *-repodata.*.delta | head -1)
+	cd ..
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	cmp -s repo/*-repodata root/var/db/xbps/http*/*-repodata
+	atf_check_equal $? 0
+	out=$(xbps-query -r root -C empty.conf --repository=$url -Rs '')
+	atf_check_equal "$out" "[-] foo-1.3_1 foo pkg"
+	kill $(cat server.pid)
+	rm server.pid
+}
+
+repo_sync_delta_cleanup() {
+	[ -f server.pid ] && kill $(cat server.pid)
+}
+
+atf_test_case repo_sync_nodelta cleanup
+
+repo_sync_nodelta_head() {
+	atf_set "descr" "Tests for repository sync: repositories without deltas"
+	atf_set "require.progs" "python3"
+}
+
+repo_sync_nodelta_body() {
+	mkdir -p repo pkg
+	cd repo
+	xbps-create -A noarch -n foo-1.0_1 -s "foo pkg" ../pkg
+	atf_check_equal $? 0
+	xbps-rindex -a $PWD/*.xbps
+	atf_check_equal $? 0
+	rm -f *.delta
+	cd ..
+
+	python3 -u -m http.server 0 --bind 127.0.0.1 --directory repo >server.log 2>&1 &
+	echo $! > server.pid
+	for i in $(seq 50); do
+		port=$(sed -n 's/.* port \([0-9]*\).*/\1/p' server.log)
+		[ -n "$port" ] && break
+		sleep 0.1
+	done
+	[ -n "$port" ]
+	atf_check_equal $? 0
+	url=http://127.0.0.1:$port
+
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	# the missing digest is only requested once for the same archive
+	atf_check_equal "$(grep -c 'GET /[^ ]*-repodata.delta ' server.log)" 1
+	# until a new archive is downloaded
+	sleep 1
+	cd repo
+	xbps-create -A noarch -n foo-1.1_1 -s "foo pkg" ../pkg
+	atf_check_equal $? 0
+	xbps-rindex -a $PWD/foo-1.1_1.noarch.xbps
+	atf_check_equal $? 0
+	rm -f *.delta
+	cd ..
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	kill $(cat server.pid)
+	rm server.pid
+	atf_check_equal "$(grep -c 'GET /[^ ]*-repodata.delta ' server.log)" 2
+	out=$(xbps-query -r root -C empty.conf --repository=$url -Rs '')
+	atf_check_equal "$out" "[-] foo-1.1_1 foo pkg"
+}
+
+repo_sync_nodelta_cleanup() {
+	[ -f server.pid ] && kill $(cat server.pid)
+}
+
+atf_test_case repo_sync_parallel cleanup
+
+repo_sync_parallel_head() {
+	atf_set "descr" "Tests for repository sync: repositories synchronized concurrently"
+	atf_set "require.progs" "python3"
+}
+
+repo_sync_parallel_body() {
+	mkdir -p pkg
+	for i in 1 2 3 4; do
+		mkdir -p repo/$i
+		cd repo/$i
+		xbps-create -A noarch -n foo$i-1.0_1 -s "foo pkg" ../../pkg
+		atf_check_equal $? 0
+		xbps-rindex -a $PWD/*.xbps
+		atf_check_equal $? 0
+		cd ../..
+	done
+	# every request is answered after 0.5s
+	cat > server.py <<EOF
+import functools, http.server, sys, time
+class Handler(http.server.SimpleHTTPRequestHandler):
+    def send_head(self):
+        time.sleep(0.5)
+        return super().send_head()
+srv = http.server.ThreadingHTTPServer(("127.0.0.1", 0),
+    functools.partial(Handler, directory=sys.argv[1]))
+print("Serving HTTP on 127.0.0.1 port %d" % srv.server_address[1])
+srv.serve_forever()
+EOF
+	python3 -u server.py repo >server.log 2>&1 &
+	echo $! > server.pid
+	for i in $(seq 50); do
+		port=$(sed -n 's/.* port \([0-9]*\).*/\1/p' server.log)
+		[ -n "$port" ] && break
+		sleep 0.1
+	done
+	[ -n "$port" ]
+	atf_check_equal $? 0
+
+	for jobs in 1 4; do
+		mkdir -p conf$jobs
+		echo "syncjobs=$jobs" > conf$jobs/xbps.conf
+		for i in 1 2 3 4; do
+			echo "repository=http://127.0.0.1:$port/$i" >> conf$jobs/xbps.conf
+		done
+		start=$(date +%s%N)
+		xbps-install -r root$jobs -C $PWD/conf$jobs -S >out$jobs
+		atf_check_equal $? 0
+		end=$(date +%s%N)
+		eval elapsed$jobs=$(((end - start) / 1000000))
+	done
+	kill $(cat server.pid)
+	rm server.pid
+	echo "serial: ${elapsed1}ms parallel: ${elapsed4}ms"
+	[ $((elapsed4 * 2)) -lt $elapsed1 ]
+	atf_check_equal $? 0
+	# progress is reported with the name of the file, not its local path
+	atf_check_equal "$(grep -c '^[^/]*-repodata: .*avg rate' out4)" 4
+	out=$(xbps-query -r root4 -C $PWD/conf4 -Rs foo | wc -l)
+	atf_check_equal "$out" 4
+}
+
+repo_sync_parallel_cleanup() {
+	[ -f server.pid ] && kill $(cat server.pid)
+}
+
+atf_test_case repo_sync_dict cleanup
+
+repo_sync_dict_head() {
+	atf_set "descr" "Tests for repository sync: repodata compressed with a dictionary"
+	atf_set "require.progs" "python3"
+}
+
+repo_sync_dict_body() {
+	mkdir -p repo pkg
+	cd repo
+	for i in $(seq 1 30); do
+		xbps-create -A noarch -n foo${i}-1.0_1 -s "foo pkg" \
+			-D "bar>=${i}.0_1" --shlib-provides "libfoo${i}.so.1" ../pkg
+		atf_check_equal $? 0
+	done
+	xbps-rindex --train-dict -a $PWD/*.xbps
+	atf_check_equal $? 0
+	repodata=$(echo *-repodata)
+	[ -s $repodata.dict ]
+	atf_check_equal $? 0
+	cd ..
+
+	python3 -u -m http.server 0 --bind 127.0.0.1 --directory repo >server.log 2>&1 &
+	echo $! > server.pid
+	for i in $(seq 50); do
+		port=$(sed -n 's/.* port \([0-9]*\).*/\1/p' server.log)
+		[ -n "$port" ] && break
+		sleep 0.1
+	done
+	[ -n "$port" ]
+	atf_check_equal $? 0
+	url=http://127.0.0.1:$port
+
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	lrepodir=$(dirname $(find root -name $repodata))
+	cmp repo/$repodata.dict $lrepodir/$repodata.dict
+	atf_check_equal $? 0
+	# a missing dictionary is fetched even if the archive is up to date
+	rm $lrepodir/$repodata.dict
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	cmp repo/$repodata.dict $lrepodir/$repodata.dict
+	atf_check_equal $? 0
+	# training a new dictionary keeps the one of the previous archive
+	cp repo/$repodata.dict old.dict
+	# HTTP modification times have a resolution of 1s
+	sleep 1
+	cd repo
+	xbps-create -A noarch -n foo31-1.0_1 -s "foo pkg" ../pkg
+	atf_check_equal $? 0
+	xbps-rindex --train-dict -a $PWD/foo31-1.0_1.noarch.xbps
+	atf_check_equal $? 0
+	cd ..
+	cmp -s old.dict repo/$repodata.dict
+	atf_check_equal $? 1
+	[ $(ls repo/$repodata.dict.* | wc -l) -eq 2 ]
+	atf_check_equal $? 0
+	# fetch the new archive, not a delta to the local one
+	rm -f repo/*.delta
+	xbps-install -r root -C empty.conf --repository=$url -S
+	atf_check_equal $? 0
+	kill $(cat server.pid)
+	rm server.pid
+	cmp repo/$repodata.dict $lrepodir/$repodata.dict
+	atf_check_equal $? 0
+	# decode the archive, not its binary index
+	rm $lrepodir/$repodata.idx
+	out=$(xbps-query -r root -C empty.conf --repository=$url -R -p pkgver foo31)
+	atf_check_equal "$out" "foo31-1.0_1"
+}
+
+repo_sync_dict_cleanup() {
+	[ -f server.pid ] && kill $(cat server.pid)
+}
+
 atf_init_test_cases() {
 	atf_add_test_case repo_close
+	atf_add_test_case repo_order
+	atf_add_test_case repo_bestmatch
+	atf_add_test_case repo_sync_delta
+	atf_add_test_case repo_sync_nodelta
+	atf_add_test_case repo_sync_parallel
+	atf_add_test_case repo_sync_dict
 }
@@ -363,6 +363,35 @@ vpkg_multirepo_body() {
        atf_check_equal "$out" "B-1.0_1"
 }
 
+atf_test_case vpkg_lookup
+
+vpkg_lookup_head() {
+	atf_set "descr" "Tests for virtual pkgs: provider lookups in a repository"
+}
+
+vpkg_lookup_body() {
+	mkdir -p some_repo pkg_A pkg_B
+	cd some_repo
+	xbps-create -A noarch -n A-1.0_1 -s "A pkg" --provides "vpkg-1.0_1" ../pkg_A
+	atf_check_equal $? 0
+	xbps-create -A noarch -n B-1.0_1 -s "B pkg" --provides "vpkg-2.0_1 other-1_1" ../pkg_B
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ..
+
+	out=$(xbps-query -C empty.conf -r root --repository=$PWD/some_repo -R --property=pkgver vpkg)
+	atf_check_equal "$out" "A-1.0_1"
+	out=$(xbps-query -C empty.conf -r root --repository=$PWD/some_repo -R --property=pkgver 'vpkg>=2.0')
+	atf_check_equal "$out" "B-1.0_1"
+	out=$(xbps-query -C empty.conf -r root --repository=$PWD/some_repo -R --property=pkgver vpkg-2.0_1)
+	atf_check_equal "$out" "B-1.0_1"
+	out=$(xbps-query -C empty.conf -r root --repository=$PWD/some_repo -R --property=pkgver other)
+	atf_check_equal "$out" "B-1.0_1"
+	xbps-query -C empty.conf -r root --repository=$PWD/some_repo -R --property=pkgver missing
+	atf_check_equal $? 2
+}
+
 atf_init_test_cases() {
 	atf_add_test_case vpkg_dont_update
 	atf_add_test_case vpkg_replace_provider
@@ -374,4 +403,5 @@ atf_init_test_cases() {
 	atf_add_test_case vpkg_provider_and_revdeps_downgrade
 	atf_add_test_case vpkg_provider_remove
 	atf_add_test_case vpkg_multirepo
+	atf_add_test_case vpkg_lookup
 }
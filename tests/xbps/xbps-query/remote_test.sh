@@ -23,6 +23,42 @@ remote_files_body() {
 	atf_check_equal $? 2
 }
 
+atf_test_case remote_revdeps
+
+remote_revdeps_head() {
+	atf_set "descr" "xbps-query(1) -RX: reverse dependencies test"
+}
+
+remote_revdeps_body() {
+	mkdir -p some_repo pkg
+	cd some_repo
+	xbps-create -A noarch -n foo-1.0_1 -s "foo pkg" --provides "vfoo-1_1" ../pkg
+	atf_check_equal $? 0
+	xbps-create -A noarch -n exact-1.0_1 -s "exact pkg" --dependencies "foo-1.0_1" ../pkg
+	atf_check_equal $? 0
+	xbps-create -A noarch -n pattern-1.0_1 -s "pattern pkg" --dependencies "foo>=1.0" ../pkg
+	atf_check_equal $? 0
+	xbps-create -A noarch -n glob-1.0_1 -s "glob pkg" --dependencies "foo-[0-9]*" ../pkg
+	atf_check_equal $? 0
+	xbps-create -A noarch -n virtual-1.0_1 -s "virtual pkg" --dependencies "vfoo>=0" ../pkg
+	atf_check_equal $? 0
+	xbps-create -A noarch -n newer-1.0_1 -s "newer pkg" --dependencies "foo>=2.0" ../pkg
+	atf_check_equal $? 0
+	xbps-create -A noarch -n other-1.0_1 -s "other pkg" --dependencies "exact>=0" ../pkg
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ..
+
+	out=$(xbps-query -C empty.conf --repository=some_repo -RX foo | tr '\n' ' ')
+	atf_check_equal "$out" "exact-1.0_1 glob-1.0_1 pattern-1.0_1 virtual-1.0_1 "
+	out=$(xbps-query -C empty.conf --repository=some_repo -RX vfoo | tr '\n' ' ')
+	atf_check_equal "$out" "virtual-1.0_1 "
+	out=$(xbps-query -C empty.conf --repository=some_repo -RX exact | tr '\n' ' ')
+	atf_check_equal "$out" "other-1.0_1 "
+}
+
 atf_init_test_cases() {
 	atf_add_test_case remote_files
+	atf_add_test_case remote_revdeps
 }
@@ -167,9 +167,170 @@ stage_resolve_bug_body() {
 	atf_check_equal $? 1
 }
 
+atf_test_case binidx
+
+binidx_head() {
+	atf_set "descr" "xbps-rindex(1) -a: binary index test"
+}
+
+binidx_body() {
+	mkdir -p some_repo pkg_A
+	touch pkg_A/file00
+	cd some_repo
+	xbps-create -A noarch -n foo-1.0_1 -s "foo pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	[ -f *-repodata.idx ]
+	atf_check_equal $? 0
+	cp *-repodata.idx ../old.idx
+	xbps-create -A noarch -n foo-1.1_1 -s "foo pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cd ..
+	result="$(xbps-query -r root -C empty.conf --repository=some_repo -s '')"
+	atf_check_equal "$result" "[-] foo-1.1_1 foo pkg"
+	# a stale binary index must be ignored
+	cp old.idx some_repo/$(cd some_repo && echo *-repodata.idx)
+	result="$(xbps-query -r root -C empty.conf --repository=some_repo -s '')"
+	atf_check_equal "$result" "[-] foo-1.1_1 foo pkg"
+	# as well as a corrupt one
+	echo garbage > some_repo/$(cd some_repo && echo *-repodata.idx)
+	result="$(xbps-query -r root -C empty.conf --repository=some_repo -s '')"
+	atf_check_equal "$result" "[-] foo-1.1_1 foo pkg"
+	rm some_repo/*-repodata.idx
+	result="$(xbps-query -r root -C empty.conf --repository=some_repo -s '')"
+	atf_check_equal "$result" "[-] foo-1.1_1 foo pkg"
+}
+
+atf_test_case binidx_digest
+
+binidx_digest_head() {
+	atf_set "descr" "xbps-rindex(1) -a: binary index digest test"
+}
+
+binidx_digest_body() {
+	mkdir -p some_repo pkg_A
+	touch pkg_A/file00
+	cd some_repo
+	xbps-create -A noarch -n foo-1.0_1 -s "foo pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d --compression none -a $PWD/*.xbps
+	atf_check_equal $? 0
+	cp *-repodata.idx ../old.idx
+	cp -p $(echo *-repodata) ../old.repodata
+	rm *.xbps
+	xbps-create -A noarch -n foo-1.1_1 -s "foo pkg" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d --compression none -a $PWD/*.xbps
+	atf_check_equal $? 0
+	repodata=$(echo *-repodata)
+	cd ..
+	atf_check_equal $(stat -c %s old.repodata) $(stat -c %s some_repo/$repodata)
+	# same size and mtime, but different contents
+	cp old.idx some_repo/$repodata.idx
+	touch -r old.repodata some_repo/$repodata
+	result="$(xbps-query -r root -C empty.conf --repository=some_repo -s '')"
+	atf_check_equal "$result" "[-] foo-1.1_1 foo pkg"
+}
+
+atf_test_case frames
+
+frames_head() {
+	atf_set "descr" "xbps-rindex(1) -a: multi-frame zstd repodata test"
+}
+
+frames_body() {
+	mkdir -p some_repo pkg_A
+	touch pkg_A/file00
+	cd some_repo
+	# ~200KB of index per package, the index spans several frames
+	shlibs=$(seq -f "libfoo%g.so.1" 1 6000)
+	for i in $(seq 1 8); do
+		xbps-create -A noarch -n foo${i}-1.0_1 -s "foo pkg" \
+			--shlib-provides "$(echo $shlibs)" ../pkg_A
+		atf_check_equal $? 0
+	done
+	xbps-rindex -d -a $PWD/*.xbps
+	atf_check_equal $? 0
+	repodata=$(echo *-repodata)
+	# seek table footer: number of frames, descriptor, magic
+	footer="$(tail -c 9 $repodata | od -An -tx1 | tr -d ' \n')"
+	atf_check_equal "${footer#??}" "00000000b1ea928f"
+	atf_check_equal "$(tail -c 9 $repodata | od -An -tu1 -N1 | tr -d ' ')" 2
+	rm $repodata.idx
+	cd ..
+	result="$(xbps-query -r root -C empty.conf --repository=some_repo -s foo8)"
+	atf_check_equal "$result" "[-] foo8-1.0_1 foo pkg"
+	result="$(xbps-query -r root -C empty.conf --repository=some_repo -p pkgver -R foo1)"
+	atf_check_equal "$result" "foo1-1.0_1"
+	# a seek table not matching the frames is ignored
+	cd some_repo
+	size=$(wc -c < $repodata)
+	printf '\377\377\377\177' | dd of=$repodata bs=1 seek=$((size - 25 + 4)) conv=notrunc
+	atf_check_equal $? 0
+	rm -f $repodata.idx
+	cd ..
+	result="$(xbps-query -r root -C empty.conf --repository=some_repo -p pkgver -R foo8)"
+	atf_check_equal "$result" "foo8-1.0_1"
+}
+
+atf_test_case shlib_providers
+
+shlib_providers_head() {
+	atf_set "descr" "xbps-rindex(1) -a: shlib providers index test"
+	atf_set "require.progs" "openssl"
+}
+
+shlib_providers_body() {
+	mkdir -p some_repo pkg_A pkg_B
+	touch pkg_A/file00 pkg_B/file01
+	openssl genrsa -out key.pem 2048
+	atf_check_equal $? 0
+	cd some_repo
+	xbps-create -A noarch -n foo-1.0_1 -s "foo pkg" --shlib-provides "libfoo.so.1" ../pkg_A
+	atf_check_equal $? 0
+	xbps-create -A noarch -n bar-1.0_1 -s "bar pkg" --shlib-provides "libbar.so.1" --shlib-requires "libfoo.so.1" ../pkg_B
+	atf_check_equal $? 0
+	xbps-rindex -d --compression none -a $PWD/*.xbps
+	atf_check_equal $? 0
+	xbps-rindex -d --compression none --signedby test --privkey ../key.pem -s $PWD
+	atf_check_equal $? 0
+	tar -xOf *-repodata index-meta.plist > meta.plist
+	atf_check_equal $? 0
+	grep -A2 "<key>libfoo.so.1</key>" meta.plist | grep -q "<string>foo</string>"
+	atf_check_equal $? 0
+	grep -A2 "<key>libbar.so.1</key>" meta.plist | grep -q "<string>bar</string>"
+	atf_check_equal $? 0
+
+	xbps-create -A noarch -n foo-1.1_1 -s "foo pkg" --shlib-provides "libfoo.so.1 libfoo.so.2" ../pkg_A
+	atf_check_equal $? 0
+	xbps-rindex -d --compression none -a $PWD/foo-1.1_1.noarch.xbps
+	atf_check_equal $? 0
+	tar -xOf *-repodata index-meta.plist > meta.plist
+	grep -A2 "<key>libfoo.so.2</key>" meta.plist | grep -q "<string>foo</string>"
+	atf_check_equal $? 0
+	grep -q "<key>signature-by</key>" meta.plist
+	atf_check_equal $? 0
+
+	rm bar-1.0_1.noarch.xbps
+	xbps-rindex -d --compression none -c $PWD
+	atf_check_equal $? 0
+	tar -xOf *-repodata index-meta.plist > meta.plist
+	grep -q "<key>libbar.so.1</key>" meta.plist
+	atf_check_equal $? 1
+	grep -q "<key>libfoo.so.1</key>" meta.plist
+	atf_check_equal $? 0
+}
+
 atf_init_test_cases() {
 	atf_add_test_case update
 	atf_add_test_case revert
 	atf_add_test_case stage
 	atf_add_test_case stage_resolve_bug
+	atf_add_test_case binidx
+	atf_add_test_case binidx_digest
+	atf_add_test_case frames
+	atf_add_test_case shlib_providers
 }
@@ -79,8 +79,46 @@ remove_from_stage_body() {
 	atf_check_equal $? 1
 }
 
+atf_test_case remove_dict
+
+remove_dict_head() {
+	atf_set "descr" "xbps-rindex(1) -c: remove obsolete repodata dictionaries"
+}
+
+remove_dict_body() {
+	mkdir -p some_repo pkg
+	cd some_repo
+	for i in $(seq 1 30); do
+		xbps-create -A noarch -n foo${i}-1.0_1 -s "foo pkg" \
+			-D "bar>=${i}.0_1" --shlib-provides "libfoo${i}.so.1" ../pkg
+		atf_check_equal $? 0
+	done
+	xbps-rindex --train-dict -a $PWD/*.xbps
+	atf_check_equal $? 0
+	for i in 31 32; do
+		xbps-create -A noarch -n foo${i}-1.0_1 -s "foo pkg" ../pkg
+		atf_check_equal $? 0
+		xbps-rindex --train-dict -a $PWD/foo${i}-1.0_1.noarch.xbps
+		atf_check_equal $? 0
+	done
+	repodata=$(echo *-repodata)
+	[ $(ls $repodata.dict.* | wc -l) -eq 3 ]
+	atf_check_equal $? 0
+	cd ..
+	xbps-rindex -c $PWD/some_repo
+	atf_check_equal $? 0
+	# only the copy the archive was compressed with is kept
+	[ $(ls some_repo/$repodata.dict.* | wc -l) -eq 1 ]
+	atf_check_equal $? 0
+	cmp some_repo/$repodata.dict some_repo/$repodata.dict.*
+	atf_check_equal $? 0
+	out=$(xbps-query -r root -C empty.conf --repository=some_repo -p pkgver foo32)
+	atf_check_equal "$out" "foo32-1.0_1"
+}
+
 atf_init_test_cases() {
 	atf_add_test_case noremove
 	atf_add_test_case issue19
 	atf_add_test_case remove_from_stage
+	atf_add_test_case remove_dict
 }